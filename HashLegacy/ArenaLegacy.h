@@ -0,0 +1,72 @@
+#pragma once
+// Арена строк: текст копируется в крупные блоки, строки лежат в блоке подряд без отдельных выделений памяти.
+// Блоки не перемещаются, поэтому string_view на сохранённый текст действительны до clear() или уничтожения
+// арены; перемещение арены их не портит. Отдельные строки не освобождаются -- только вся арена сразу
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+class StringArena {
+private:
+    // Блоки арены; строки добавляются в последний блок
+    vector<unique_ptr<char[]>> blocks;
+    // Размер обычного блока; строка длиннее блока получает собственный блок
+    size_t blockSize;
+    // Занято и всего байт в последнем блоке
+    size_t blockUsed;
+    size_t blockCapacity;
+    // Всего байт в блоках и из них занято текстом
+    size_t allocatedBytes;
+    size_t usedBytes;
+
+public:
+    explicit StringArena(size_t blockSize = 64 * 1024)
+        : blockSize(max<size_t>(1, blockSize)), blockUsed(0), blockCapacity(0), allocatedBytes(0), usedBytes(0) {}
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+    StringArena(StringArena&&) = default;
+    StringArena& operator=(StringArena&&) = default;
+
+    // Копирование текста в арену. Пустая строка памяти не занимает
+    string_view store(string_view text) {
+        if (text.empty()) {
+            return string_view();
+        }
+        if (blockUsed + text.size() > blockCapacity) {
+            size_t size = max(blockSize, text.size());
+            blocks.emplace_back(new char[size]);
+            allocatedBytes += size;
+            blockUsed = 0;
+            blockCapacity = size;
+        }
+        char* target = blocks.back().get() + blockUsed;
+        memcpy(target, text.data(), text.size());
+        blockUsed += text.size();
+        usedBytes += text.size();
+        return string_view(target, text.size());
+    }
+
+    // Освобождение всех блоков. Выданные string_view становятся недействительными
+    void clear() {
+        blocks.clear();
+        blockUsed = 0;
+        blockCapacity = 0;
+        allocatedBytes = 0;
+        usedBytes = 0;
+    }
+
+    // Байт текста в арене. Выделено может быть больше: хвосты блоков, в которые не поместилась следующая строка
+    size_t used() const {
+        return usedBytes;
+    }
+
+    // Объём памяти в байтах: блоки и массив указателей на них
+    size_t memory_usage() const {
+        return allocatedBytes + blocks.capacity() * sizeof(unique_ptr<char[]>);
+    }
+};
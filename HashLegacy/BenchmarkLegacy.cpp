@@ -0,0 +1,678 @@
+// BenchmarkLegacy.cpp : замеры производительности HashTable, Dictionary и Set (Google Benchmark).
+//
+// Каждый замер выполняется для ключей int, string и User, нескольких размеров и максимальных коэффициентов загрузки
+// (аргументы size и load, load -- в процентах). Для сравнения те же операции замеряются
+// на std::unordered_map и на эталонной таблице с открытой адресацией.
+//
+// Сохранение результатов в JSON для отслеживания изменений:
+//   hashlegacy_benchmark --benchmark_out=bench_output.json --benchmark_out_format=json
+// Выбор отдельных замеров: --benchmark_filter=LookupMiss/HashTable
+
+#include <benchmark/benchmark.h>
+#include <list>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include "HashLegacy.h"
+#include "DictionaryLegacy.h"
+#include "SetLegacy.h"
+#include "CuckooLegacy.h"
+#include "IntHashLegacy.h"
+#include "StringHashLegacy.h"
+#include "CounterLegacy.h"
+#include "PrefixLegacy.h"
+#include "CacheLegacy.h"
+
+using namespace std;
+
+// Эталонная таблица с открытой адресацией: ёмкость -- степень двойки, линейное зондирование,
+// удаление со сдвигом назад (без надгробий). Используется только как точка отсчёта в замерах
+template <typename Key>
+class OpenAddressingReference {
+private:
+    vector<Key> keys;
+    vector<unsigned char> used;
+    size_t mask;
+    int shift;
+    size_t _size;
+    double maxLoadFactor;
+
+    size_t home(const Key& key) const {
+        // Фибоначчиево перемешивание результата std::hash: номер ячейки берётся из старших разрядов произведения
+        return static_cast<size_t>((static_cast<unsigned long long>(std::hash<Key>{}(key)) * 11400714819323198485ull) >> shift);
+    }
+
+    void grow() {
+        vector<Key> oldKeys = std::move(keys);
+        vector<unsigned char> oldUsed = std::move(used);
+        keys.assign(oldKeys.size() * 2, Key());
+        used.assign(oldKeys.size() * 2, 0);
+        mask = keys.size() - 1;
+        shift--;
+        _size = 0;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldUsed[i]) {
+                insert(oldKeys[i]);
+            }
+        }
+    }
+
+public:
+    OpenAddressingReference(size_t capacity, double maxLoadFactor)
+        : mask(0), shift(64 - 4), _size(0), maxLoadFactor(maxLoadFactor) {
+        size_t power = 16;
+        while (power < capacity) {
+            power *= 2;
+            shift--;
+        }
+        keys.assign(power, Key());
+        used.assign(power, 0);
+        mask = power - 1;
+    }
+
+    void insert(const Key& key) {
+        if ((double)(_size + 1) / keys.size() > maxLoadFactor) {
+            grow();
+        }
+        size_t index = home(key);
+        while (used[index]) {
+            if (keys[index] == key) {
+                return;
+            }
+            index = (index + 1) & mask;
+        }
+        keys[index] = key;
+        used[index] = 1;
+        _size++;
+    }
+
+    bool contains(const Key& key) const {
+        for (size_t index = home(key); used[index]; index = (index + 1) & mask) {
+            if (keys[index] == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void erase(const Key& key) {
+        size_t index = home(key);
+        while (used[index] && !(keys[index] == key)) {
+            index = (index + 1) & mask;
+        }
+        if (!used[index]) {
+            return;
+        }
+        // Сдвиг назад: подтягиваем ключи, для которых освободившаяся ячейка лежит на пути от домашней
+        size_t hole = index;
+        for (size_t next = (hole + 1) & mask; used[next]; next = (next + 1) & mask) {
+            if (((next - home(keys[next])) & mask) >= ((next - hole) & mask)) {
+                keys[hole] = std::move(keys[next]);
+                hole = next;
+            }
+        }
+        keys[hole] = Key();
+        used[hole] = 0;
+        _size--;
+    }
+
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (used[i]) {
+                visit(keys[i]);
+            }
+        }
+    }
+
+    void reserve(size_t count) {
+        while ((double)count / keys.size() > maxLoadFactor) {
+            grow();
+        }
+    }
+
+    size_t size() const {
+        return _size;
+    }
+};
+
+// Генерация ключей: ключи с номером i < 0 никогда не вставляются и используются для неуспешного поиска
+template <typename Key>
+Key makeKey(long long i);
+
+template <>
+int makeKey<int>(long long i) {
+    return static_cast<int>(i * 7 + 3);
+}
+
+template <>
+string makeKey<string>(long long i) {
+    return "word" + to_string(i * 7 + 3);
+}
+
+template <>
+User makeKey<User>(long long i) {
+    return User(static_cast<int>(i), "User" + to_string(i));
+}
+
+template <typename Key>
+vector<Key> makeKeys(size_t count, bool missing = false) {
+    vector<Key> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        long long n = static_cast<long long>(i) + 1;
+        keys.push_back(makeKey<Key>(missing ? -n : n));
+    }
+    return keys;
+}
+
+// Адаптеры приводят контейнеры к общему набору операций замеров
+template <typename Key>
+struct HashTableAdapter {
+    static constexpr const char* name = "HashTable";
+    HashTable<Key> table;
+    HashTableAdapter(double load) : table(16, HashTable<Key>::defaultHash, load) {}
+    void insert(const Key& key) { table.insertUnique(key); }
+    bool contains(const Key& key) const { return table.contains(key); }
+    void erase(const Key& key) { table.erase(key); }
+    size_t iterate() const { size_t n = 0; for (const Key& key : table) { benchmark::DoNotOptimize(&key); n++; } return n; }
+    void grow() { table.reserve(table.size() * 2); }
+};
+
+template <typename Key>
+struct SetAdapter {
+    static constexpr const char* name = "Set";
+    Set<Key> set;
+    SetAdapter(double load) : set(16, [](const Key& key) { return HashTable<Key>::defaultHash(key); }, load) {}
+    void insert(const Key& key) { set.insert(key); }
+    bool contains(const Key& key) const { return set.contains(key); }
+    void erase(const Key& key) { set.erase(key); }
+    size_t iterate() const { size_t n = 0; for (const Key& key : set) { benchmark::DoNotOptimize(&key); n++; } return n; }
+    void grow() { set.reserve(set.size() * 2); }
+};
+
+// Множество с блочным фильтром Блума перед таблицей (см. FilterLegacy.h)
+template <typename Key>
+struct FilteredSetAdapter {
+    static constexpr const char* name = "Set+Bloom";
+    Set<Key, DenseSlots<Key>, 8, BlockedBloomFilter> set;
+    FilteredSetAdapter(double load) : set(16, [](const Key& key) { return HashTable<Key>::defaultHash(key); }, load) {}
+    void insert(const Key& key) { set.insert(key); }
+    bool contains(const Key& key) const { return set.contains(key); }
+    void erase(const Key& key) { set.erase(key); }
+    size_t iterate() const { size_t n = 0; for (const Key& key : set) { benchmark::DoNotOptimize(&key); n++; } return n; }
+    void grow() { set.reserve(set.size() * 2); }
+};
+
+template <typename Key>
+struct CuckooAdapter {
+    static constexpr const char* name = "CuckooHashTable";
+    CuckooHashTable<Key> table;
+    CuckooAdapter(double load) : table(16, CuckooHashTable<Key>::defaultHash, load) {}
+    void insert(const Key& key) { table.insertUnique(key); }
+    bool contains(const Key& key) const { return table.contains(key); }
+    void erase(const Key& key) { table.erase(key); }
+    size_t iterate() const { size_t n = 0; for (const Key& key : table) { benchmark::DoNotOptimize(&key); n++; } return n; }
+    void grow() { table.reserve(table.size() * 2); }
+};
+
+// Таблица целых ключей со значением свободной ячейки вместо служебного массива (см. IntHashLegacy.h)
+template <typename Key>
+struct IntHashTableAdapter {
+    static constexpr const char* name = "IntHashTable";
+    IntHashTable<Key> table;
+    IntHashTableAdapter(double load) : table(16, load) {}
+    void insert(const Key& key) { table.insertUnique(key); }
+    bool contains(const Key& key) const { return table.contains(key); }
+    void erase(const Key& key) { table.erase(key); }
+    size_t iterate() const { size_t n = 0; for (const Key& key : table) { benchmark::DoNotOptimize(&key); n++; } return n; }
+    void grow() { table.reserve(table.size() * 2); }
+};
+
+// Таблица строк с коротким ключом прямо в ячейке (см. StringHashLegacy.h)
+template <typename Key>
+struct StringHashTableAdapter {
+    static constexpr const char* name = "StringHashTable";
+    StringHashTable table;
+    StringHashTableAdapter(double load) : table(16, load) {}
+    void insert(const Key& key) { table.insertUnique(key); }
+    bool contains(const Key& key) const { return table.contains(key); }
+    void erase(const Key& key) { table.erase(key); }
+    size_t iterate() const { size_t n = 0; for (string_view key : table) { benchmark::DoNotOptimize(key.data()); n++; } return n; }
+    void grow() { table.reserve(table.size() * 2); }
+};
+
+template <typename Key>
+struct DictionaryAdapter {
+    static constexpr const char* name = "Dictionary";
+    Dictionary<Key, int> dict;
+    DictionaryAdapter(double load) : dict(16, [](const KeyValuePair<Key, int>& p) { return HashTable<Key>::defaultHash(p.key); }, load) {}
+    void insert(const Key& key) { dict.insert(key, 1); }
+    bool contains(const Key& key) const { return dict.find(key) != nullptr; }
+    void erase(const Key& key) { dict.erase(key); }
+    size_t iterate() const { size_t n = 0; for (const auto& pair : dict) { benchmark::DoNotOptimize(&pair); n++; } return n; }
+};
+
+template <typename Key>
+struct UnorderedMapAdapter {
+    static constexpr const char* name = "unordered_map";
+    unordered_map<Key, int> map;
+    UnorderedMapAdapter(double load) { map.max_load_factor(static_cast<float>(load)); }
+    void insert(const Key& key) { map.emplace(key, 1); }
+    bool contains(const Key& key) const { return map.find(key) != map.end(); }
+    void erase(const Key& key) { map.erase(key); }
+    size_t iterate() const { size_t n = 0; for (const auto& pair : map) { benchmark::DoNotOptimize(&pair); n++; } return n; }
+    void grow() { map.rehash(map.bucket_count() * 2); }
+};
+
+template <typename Key>
+struct OpenAddressingAdapter {
+    static constexpr const char* name = "OpenAddressing";
+    OpenAddressingReference<Key> table;
+    OpenAddressingAdapter(double load) : table(16, load) {}
+    void insert(const Key& key) { table.insert(key); }
+    bool contains(const Key& key) const { return table.contains(key); }
+    void erase(const Key& key) { table.erase(key); }
+    size_t iterate() const { size_t n = 0; table.forEach([&](const Key& key) { benchmark::DoNotOptimize(&key); n++; }); return n; }
+    void grow() { table.reserve(table.size() * 2); }
+};
+
+// Заполнение контейнера первыми count ключами
+template <typename Adapter, typename Key>
+void fill(Adapter& adapter, const vector<Key>& keys) {
+    for (const Key& key : keys) {
+        adapter.insert(key);
+    }
+}
+
+// Вставка size ключей в пустой контейнер (с ростом и перехешированиями)
+template <typename Adapter, typename Key>
+void BM_Insert(benchmark::State& state) {
+    vector<Key> keys = makeKeys<Key>(state.range(0));
+    double load = state.range(1) / 100.0;
+    for (auto _ : state) {
+        Adapter adapter(load);
+        fill(adapter, keys);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Успешный поиск: одна операция на итерацию
+template <typename Adapter, typename Key>
+void BM_LookupHit(benchmark::State& state) {
+    vector<Key> keys = makeKeys<Key>(state.range(0));
+    Adapter adapter(state.range(1) / 100.0);
+    fill(adapter, keys);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(adapter.contains(keys[i]));
+        if (++i == keys.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Неуспешный поиск: ключей нет в контейнере
+template <typename Adapter, typename Key>
+void BM_LookupMiss(benchmark::State& state) {
+    vector<Key> keys = makeKeys<Key>(state.range(0));
+    vector<Key> missing = makeKeys<Key>(state.range(0), true);
+    Adapter adapter(state.range(1) / 100.0);
+    fill(adapter, keys);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(adapter.contains(missing[i]));
+        if (++i == missing.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Чередование удалений и вставок при постоянном размере контейнера
+template <typename Adapter, typename Key>
+void BM_EraseChurn(benchmark::State& state) {
+    vector<Key> keys = makeKeys<Key>(state.range(0));
+    Adapter adapter(state.range(1) / 100.0);
+    fill(adapter, keys);
+    size_t i = 0;
+    for (auto _ : state) {
+        adapter.erase(keys[i]);
+        adapter.insert(keys[i]);
+        if (++i == keys.size())
+            i = 0;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+
+// Полный обход контейнера
+template <typename Adapter, typename Key>
+void BM_Iterate(benchmark::State& state) {
+    vector<Key> keys = makeKeys<Key>(state.range(0));
+    Adapter adapter(state.range(1) / 100.0);
+    fill(adapter, keys);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(adapter.iterate());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Перехеширование заполненного контейнера в удвоенную ёмкость. Копирование исходного контейнера не замеряется
+template <typename Adapter, typename Key>
+void BM_Rehash(benchmark::State& state) {
+    vector<Key> keys = makeKeys<Key>(state.range(0));
+    Adapter filled(state.range(1) / 100.0);
+    fill(filled, keys);
+    for (auto _ : state) {
+        state.PauseTiming();
+        Adapter adapter = filled;
+        state.ResumeTiming();
+        adapter.grow();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Удвоение большой таблицы HashTable с заданным числом потоков перехеширования (аргументы size и threads)
+template <typename Key>
+void BM_ParallelRehash(benchmark::State& state) {
+    vector<Key> keys = makeKeys<Key>(state.range(0));
+    HashTable<Key> filled(16);
+    filled.setRehashThreadCount(1);
+    fill(filled, keys);
+    filled.setRehashThreadCount(state.range(1));
+    for (auto _ : state) {
+        state.PauseTiming();
+        HashTable<Key> table = filled;
+        state.ResumeTiming();
+        table.reserve(table.size() * 2);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Снимок множества и первое изменение после него (удаление и возврат одного ключа).
+// Set копирует все ячейки, PersistentSet -- каталог блоков и один изменённый блок
+template <typename SetType, typename Key>
+void BM_Snapshot(benchmark::State& state) {
+    vector<Key> keys = makeKeys<Key>(state.range(0));
+    SetType live;
+    for (const Key& key : keys) {
+        live.insert(key);
+    }
+    size_t next = 0;
+    for (auto _ : state) {
+        SetType snapshot = live.snapshot();
+        const Key& key = keys[next++ % keys.size()];
+        live.erase(key);
+        live.insert(key);
+        benchmark::DoNotOptimize(snapshot);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Поток из count ключей с повторами: distinct различных ключей, меньшие номера встречаются чаще (как частые слова)
+template <typename Key>
+vector<Key> makeSkewedStream(size_t count, size_t distinct) {
+    vector<Key> keys = makeKeys<Key>(distinct);
+    vector<Key> stream;
+    stream.reserve(count);
+    mt19937_64 random(42);
+    for (size_t i = 0; i < count; ++i) {
+        stream.push_back(keys[min(random() % distinct, random() % distinct)]);
+    }
+    return stream;
+}
+
+// Подсчёт потока ключей: Dictionary (find, затем insert для нового ключа) против Counter::add (один проход)
+template <typename Key>
+void BM_CountDictionary(benchmark::State& state) {
+    vector<Key> stream = makeSkewedStream<Key>(1 << 16, state.range(0));
+    for (auto _ : state) {
+        Dictionary<Key, size_t> counts;
+        for (const Key& key : stream) {
+            size_t* count = counts.find(key);
+            if (count != nullptr) {
+                (*count)++;
+            }
+            else {
+                counts.insert(key, 1);
+            }
+        }
+        benchmark::DoNotOptimize(counts);
+    }
+    state.SetItemsProcessed(state.iterations() * stream.size());
+}
+
+template <typename Key>
+void BM_CountCounter(benchmark::State& state) {
+    vector<Key> stream = makeSkewedStream<Key>(1 << 16, state.range(0));
+    for (auto _ : state) {
+        Counter<Key> counts;
+        for (const Key& key : stream) {
+            counts.add(key);
+        }
+        benchmark::DoNotOptimize(counts);
+    }
+    state.SetItemsProcessed(state.iterations() * stream.size());
+}
+
+// Подсчёт потока ключей общим ConcurrentCounter заданным числом потоков (аргументы distinct и threads)
+template <typename Key>
+void BM_CountConcurrent(benchmark::State& state) {
+    vector<Key> stream = makeSkewedStream<Key>(1 << 16, state.range(0));
+    size_t threads = state.range(1);
+    for (auto _ : state) {
+        ConcurrentCounter<Key> counts;
+        parallelRun(threads, [&](size_t t) {
+            for (size_t i = partBound(stream.size(), threads, t); i < partBound(stream.size(), threads, t + 1); ++i) {
+                counts.add(stream[i]);
+            }
+        });
+        benchmark::DoNotOptimize(counts);
+    }
+    state.SetItemsProcessed(state.iterations() * stream.size());
+}
+
+// Запрос по префиксу word123 (малая доля ключей): обход всего словаря
+// против индекса IndexedDictionary. Индекс строится до замера
+void BM_PrefixScan(benchmark::State& state) {
+    vector<string> keys = makeKeys<string>(state.range(0));
+    Dictionary<string, size_t> dictionary;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        dictionary.insert(keys[i], i);
+    }
+    string prefix = "word123";
+    for (auto _ : state) {
+        size_t found = 0;
+        for (const auto& pair : dictionary) {
+            found += pair.key.compare(0, prefix.size(), prefix) == 0 ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(found);
+    }
+}
+
+void BM_PrefixIndex(benchmark::State& state) {
+    vector<string> keys = makeKeys<string>(state.range(0));
+    IndexedDictionary<size_t> dictionary;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        dictionary.insert(keys[i], i);
+    }
+    string prefix = "word123";
+    dictionary.count_prefix(prefix);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dictionary.with_prefix(prefix));
+    }
+}
+
+// Эталонный LRU-кэш: std::list в порядке обращений и std::unordered_map ключ -> узел списка.
+// Используется только как точка отсчёта для HashCache
+template <typename Key, typename Value>
+class ListLruReference {
+private:
+    size_t capacity;
+    list<pair<Key, Value>> order;
+    unordered_map<Key, typename list<pair<Key, Value>>::iterator> index;
+
+public:
+    explicit ListLruReference(size_t capacity) : capacity(capacity) {}
+
+    template <typename Compute>
+    Value getOrCompute(const Key& key, Compute compute) {
+        auto found = index.find(key);
+        if (found != index.end()) {
+            order.splice(order.begin(), order, found->second);
+            return found->second->second;
+        }
+        if (index.size() == capacity) {
+            index.erase(order.back().first);
+            order.pop_back();
+        }
+        order.emplace_front(key, compute(key));
+        index[key] = order.begin();
+        return order.front().second;
+    }
+};
+
+// Мемоизация потока ключей с повторами кэшем на восьмую часть различных ключей (аргумент distinct)
+template <typename Cache, typename Key>
+void BM_Memoize(benchmark::State& state) {
+    size_t distinct = state.range(0);
+    vector<Key> stream = makeSkewedStream<Key>(1 << 16, distinct);
+    size_t misses = 0;
+    for (auto _ : state) {
+        Cache cache(distinct / 8);
+        for (const Key& key : stream) {
+            benchmark::DoNotOptimize(cache.getOrCompute(key, [&](const Key&) { misses++; return misses; }));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * stream.size());
+    state.counters["hit_rate"] = 1.0 - (double)misses / (state.iterations() * stream.size());
+}
+
+template <typename Key>
+void BM_MemoizeConcurrent(benchmark::State& state) {
+    size_t distinct = state.range(0);
+    size_t threads = state.range(1);
+    vector<Key> stream = makeSkewedStream<Key>(1 << 16, distinct);
+    for (auto _ : state) {
+        ConcurrentHashCache<Key, size_t> cache(distinct / 8);
+        parallelRun(threads, [&](size_t t) {
+            for (size_t i = partBound(stream.size(), threads, t); i < partBound(stream.size(), threads, t + 1); ++i) {
+                benchmark::DoNotOptimize(cache.getOrCompute(stream[i], [&](const Key&) { return i; }));
+            }
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * stream.size());
+}
+
+// Размеры и коэффициенты загрузки (в процентах) для всех замеров
+void applyArguments(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({ "size", "load" });
+    benchmark->ArgsProduct({ { 1 << 10, 1 << 16 }, { 50, 70, 90 } });
+}
+
+// Регистрация всех замеров для одного адаптера и типа ключа
+template <template <typename> class Adapter, typename Key>
+void registerCommon(const string& keyName) {
+    string prefix = string(Adapter<Key>::name) + "<" + keyName + ">";
+    benchmark::RegisterBenchmark(("Insert/" + prefix).c_str(), BM_Insert<Adapter<Key>, Key>)->Apply(applyArguments);
+    benchmark::RegisterBenchmark(("LookupHit/" + prefix).c_str(), BM_LookupHit<Adapter<Key>, Key>)->Apply(applyArguments);
+    benchmark::RegisterBenchmark(("LookupMiss/" + prefix).c_str(), BM_LookupMiss<Adapter<Key>, Key>)->Apply(applyArguments);
+    benchmark::RegisterBenchmark(("EraseChurn/" + prefix).c_str(), BM_EraseChurn<Adapter<Key>, Key>)->Apply(applyArguments);
+    benchmark::RegisterBenchmark(("Iterate/" + prefix).c_str(), BM_Iterate<Adapter<Key>, Key>)->Apply(applyArguments);
+}
+
+template <template <typename> class Adapter, typename Key>
+void registerWithRehash(const string& keyName) {
+    registerCommon<Adapter, Key>(keyName);
+    string prefix = string(Adapter<Key>::name) + "<" + keyName + ">";
+    benchmark::RegisterBenchmark(("Rehash/" + prefix).c_str(), BM_Rehash<Adapter<Key>, Key>)->Apply(applyArguments);
+}
+
+template <typename Key>
+void registerKey(const string& keyName) {
+    registerWithRehash<HashTableAdapter, Key>(keyName);
+    registerWithRehash<CuckooAdapter, Key>(keyName);
+    if constexpr (is_integral<Key>::value) {
+        registerWithRehash<IntHashTableAdapter, Key>(keyName);
+    }
+    if constexpr (is_same<Key, string>::value) {
+        registerWithRehash<StringHashTableAdapter, Key>(keyName);
+    }
+    registerWithRehash<SetAdapter, Key>(keyName);
+    registerWithRehash<FilteredSetAdapter, Key>(keyName);
+    // Dictionary не даёт явного управления ёмкостью, поэтому замер перехеширования для него не регистрируется
+    registerCommon<DictionaryAdapter, Key>(keyName);
+    registerWithRehash<UnorderedMapAdapter, Key>(keyName);
+    registerWithRehash<OpenAddressingAdapter, Key>(keyName);
+}
+
+// Замер параллельного перехеширования больших таблиц: 1, 2, 4 и 8 потоков
+template <typename Key>
+void registerParallelRehash(const string& keyName) {
+    benchmark::RegisterBenchmark(("ParallelRehash/HashTable<" + keyName + ">").c_str(), BM_ParallelRehash<Key>)
+        ->ArgNames({ "size", "threads" })
+        ->ArgsProduct({ { 1 << 20, 1 << 22 }, { 1, 2, 4, 8 } })
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+}
+
+// Замер снимков: полная копия Set против копирования при записи PersistentSet
+template <typename Key>
+void registerSnapshot(const string& keyName) {
+    benchmark::RegisterBenchmark(("Snapshot/Set<" + keyName + ">").c_str(), BM_Snapshot<Set<Key>, Key>)
+        ->ArgName("size")->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    benchmark::RegisterBenchmark(("Snapshot/PersistentSet<" + keyName + ">").c_str(), BM_Snapshot<PersistentSet<Key>, Key>)
+        ->ArgName("size")->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+}
+
+// Замер подсчёта потока ключей с повторами: 1024 и 65536 различных ключей
+template <typename Key>
+void registerCount(const string& keyName) {
+    benchmark::RegisterBenchmark(("Count/Dictionary<" + keyName + ">").c_str(), BM_CountDictionary<Key>)
+        ->ArgName("distinct")->Arg(1 << 10)->Arg(1 << 16);
+    benchmark::RegisterBenchmark(("Count/Counter<" + keyName + ">").c_str(), BM_CountCounter<Key>)
+        ->ArgName("distinct")->Arg(1 << 10)->Arg(1 << 16);
+    benchmark::RegisterBenchmark(("Count/ConcurrentCounter<" + keyName + ">").c_str(), BM_CountConcurrent<Key>)
+        ->ArgNames({ "distinct", "threads" })
+        ->ArgsProduct({ { 1 << 10, 1 << 16 }, { 1, 2, 4, 8 } })
+        ->UseRealTime();
+}
+
+// Замер мемоизации: HashCache (CLOCK) против LRU на std::list, 1024 и 65536 различных ключей
+template <typename Key>
+void registerMemoize(const string& keyName) {
+    benchmark::RegisterBenchmark(("Memoize/HashCache<" + keyName + ">").c_str(), BM_Memoize<HashCache<Key, size_t>, Key>)
+        ->ArgName("distinct")->Arg(1 << 10)->Arg(1 << 16);
+    benchmark::RegisterBenchmark(("Memoize/ListLru<" + keyName + ">").c_str(), BM_Memoize<ListLruReference<Key, size_t>, Key>)
+        ->ArgName("distinct")->Arg(1 << 10)->Arg(1 << 16);
+    benchmark::RegisterBenchmark(("Memoize/ConcurrentHashCache<" + keyName + ">").c_str(), BM_MemoizeConcurrent<Key>)
+        ->ArgNames({ "distinct", "threads" })
+        ->ArgsProduct({ { 1 << 10, 1 << 16 }, { 1, 2, 4, 8 } })
+        ->UseRealTime();
+}
+
+int main(int argc, char** argv) {
+    registerKey<int>("int");
+    registerKey<string>("string");
+    registerKey<User>("User");
+    registerParallelRehash<int>("int");
+    registerParallelRehash<string>("string");
+    registerSnapshot<int>("int");
+    registerSnapshot<string>("string");
+    registerCount<int>("int");
+    registerCount<string>("string");
+    registerMemoize<int>("int");
+    registerMemoize<string>("string");
+    benchmark::RegisterBenchmark("Prefix/Scan<string>", BM_PrefixScan)->ArgName("size")->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+    benchmark::RegisterBenchmark("Prefix/Index<string>", BM_PrefixIndex)->ArgName("size")->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,554 @@
+#pragma once
+// Кэш с ограниченным числом записей и вытеснением CLOCK (приближение LRU).
+// Записи лежат в массиве фиксированного размера, выделенном при создании; индекс ключ -> номер записи --
+// хеш-таблица HashTable, заранее рассчитанная на все записи, так что занятая кэшем память не растёт после создания
+// (кроме динамической памяти самих ключей и значений). Связей между записями нет: кольцо CLOCK -- сам массив,
+// обходимый стрелкой по номерам, признак обращения -- байт на запись. Попадание только ставит признак,
+// а не переставляет узел списка, как LRU на std::list.
+// Вытеснение: стрелка идёт по кольцу, снимая признаки обращения, и освобождает первую запись без признака
+//
+// ConcurrentHashCache делит ключи между частями, у каждой части свой кэш и своя блокировка
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "HashLegacy.h"
+#include "PairLegacy.h"
+#include "ParallelLegacy.h"
+#include "StatsLegacy.h"
+
+using namespace std;
+
+template <typename Key, typename Value>
+class HashCache {
+private:
+    using IndexEntry = KeyValuePair<Key, uint32_t>;
+
+    // Запись кэша. Ключ хранится и в индексе: по нему и по сохранённому хешу вытесняемая запись
+    // удаляется из индекса без повторного хеширования
+    struct Entry {
+        Key key;
+        Value value;
+        size_t hash = 0;
+    };
+
+    function<size_t(const Key&)> hashFunction;
+    // Ключ -> номер записи
+    HashTable<IndexEntry> index;
+    vector<Entry> entries;
+    // Признак обращения к записи после последнего прохода стрелки
+    vector<uint8_t> referenced;
+    // Записи, освобождённые erase; занимаются раньше вытеснения
+    vector<uint32_t> freeEntries;
+    // Число записей, занятых хотя бы раз: до заполнения кэша записи занимаются подряд
+    size_t used;
+    // Стрелка CLOCK -- следующая запись-кандидат на вытеснение
+    size_t hand;
+    CacheStats stats;
+
+    // Номер записи с ключом или capacity(), если ключа нет
+    size_t locate(const Key& key, size_t hashValue) const {
+        size_t slot = index.indexOf(IndexEntry(key, 0), hashValue);
+        return slot < index.capacity() ? index.getListAtIndex(slot).value : entries.size();
+    }
+
+    // Номер записи под новый ключ: свободная, ни разу не занятая или вытесненная
+    size_t allocate() {
+        if (!freeEntries.empty()) {
+            size_t entry = freeEntries.back();
+            freeEntries.pop_back();
+            return entry;
+        }
+        if (used < entries.size()) {
+            return used++;
+        }
+        // Все записи заняты: стрелка снимает признаки обращения до первой записи без признака
+        while (referenced[hand]) {
+            referenced[hand] = 0;
+            hand = hand + 1 == entries.size() ? 0 : hand + 1;
+        }
+        size_t victim = hand;
+        hand = hand + 1 == entries.size() ? 0 : hand + 1;
+        index.erase(IndexEntry(entries[victim].key, 0), entries[victim].hash);
+        stats.evictions++;
+        return victim;
+    }
+
+    // Ёмкость индекса на capacity записей. Каждое вытеснение оставляет в индексе надгробие, и промах -- частая
+    // операция кэша -- зондирует через надгробия до ячейки, которая ни разу не была занята. Таблица перестраивается,
+    // когда ключи с надгробиями занимают больше 0.7 ячеек. При загрузке ключами 0.25 промах в среднем короче,
+    // а перестройка случается раз в 1.8 * capacity вытеснений (при загрузке 0.5 -- вдвое чаще, при 0.7 -- после каждого).
+    // minLoadFactor = 0: индекс не уменьшается при удалениях
+    static size_t indexCapacity(size_t capacity) {
+        return 4 * capacity + 1;
+    }
+
+    // Проверка capacity до выделения памяти под индекс и записи: ошибка -- invalid_argument, а не bad_alloc или переполнение 4 * capacity
+    static size_t checkedCapacity(size_t capacity) {
+        if (capacity == 0 || capacity >= UINT32_MAX) {
+            throw invalid_argument("HashCache capacity must be in [1, 2^32)");
+        }
+        return capacity;
+    }
+
+    // Вставка или замена значения ключа с хешем hashValue
+    void store(const Key& key, size_t hashValue, Value value) {
+        size_t existing = locate(key, hashValue);
+        if (existing < entries.size()) {
+            entries[existing].value = std::move(value);
+            referenced[existing] = 1;
+            return;
+        }
+        size_t entry = allocate();
+        entries[entry].key = key;
+        entries[entry].value = std::move(value);
+        entries[entry].hash = hashValue;
+        referenced[entry] = 0;
+        index.insert(IndexEntry(key, static_cast<uint32_t>(entry)), hashValue);
+        stats.insertions++;
+    }
+
+public:
+    // capacity -- наибольшее число записей. Бросает исключение invalid_argument, если capacity == 0 или capacity >= 2^32
+    explicit HashCache(size_t capacity, function<size_t(const Key&)> hashFunction = HashTable<Key>::defaultHash)
+        : hashFunction(hashFunction),
+          index(indexCapacity(checkedCapacity(capacity)), [hashFunction](const IndexEntry& entry) { return hashFunction(entry.key); }, 0.7, 0.0),
+          entries(capacity), referenced(capacity, 0), used(0), hand(0) {
+        freeEntries.reserve(capacity);
+    }
+
+    // Наибольшее число записей, при котором memory_usage() не превышает budget байт
+    static size_t capacityForBudget(size_t budget) {
+        // На запись: сама запись, признак обращения, номер в списке свободных и четыре ячейки индекса с битами занятости
+        size_t perEntry = sizeof(Entry) + sizeof(uint8_t) + sizeof(uint32_t) + 4 * sizeof(IndexEntry) + 1;
+        size_t fixed = sizeof(HashCache) + sizeof(IndexEntry) + 2 * sizeof(uint64_t);
+        return budget > fixed ? (budget - fixed) / perEntry : 0;
+    }
+
+    // Кэш, занимающий не больше budget байт (без динамической памяти внутри ключей и значений).
+    // Бросает исключение invalid_argument, если в бюджет не помещается ни одна запись
+    static HashCache withBudget(size_t budget, function<size_t(const Key&)> hashFunction = HashTable<Key>::defaultHash) {
+        return HashCache(capacityForBudget(budget), hashFunction);
+    }
+
+    // Значение по ключу или nullptr при промахе. Попадание отмечает запись как использованную.
+    // Указатель действителен до следующего изменения кэша
+        // Сложность: O(1) в среднем случае
+    Value* find(const Key& key) {
+        size_t entry = locate(key, hashFunction(key));
+        if (entry == entries.size()) {
+            stats.misses++;
+            return nullptr;
+        }
+        stats.hits++;
+        referenced[entry] = 1;
+        return &entries[entry].value;
+    }
+
+    // Проверка наличия ключа без учёта в статистике и без отметки обращения
+    bool contains(const Key& key) const {
+        return locate(key, hashFunction(key)) != entries.size();
+    }
+
+    // Вставка или замена значения. Если кэш заполнен, вытесняется запись, выбранная CLOCK.
+    // Новая запись не отмечена: если к ней не обратятся до прохода стрелки, она будет вытеснена первой
+        // Сложность: O(1) в среднем случае, O(capacity) в худшем случае (все записи отмечены)
+    void put(const Key& key, Value value) {
+        store(key, hashFunction(key), std::move(value));
+    }
+
+    // Мемоизация: значение из кэша или compute(key), сохранённое в кэше
+    template <typename Compute>
+    Value getOrCompute(const Key& key, Compute compute) {
+        size_t hashValue = hashFunction(key);
+        size_t entry = locate(key, hashValue);
+        if (entry < entries.size()) {
+            stats.hits++;
+            referenced[entry] = 1;
+            return entries[entry].value;
+        }
+        stats.misses++;
+        Value value = compute(key);
+        // compute мог сам обратиться к кэшу и вставить ключ, поэтому store снова ищет его
+        store(key, hashValue, value);
+        return value;
+    }
+
+    // Удаление ключа. Запись освобождается и занимается следующей вставкой без вытеснения
+    void erase(const Key& key) {
+        size_t hashValue = hashFunction(key);
+        size_t entry = locate(key, hashValue);
+        if (entry == entries.size()) {
+            return;
+        }
+        index.erase(IndexEntry(key, 0), hashValue);
+        entries[entry] = Entry();
+        referenced[entry] = 0;
+        freeEntries.push_back(static_cast<uint32_t>(entry));
+    }
+
+    size_t size() const {
+        return index.size();
+    }
+
+    // Наибольшее число записей
+    size_t capacity() const {
+        return entries.size();
+    }
+
+    const CacheStats& getStats() const {
+        return stats;
+    }
+
+    void resetStats() {
+        stats = CacheStats();
+    }
+
+    // Удаление всех записей. Память не освобождается, статистика сохраняется
+    void clear() {
+        index.clear();
+        fill(entries.begin(), entries.end(), Entry());
+        fill(referenced.begin(), referenced.end(), 0);
+        freeEntries.clear();
+        used = 0;
+        hand = 0;
+    }
+
+    // Объём памяти в байтах: записи, признаки обращения и индекс (без динамической памяти внутри ключей и значений)
+    size_t memory_usage() const {
+        return sizeof(*this) - sizeof(index) + index.memory_usage() + entries.capacity() * sizeof(Entry)
+            + referenced.capacity() + freeEntries.capacity() * sizeof(uint32_t);
+    }
+
+    static void testAllMethods();
+};
+
+// Кэш для нескольких потоков: ключи делятся между частями по хешу, у каждой части свой HashCache и своя блокировка.
+// Вытеснение идёт внутри части, поэтому при неравномерном распределении ключей это приближение общего CLOCK
+template <typename Key, typename Value>
+class ConcurrentHashCache {
+private:
+    // Часть кэша; выравнивание разводит блокировки частей по разным строкам кэша
+    struct alignas(64) Shard {
+        mutex lock;
+        HashCache<Key, Value> cache;
+
+        Shard(size_t capacity, function<size_t(const Key&)> hashFunction) : cache(capacity, hashFunction) {}
+    };
+
+    function<size_t(const Key&)> hashFunction;
+    vector<unique_ptr<Shard>> shards;
+
+    // Часть ключа. Перемешивание развязывает выбор части и ячейку в индексе части
+    Shard& shardOf(const Key& key) const {
+        return *shards[mixHash(hashFunction(key)) % shards.size()];
+    }
+
+public:
+    // capacity -- наибольшее число записей всего кэша, делится поровну между частями.
+    // shardCount -- число частей (0 -- по четыре на аппаратный поток); больше capacity частей не создаётся.
+    // Бросает исключение invalid_argument, если capacity == 0
+    explicit ConcurrentHashCache(size_t capacity, size_t shardCount = 0, function<size_t(const Key&)> hashFunction = HashTable<Key>::defaultHash)
+        : hashFunction(hashFunction) {
+        if (capacity == 0) {
+            throw invalid_argument("ConcurrentHashCache capacity must be positive");
+        }
+        if (shardCount == 0) {
+            shardCount = 4 * defaultThreadCount();
+        }
+        shardCount = std::min(shardCount, capacity);
+        for (size_t i = 0; i < shardCount; ++i) {
+            shards.push_back(make_unique<Shard>(capacity / shardCount + (i < capacity % shardCount ? 1 : 0), hashFunction));
+        }
+    }
+
+    // Кэш, занимающий не больше budget байт (без динамической памяти внутри ключей и значений).
+    // Если доля бюджета не вмещает ни одной записи, число частей уменьшается вдвое, пока не вместит.
+    // Бросает исключение invalid_argument, если в бюджет не помещается ни одна запись
+    static ConcurrentHashCache withBudget(size_t budget, size_t shardCount = 0, function<size_t(const Key&)> hashFunction = HashTable<Key>::defaultHash) {
+        if (shardCount == 0) {
+            shardCount = 4 * defaultThreadCount();
+        }
+        size_t overhead = sizeof(Shard) - sizeof(HashCache<Key, Value>) + sizeof(unique_ptr<Shard>);
+        auto shardCapacity = [&](size_t count) {
+            size_t perShard = budget / count;
+            return perShard > overhead ? HashCache<Key, Value>::capacityForBudget(perShard - overhead) : 0;
+        };
+        while (shardCount > 1 && shardCapacity(shardCount) == 0) {
+            shardCount /= 2;
+        }
+        size_t capacity = shardCapacity(shardCount);
+        if (capacity == 0) {
+            throw invalid_argument("ConcurrentHashCache budget does not fit a single entry");
+        }
+        return ConcurrentHashCache(capacity * shardCount, shardCount, hashFunction);
+    }
+
+    // Копия значения по ключу или nullopt при промахе. Безопасно вызывать из нескольких потоков
+    optional<Value> find(const Key& key) {
+        Shard& shard = shardOf(key);
+        lock_guard<mutex> guard(shard.lock);
+        Value* value = shard.cache.find(key);
+        return value != nullptr ? optional<Value>(*value) : nullopt;
+    }
+
+    bool contains(const Key& key) const {
+        Shard& shard = shardOf(key);
+        lock_guard<mutex> guard(shard.lock);
+        return shard.cache.contains(key);
+    }
+
+    void put(const Key& key, Value value) {
+        Shard& shard = shardOf(key);
+        lock_guard<mutex> guard(shard.lock);
+        shard.cache.put(key, std::move(value));
+    }
+
+    // Мемоизация. compute вызывается без блокировки, чтобы долгое вычисление не останавливало другие ключи части;
+    // поэтому при одновременном промахе по одному ключу значение могут вычислить несколько потоков
+    template <typename Compute>
+    Value getOrCompute(const Key& key, Compute compute) {
+        Shard& shard = shardOf(key);
+        {
+            lock_guard<mutex> guard(shard.lock);
+            Value* cached = shard.cache.find(key);
+            if (cached != nullptr) {
+                return *cached;
+            }
+        }
+        Value value = compute(key);
+        lock_guard<mutex> guard(shard.lock);
+        shard.cache.put(key, value);
+        return value;
+    }
+
+    void erase(const Key& key) {
+        Shard& shard = shardOf(key);
+        lock_guard<mutex> guard(shard.lock);
+        shard.cache.erase(key);
+    }
+
+    size_t size() const {
+        size_t result = 0;
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            result += shard->cache.size();
+        }
+        return result;
+    }
+
+    size_t capacity() const {
+        size_t result = 0;
+        for (const auto& shard : shards) {
+            result += shard->cache.capacity();
+        }
+        return result;
+    }
+
+    size_t shardCount() const {
+        return shards.size();
+    }
+
+    // Статистика, просуммированная по частям
+    CacheStats getStats() const {
+        CacheStats result;
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            result += shard->cache.getStats();
+        }
+        return result;
+    }
+
+    void resetStats() {
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            shard->cache.resetStats();
+        }
+    }
+
+    void clear() {
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            shard->cache.clear();
+        }
+    }
+
+    size_t memory_usage() const {
+        size_t result = sizeof(*this) + shards.capacity() * sizeof(unique_ptr<Shard>);
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            result += sizeof(Shard) - sizeof(shard->cache) + shard->cache.memory_usage();
+        }
+        return result;
+    }
+
+    static void testAllMethods();
+};
+
+template <typename Key, typename Value>
+void HashCache<Key, Value>::testAllMethods() {
+    HashCache<string, int> cache(3);
+    assert(cache.capacity() == 3 && cache.size() == 0);
+    assert(cache.find("a") == nullptr && cache.getStats().misses == 1);
+
+    // Заполнение без вытеснения
+    cache.put("a", 1);
+    cache.put("b", 2);
+    cache.put("c", 3);
+    assert(cache.size() == 3 && cache.getStats().insertions == 3 && cache.getStats().evictions == 0);
+    assert(*cache.find("a") == 1 && cache.getStats().hits == 1);
+
+    // "a" отмечена обращением, поэтому стрелка пропускает её и вытесняет "b"
+    cache.put("d", 4);
+    assert(cache.size() == 3 && cache.getStats().evictions == 1);
+    assert(cache.contains("a") && !cache.contains("b") && cache.contains("c") && cache.contains("d"));
+
+    // Замена значения не вытесняет записей
+    cache.put("c", 30);
+    assert(*cache.find("c") == 30 && cache.size() == 3 && cache.getStats().evictions == 1);
+
+    // Стрелка стоит на "c": её признак (от замены) снимается, а признак "a" снят предыдущим проходом -- вытесняется "a"
+    cache.put("e", 5);
+    assert(!cache.contains("a") && cache.contains("c") && cache.contains("d") && cache.contains("e"));
+
+    // Освобождённая запись занимается без вытеснения
+    cache.erase("d");
+    cache.erase("missing");
+    assert(cache.size() == 2 && !cache.contains("d"));
+    size_t evictions = cache.getStats().evictions;
+    cache.put("f", 6);
+    assert(cache.size() == 3 && cache.getStats().evictions == evictions);
+
+    // Мемоизация: функция вызывается только при промахе
+    cache.resetStats();
+    int calls = 0;
+    auto square = [&](const string& key) { calls++; return (int)(key.size() * key.size()); };
+    assert(cache.getOrCompute("xyz", square) == 9 && calls == 1);
+    assert(cache.getOrCompute("xyz", square) == 9 && calls == 1);
+    assert(cache.getStats().hits == 1 && cache.getStats().misses == 1 && cache.getStats().hitRate() == 0.5);
+
+    // Размер не превышает ёмкости при любом числе вставок; частые ключи переживают поток редких
+    HashCache<int, int> numbers(100);
+    for (int i = 0; i < 10000; i++) {
+        numbers.getOrCompute(i % 10, [](int key) { return key; });
+        numbers.put(1000 + i, i);
+        assert(numbers.size() <= 100);
+    }
+    for (int i = 0; i < 10; i++) {
+        assert(numbers.contains(i));
+    }
+    assert(numbers.getStats().evictions == 10000 + 10 - 100);
+    numbers.clear();
+    assert(numbers.size() == 0 && !numbers.contains(0));
+    numbers.put(1, 1);
+    assert(numbers.contains(1) && numbers.size() == 1);
+
+    // Бюджет памяти
+    const size_t budget = 1 << 16;
+    HashCache<int, double> budgeted = HashCache<int, double>::withBudget(budget);
+    assert(budgeted.capacity() > 0);
+    for (int i = 0; i < 100000; i++) {
+        budgeted.put(i, i);
+    }
+    assert(budgeted.size() == budgeted.capacity() && budgeted.memory_usage() <= budget);
+
+    bool caught = false;
+    try {
+        HashCache<int, int> tiny = HashCache<int, int>::withBudget(16);
+    }
+    catch (const invalid_argument&) {
+        caught = true;
+    }
+    assert(caught);
+    // Слишком большая ёмкость отвергается до выделения индекса
+    for (size_t huge : { size_t(1) << 32, numeric_limits<size_t>::max() }) {
+        caught = false;
+        try {
+            HashCache<int, int> tooLarge(huge);
+        }
+        catch (const invalid_argument&) {
+            caught = true;
+        }
+        assert(caught);
+    }
+
+    ConcurrentHashCache<int, int>::testAllMethods();
+
+    cout << "All tests passed successfully!" << endl;
+}
+
+template <typename Key, typename Value>
+void ConcurrentHashCache<Key, Value>::testAllMethods() {
+    ConcurrentHashCache<int, int> cache(256, 8);
+    assert(cache.shardCount() == 8 && cache.capacity() == 256);
+
+    // Потоки запрашивают пересекающиеся ключи; вычисленное значение всегда верно
+    const size_t threads = 4;
+    atomic<size_t> computed(0);
+    parallelRun(threads, [&](size_t t) {
+        for (int i = 0; i < 5000; i++) {
+            int key = (i * 7 + (int)t) % 64;
+            int value = cache.getOrCompute(key, [&](int k) { computed++; return k * 3; });
+            assert(value == key * 3);
+            cache.put(10000 + (int)t * 5000 + i, i);
+        }
+    });
+    CacheStats stats = cache.getStats();
+    assert(stats.hits + stats.misses == threads * 5000);
+    assert(stats.misses == computed.load());
+    assert(cache.size() <= cache.capacity());
+    assert(stats.insertions - stats.evictions == cache.size());
+
+    assert(cache.find(-1) == nullopt);
+    cache.put(-1, 7);
+    assert(cache.find(-1) == optional<int>(7) && cache.contains(-1));
+    cache.erase(-1);
+    assert(!cache.contains(-1));
+
+    cache.resetStats();
+    assert(cache.getStats().hits == 0);
+    cache.clear();
+    assert(cache.size() == 0);
+
+    ConcurrentHashCache<int, double> budgeted = ConcurrentHashCache<int, double>::withBudget(1 << 16, 4);
+    for (int i = 0; i < 10000; i++) {
+        budgeted.put(i, i);
+    }
+    assert(budgeted.memory_usage() <= (1 << 16));
+
+    // Частей не больше, чем записей
+    ConcurrentHashCache<int, int> few(3, 8);
+    assert(few.shardCount() == 3 && few.capacity() == 3);
+    // Малый бюджет делится на меньшее число частей, в каждой хотя бы одна запись
+    ConcurrentHashCache<int, double> small = ConcurrentHashCache<int, double>::withBudget(4096, 64);
+    assert(small.shardCount() < 64 && small.capacity() >= small.shardCount());
+    for (int i = 0; i < 1000; i++) {
+        small.put(i, i);
+    }
+    assert(small.memory_usage() <= 4096);
+
+    bool caught = false;
+    try {
+        ConcurrentHashCache<int, int> tiny = ConcurrentHashCache<int, int>::withBudget(16);
+    }
+    catch (const invalid_argument&) {
+        caught = true;
+    }
+    assert(caught);
+    caught = false;
+    try {
+        ConcurrentHashCache<int, int> empty(0);
+    }
+    catch (const invalid_argument&) {
+        caught = true;
+    }
+    assert(caught);
+}
@@ -0,0 +1,350 @@
+#pragma once
+// Корпус документов: частоты слов в каждом документе и число документов с каждым словом (для TF-IDF).
+// Слова корпуса хранятся один раз -- в словаре vocabulary, где получают номера; документы хранят только
+// разреженные векторы частот (номер слова, частота), без строк.
+//
+// Файлы читаются параллельно: каждый поток читает свою непрерывную часть документов и нумерует слова
+// в своём словаре, затем номера потоков переводятся в общие. Общие номера -- в порядке первого появления
+// слова в документах и не зависят от числа потоков
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "DictionaryLegacy.h"
+#include "ParallelLegacy.h"
+#include "ZipfLegacy.h"
+
+using namespace std;
+
+// Частота слова term в документе
+struct TermCount {
+    uint32_t term;
+    uint32_t count;
+};
+
+// Документ корпуса: имя файла, число слов и частоты слов по возрастанию номеров
+struct CorpusDocument {
+    string name;
+    size_t total_words = 0;
+    vector<TermCount> terms;
+};
+
+class Corpus {
+private:
+    // Номер слова по слову и слово по номеру
+    Dictionary<string, uint32_t> vocabulary;
+    vector<string> words;
+    // Число документов, содержащих слово, по номеру слова
+    vector<uint32_t> document_frequencies;
+    vector<CorpusDocument> documents;
+
+    // Нумерация слов части документов, прочитанной одним потоком
+    struct Part {
+        Dictionary<string, uint32_t> vocabulary;
+        vector<string> words;
+
+        Part() {
+            vocabulary.useSeededHash(wordHashAlgorithm);
+        }
+    };
+
+    // Номер слова в словаре; новое слово получает следующий номер
+    static uint32_t intern(Dictionary<string, uint32_t>& vocabulary, vector<string>& words, const string& word) {
+        const uint32_t* id = vocabulary.find(word);
+        if (id != nullptr) {
+            return *id;
+        }
+        if (words.size() == UINT32_MAX) {
+            throw length_error("Corpus vocabulary exceeds 2^32 words");
+        }
+        uint32_t term = static_cast<uint32_t>(words.size());
+        vocabulary.insert(word, term);
+        words.push_back(word);
+        return term;
+    }
+
+    // Чтение документа с номерами слов части. counts -- частоты по номерам, между документами нулевые
+    static void read_document(const string& filename, Part& part, vector<uint32_t>& counts, CorpusDocument& document) {
+        document.name = filename;
+        vector<uint32_t> seen;
+        bool opened = for_each_word(filename, [&](const string& word) {
+            uint32_t term = intern(part.vocabulary, part.words, word);
+            if (term == counts.size()) {
+                counts.push_back(0);
+            }
+            if (counts[term]++ == 0) {
+                seen.push_back(term);
+            }
+            document.total_words++;
+            });
+        if (!opened) {
+            cerr << "Файл не найден: " << filename << endl;
+        }
+        document.terms.reserve(seen.size());
+        for (uint32_t term : seen) {
+            document.terms.push_back(TermCount{ term, counts[term] });
+            counts[term] = 0;
+        }
+    }
+
+public:
+    // Слова документов хешируются со случайным ключом, как при подсчёте слов (см. wordHashAlgorithm)
+    Corpus() {
+        vocabulary.useSeededHash(wordHashAlgorithm);
+    }
+
+    // Корпус из файлов; документ i -- файл filenames[i]. Несуществующий файл -- пустой документ
+    // (с сообщением в cerr). threadCount -- число потоков чтения, 0 -- по числу ядер
+    static Corpus load_files(const vector<string>& filenames, size_t threadCount = 0) {
+        Corpus corpus;
+        corpus.documents.resize(filenames.size());
+        if (threadCount == 0) {
+            threadCount = defaultThreadCount();
+        }
+        size_t workers = max<size_t>(1, min(threadCount, filenames.size()));
+        vector<Part> parts(workers);
+        parallelRun(workers, [&](size_t t) {
+            vector<uint32_t> counts;
+            for (size_t i = partBound(filenames.size(), workers, t); i < partBound(filenames.size(), workers, t + 1); ++i) {
+                read_document(filenames[i], parts[t], counts, corpus.documents[i]);
+            }
+        });
+
+        // Общие номера: части по порядку документов, слова части -- по порядку номеров части
+        vector<vector<uint32_t>> translations(workers);
+        for (size_t t = 0; t < workers; ++t) {
+            translations[t].reserve(parts[t].words.size());
+            for (const string& word : parts[t].words) {
+                translations[t].push_back(intern(corpus.vocabulary, corpus.words, word));
+            }
+            parts[t] = Part();
+        }
+
+        parallelRun(workers, [&](size_t t) {
+            for (size_t i = partBound(filenames.size(), workers, t); i < partBound(filenames.size(), workers, t + 1); ++i) {
+                vector<TermCount>& terms = corpus.documents[i].terms;
+                for (TermCount& item : terms) {
+                    item.term = translations[t][item.term];
+                }
+                sort(terms.begin(), terms.end(), [](const TermCount& a, const TermCount& b) { return a.term < b.term; });
+            }
+        });
+
+        corpus.document_frequencies.assign(corpus.words.size(), 0);
+        for (const CorpusDocument& document : corpus.documents) {
+            for (const TermCount& item : document.terms) {
+                corpus.document_frequencies[item.term]++;
+            }
+        }
+        return corpus;
+    }
+
+    // Корпус из обычных файлов каталога и его подкаталогов в порядке путей. extension -- расширение файлов
+    // (например, ".txt"), пустое -- все файлы. Бросает исключение filesystem_error, если каталог не удалось прочитать
+    static Corpus load_directory(const string& directory, const string& extension = "", size_t threadCount = 0) {
+        vector<string> filenames;
+        for (const auto& entry : filesystem::recursive_directory_iterator(directory)) {
+            if (entry.is_regular_file() && (extension.empty() || entry.path().extension() == extension)) {
+                filenames.push_back(entry.path().string());
+            }
+        }
+        sort(filenames.begin(), filenames.end());
+        return load_files(filenames, threadCount);
+    }
+
+    size_t document_count() const {
+        return documents.size();
+    }
+
+    size_t vocabulary_size() const {
+        return words.size();
+    }
+
+    const CorpusDocument& document(size_t index) const {
+        return documents.at(index);
+    }
+
+    // Слово по номеру. Бросает исключение out_of_range при неверном номере
+    const string& word(uint32_t term) const {
+        return words.at(term);
+    }
+
+    // Номер слова или nullptr, если слова нет в корпусе
+    const uint32_t* find_term(const string& word) const {
+        return vocabulary.find(word);
+    }
+
+    // Число документов, содержащих слово
+    uint32_t document_frequency(uint32_t term) const {
+        return document_frequencies.at(term);
+    }
+
+    // Частота слова в документе
+        // Сложность: O(log n), n -- число различных слов документа
+    uint32_t term_frequency(size_t index, uint32_t term) const {
+        const vector<TermCount>& terms = documents.at(index).terms;
+        auto it = lower_bound(terms.begin(), terms.end(), term, [](const TermCount& item, uint32_t value) { return item.term < value; });
+        return it != terms.end() && it->term == term ? it->count : 0;
+    }
+
+    // Обратная документная частота: log(число документов / число документов со словом)
+    double inverse_document_frequency(uint32_t term) const {
+        uint32_t frequency = document_frequency(term);
+        return frequency == 0 ? 0.0 : log(static_cast<double>(documents.size()) / frequency);
+    }
+
+    // TF-IDF слова в документе: доля слова среди слов документа, умноженная на обратную документную частоту
+    double tf_idf(size_t index, uint32_t term) const {
+        const CorpusDocument& doc = documents.at(index);
+        if (doc.total_words == 0) {
+            return 0.0;
+        }
+        return static_cast<double>(term_frequency(index, term)) / doc.total_words * inverse_document_frequency(term);
+    }
+
+    // count слов документа с наибольшим TF-IDF по убыванию (при равенстве -- по возрастанию номера)
+    vector<KeyValuePair<string, double>> top_terms(size_t index, size_t count) const {
+        const CorpusDocument& doc = documents.at(index);
+        vector<KeyValuePair<uint32_t, double>> scores;
+        scores.reserve(doc.terms.size());
+        for (const TermCount& item : doc.terms) {
+            double idf = inverse_document_frequency(item.term);
+            scores.push_back(KeyValuePair<uint32_t, double>(item.term, static_cast<double>(item.count) / doc.total_words * idf));
+        }
+        auto better = [](const auto& a, const auto& b) {
+            return a.value > b.value || (a.value == b.value && a.key < b.key);
+        };
+        count = min(count, scores.size());
+        partial_sort(scores.begin(), scores.begin() + count, scores.end(), better);
+        vector<KeyValuePair<string, double>> result;
+        for (size_t i = 0; i < count; ++i) {
+            result.push_back(KeyValuePair<string, double>(words[scores[i].key], scores[i].value));
+        }
+        return result;
+    }
+
+    // Объём памяти в байтах: словарь, строки слов, частоты и векторы документов
+    size_t memory_usage() const {
+        size_t total = vocabulary.memory_usage() + words.capacity() * sizeof(string) + document_frequencies.capacity() * sizeof(uint32_t);
+        for (const string& word : words) {
+            total += word.capacity();
+        }
+        for (const CorpusDocument& doc : documents) {
+            total += sizeof(CorpusDocument) + doc.name.capacity() + doc.terms.capacity() * sizeof(TermCount);
+        }
+        return total;
+    }
+
+    // Хешируются ли слова словаря со случайным ключом
+    bool is_seeded() const {
+        return vocabulary.isSeeded();
+    }
+
+    static void testCorpus();
+};
+
+// Обработка каталога документов: для каждого документа в файл сохраняются topTerms слов с наибольшим TF-IDF
+// (строка «документ: слово оценка ...»). При verbose в консоль выводятся размеры корпуса
+inline void process_corpus(const string& directory, const string& dataFilename = "data.txt", size_t topTerms = 10, bool verbose = true, size_t threadCount = 0) {
+    Corpus corpus = Corpus::load_directory(directory, "", threadCount);
+    ofstream dataFile(dataFilename);
+    if (!dataFile.is_open()) {
+        cerr << "Ошибка открытия файла для записи: " << dataFilename << endl;
+        return;
+    }
+    for (size_t i = 0; i < corpus.document_count(); ++i) {
+        dataFile << corpus.document(i).name << ":";
+        for (const auto& pair : corpus.top_terms(i, topTerms)) {
+            dataFile << " " << pair.key << " " << pair.value;
+        }
+        dataFile << "\n";
+    }
+
+    if (verbose) {
+        cout << "Документов: " << corpus.document_count() << ", различных слов: " << corpus.vocabulary_size()
+            << ", память: " << corpus.memory_usage() << " байт" << endl;
+    }
+}
+
+inline void Corpus::testCorpus() {
+    filesystem::path directory = filesystem::temp_directory_path() / ("hashlegacy_corpus_test_" + to_string(reinterpret_cast<uintptr_t>(&directory)));
+    filesystem::create_directories(directory / "nested");
+    vector<string> texts = {
+        "The cat sat on the mat.",
+        "The dog sat; the DOG ran.",
+        "",
+        "A cat and a dog",
+    };
+    vector<string> filenames;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        filesystem::path path = (i == 3 ? directory / "nested" : directory) / ("doc" + to_string(i) + ".txt");
+        ofstream(path) << texts[i];
+        filenames.push_back(path.string());
+    }
+    ofstream(directory / "notes.md") << "ignored by extension";
+
+    Corpus corpus = Corpus::load_directory(directory.string(), ".txt", 2);
+    assert(corpus.document_count() == 4);
+    // Пути отсортированы: каталог nested идёт после doc0..doc2
+    assert(corpus.document(3).name == filenames[3]);
+    assert(corpus.document(0).total_words == 6 && corpus.document(2).total_words == 0);
+    // Номера -- в порядке первого появления: the, cat, sat, on, mat, dog, ran, a, and
+    assert(corpus.vocabulary_size() == 9);
+    assert(corpus.word(0) == "the" && corpus.word(5) == "dog" && corpus.word(8) == "and");
+    [[maybe_unused]] uint32_t the = *corpus.find_term("the");
+    [[maybe_unused]] uint32_t dog = *corpus.find_term("dog");
+    [[maybe_unused]] uint32_t cat = *corpus.find_term("cat");
+    assert(corpus.find_term("bird") == nullptr);
+    assert(corpus.term_frequency(0, the) == 2 && corpus.term_frequency(1, dog) == 2 && corpus.term_frequency(0, dog) == 0);
+    assert(corpus.document_frequency(the) == 2 && corpus.document_frequency(dog) == 2 && corpus.document_frequency(*corpus.find_term("mat")) == 1);
+    assert(fabs(corpus.inverse_document_frequency(cat) - log(2.0)) < 1e-12);
+    assert(fabs(corpus.tf_idf(0, *corpus.find_term("mat")) - log(4.0) / 6) < 1e-12);
+    assert(corpus.tf_idf(2, the) == 0.0);
+
+    // Векторы документов упорядочены по номерам, частоты в сумме дают число слов
+    for (size_t i = 0; i < corpus.document_count(); ++i) {
+        const CorpusDocument& doc = corpus.document(i);
+        size_t sum = 0;
+        for (size_t j = 0; j < doc.terms.size(); ++j) {
+            assert(j == 0 || doc.terms[j - 1].term < doc.terms[j].term);
+            sum += doc.terms[j].count;
+        }
+        assert(sum == doc.total_words);
+    }
+
+    vector<KeyValuePair<string, double>> top = corpus.top_terms(3, 2);
+    assert(top.size() == 2 && top[0].key == "a" && top[1].key == "and");
+    assert(corpus.top_terms(2, 5).empty());
+
+    // Результат и номера слов не зависят от числа потоков
+    for (size_t threads : { 1, 3, 8 }) {
+        Corpus other = Corpus::load_files(filenames, threads);
+        assert(other.vocabulary_size() == corpus.vocabulary_size());
+        for (uint32_t term = 0; term < corpus.vocabulary_size(); ++term) {
+            assert(other.word(term) == corpus.word(term));
+            assert(other.document_frequency(term) == corpus.document_frequency(term));
+        }
+        for (size_t i = 0; i < corpus.document_count(); ++i) {
+            assert(other.document(i).terms.size() == corpus.document(i).terms.size());
+            for ([[maybe_unused]] const TermCount& item : corpus.document(i).terms) {
+                assert(other.term_frequency(i, item.term) == item.count);
+            }
+        }
+    }
+
+    Corpus empty = Corpus::load_files({});
+    assert(empty.document_count() == 0 && empty.vocabulary_size() == 0);
+
+    // Словарь слов корпуса хешируется со случайным ключом
+    assert(corpus.is_seeded() && empty.is_seeded());
+
+    filesystem::remove_all(directory);
+    cout << "All tests passed successfully!" << endl;
+}
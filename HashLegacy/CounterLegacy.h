@@ -0,0 +1,536 @@
+#pragma once
+// Мультимножество (счётчик ключей): Counter -- ключи с кратностями в одной хеш-таблице пар (ключ, кратность),
+// ConcurrentCounter -- потокобезопасный вариант для подсчёта несколькими потоками сразу.
+// Увеличение кратности -- один проход зондирования (HashTable::findOrInsert) вместо поиска и отдельной вставки
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "HashLegacy.h"
+#include "PairLegacy.h"
+#include "ParallelLegacy.h"
+
+using namespace std;
+
+// Мультимножество: ключ -> кратность. Ключи с нулевой кратностью не хранятся.
+// Обход даёт пары KeyValuePair (key -- ключ, value -- кратность) в порядке ячеек таблицы
+template <typename T, typename Count = size_t>
+class Counter {
+public:
+    using Entry = KeyValuePair<T, Count>;
+
+private:
+    // Пары (ключ, кратность); хеш и равенство -- по ключу
+    HashTable<Entry> table;
+    // Сумма кратностей
+    Count _total;
+
+public:
+    // Конструктор мультимножества. 47 -- простое число, число ячеек по умолчанию
+    Counter(size_t capacity = 47, function<size_t(const T&)> hashFunction = HashTable<T>::defaultHash, double maxLoadFactor = 0.7)
+        : table(capacity, [hashFunction](const Entry& entry) { return hashFunction(entry.key); }, maxLoadFactor), _total() {}
+
+    // Увеличение кратности ключа на n за один проход зондирования. Возвращает новую кратность
+        // Сложность: O(1) в среднем случае
+    Count add(const T& key, Count n = 1) {
+        bool inserted = false;
+        Entry& entry = table.getListAtIndex(table.findOrInsert(Entry(key, Count()), inserted));
+        entry.value += n;
+        _total += n;
+        return entry.value;
+    }
+
+    // Уменьшение кратности ключа на n (не ниже нуля); ключ с нулевой кратностью удаляется. Возвращает новую кратность
+        // Сложность: O(1) в среднем случае
+    Count remove(const T& key, Count n = 1) {
+        size_t index = locate(key);
+        if (index == table.capacity()) {
+            return Count();
+        }
+        Entry& entry = table.getListAtIndex(index);
+        if (entry.value <= n) {
+            _total -= entry.value;
+            table.erase(Entry(key, Count()));
+            return Count();
+        }
+        entry.value -= n;
+        _total -= n;
+        return entry.value;
+    }
+
+    // Удаление ключа со всей его кратностью
+    void erase(const T& key) {
+        remove(key, count(key));
+    }
+
+    // Кратность ключа (0, если ключа нет)
+        // Сложность: O(1) в среднем случае
+    Count count(const T& key) const {
+        size_t index = locate(key);
+        return index == table.capacity() ? Count() : table.getListAtIndex(index).value;
+    }
+
+    bool contains(const T& key) const {
+        return locate(key) != table.capacity();
+    }
+
+    // Число различных ключей
+    size_t size() const {
+        return table.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Сумма кратностей всех ключей
+    Count total() const {
+        return _total;
+    }
+
+    // Резервирование места под count различных ключей без перехеширований
+    void reserve(size_t count) {
+        table.reserve(count);
+    }
+
+    void clear() {
+        table.clear();
+        _total = Count();
+    }
+
+    // Не более k ключей с наибольшими кратностями, по убыванию кратности; при равных кратностях -- по возрастанию ключа,
+    // поэтому результат не зависит от ёмкости, хеш-функции и истории вставок. Ключи должны сравниваться оператором <
+    // Сложность: O(n log k)
+    vector<Entry> most_common(size_t k) const {
+        vector<const Entry*> entries;
+        entries.reserve(size());
+        for (const Entry& entry : table) {
+            entries.push_back(&entry);
+        }
+        k = std::min(k, entries.size());
+        partial_sort(entries.begin(), entries.begin() + k, entries.end(), [](const Entry* a, const Entry* b) {
+            return a->value > b->value || (a->value == b->value && a->key < b->key);
+            });
+        vector<Entry> result;
+        result.reserve(k);
+        for (size_t i = 0; i < k; ++i) {
+            result.push_back(*entries[i]);
+        }
+        return result;
+    }
+
+    // Сумма мультимножеств: кратности складываются
+    Counter sum(const Counter& other) const {
+        Counter result = *this;
+        result += other;
+        return result;
+    }
+
+    // Пересечение мультимножеств: ключи обоих с меньшей из кратностей. Обходит меньшее мультимножество
+    Counter min(const Counter& other) const {
+        const Counter& smaller = size() <= other.size() ? *this : other;
+        const Counter& larger = size() <= other.size() ? other : *this;
+        Counter result = empty_like(smaller.size());
+        for (const Entry& entry : smaller.table) {
+            Count common = std::min(entry.value, larger.count(entry.key));
+            if (common != Count()) {
+                result.add(entry.key, common);
+            }
+        }
+        return result;
+    }
+
+    // Объединение мультимножеств: ключи любого из них с большей из кратностей
+    Counter max(const Counter& other) const {
+        Counter result = *this;
+        result.reserve(size() + other.size());
+        for (const Entry& entry : other.table) {
+            bool inserted = false;
+            Entry& stored = result.table.getListAtIndex(result.table.findOrInsert(entry, inserted));
+            if (!inserted && entry.value > stored.value) {
+                result._total += entry.value - stored.value;
+                stored.value = entry.value;
+            }
+            else if (inserted) {
+                result._total += entry.value;
+            }
+        }
+        return result;
+    }
+
+    // Сумма мультимножеств (перегрузка оператора +)
+    Counter operator+(const Counter& other) const {
+        return sum(other);
+    }
+
+    // Пересечение мультимножеств (перегрузка оператора &)
+    Counter operator&(const Counter& other) const {
+        return min(other);
+    }
+
+    // Объединение мультимножеств (перегрузка оператора |)
+    Counter operator|(const Counter& other) const {
+        return max(other);
+    }
+
+    // Сумма на месте (перегрузка оператора +=). Место резервируется один раз до вставок
+    Counter& operator+=(const Counter& other) {
+        if (this == &other) {
+            for (size_t i = 0; i < table.capacity(); ++i) {
+                if (table.isOccupied(i)) {
+                    table.getListAtIndex(i).value *= 2;
+                }
+            }
+            _total *= 2;
+            return *this;
+        }
+        reserve(size() + other.size());
+        for (const Entry& entry : other.table) {
+            add(entry.key, entry.value);
+        }
+        return *this;
+    }
+
+    // Равенство мультимножеств: те же ключи с теми же кратностями
+    bool operator==(const Counter& other) const {
+        if (size() != other.size() || total() != other.total()) {
+            return false;
+        }
+        for (const Entry& entry : table) {
+            if (other.count(entry.key) != entry.value) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const Counter& other) const {
+        return !(*this == other);
+    }
+
+    // Объём памяти мультимножества в байтах (см. HashTable::memory_usage)
+    size_t memory_usage() const {
+        return table.memory_usage() + sizeof(_total);
+    }
+
+    // Переход таблицы на хеш-функцию со случайным ключом (см. HashTable::useSeededHash)
+    void useSeededHash(KeyedAlgorithm algorithm = KeyedAlgorithm::SipHash) {
+        table.useSeededHash(algorithm);
+    }
+
+    bool isSeeded() const {
+        return table.isSeeded();
+    }
+
+    // Итераторы по парам (ключ, кратность)
+    typename HashTable<Entry>::iterator begin() const {
+        return table.begin();
+    }
+
+    typename HashTable<Entry>::iterator end() const {
+        return table.end();
+    }
+
+private:
+    // Мультимножество поверх готовой пустой таблицы
+    explicit Counter(HashTable<Entry> table) : table(std::move(table)), _total() {}
+
+    // Пустое мультимножество с тем же состоянием хеширования (см. HashTable::emptyLike), рассчитанное на expected ключей
+    Counter empty_like(size_t expected) const {
+        return Counter(table.emptyLike(static_cast<size_t>(expected / table.getMaxLoadFactor()) + 1));
+    }
+
+    // Индекс ячейки с ключом или capacity(), если ключа нет
+    size_t locate(const T& key) const {
+        return table.indexOf(Entry(key, Count()));
+    }
+
+public:
+    static void testAllMethods();
+};
+
+// Мультимножество -- другое имя счётчика
+template <typename T>
+using MultiSet = Counter<T>;
+
+// Потокобезопасный счётчик для подсчёта несколькими потоками. Ключи распределены по shardCount частям
+// (по перемешанному хешу ключа); у части своя таблица ключ -> номер счётчика и свой shared_mutex.
+// Увеличение кратности уже известного ключа берёт блокировку части на чтение и атомарно увеличивает счётчик,
+// поэтому потоки, считающие одни и те же частые ключи, не ждут друг друга. Новый ключ вставляется
+// под блокировкой части на запись. Счётчики части лежат в deque и не перемещаются при добавлении новых.
+// Чтение (count, total, collect) во время подсчёта даёт значения на какой-то момент подсчёта, а не общий снимок.
+// Поиск под блокировкой на чтение ничего не пишет в таблицу части: счётчики статистики HASHLEGACY_STATS атомарные
+template <typename T>
+class ConcurrentCounter {
+private:
+    using Entry = KeyValuePair<T, size_t>;
+
+    // Часть счётчика; выравнивание разводит блокировки частей по разным строкам кэша
+    struct alignas(64) Shard {
+        mutable shared_mutex lock;
+        // Ключ -> номер счётчика в counts
+        HashTable<Entry> index;
+        deque<atomic<size_t>> counts;
+
+        Shard(size_t capacity, function<size_t(const Entry&)> hashFunction) : index(capacity, hashFunction) {}
+    };
+
+    function<size_t(const T&)> hashFunction;
+    vector<unique_ptr<Shard>> shards;
+
+    // Часть ключа с хешем hashValue. Перемешивание развязывает выбор части и ячейку в таблице части
+    Shard& shardOf(size_t hashValue) const {
+        return *shards[mixHash(hashValue) % shards.size()];
+    }
+
+public:
+    // shardCount -- число частей (0 -- по четыре на аппаратный поток), capacity -- начальная ёмкость всего счётчика
+    explicit ConcurrentCounter(size_t shardCount = 0, size_t capacity = 1024, function<size_t(const T&)> hashFunction = HashTable<T>::defaultHash)
+        : hashFunction(hashFunction) {
+        if (shardCount == 0) {
+            shardCount = 4 * defaultThreadCount();
+        }
+        function<size_t(const Entry&)> entryHash = [hashFunction](const Entry& entry) { return hashFunction(entry.key); };
+        for (size_t i = 0; i < shardCount; ++i) {
+            shards.push_back(make_unique<Shard>(std::max<size_t>(capacity / shardCount, 8), entryHash));
+        }
+    }
+
+    // Увеличение кратности ключа на n. Безопасно вызывать из нескольких потоков. Возвращает новую кратность
+        // Сложность: O(1) в среднем случае
+    size_t add(const T& key, size_t n = 1) {
+        size_t hashValue = hashFunction(key);
+        Shard& shard = shardOf(hashValue);
+        Entry probe(key, 0);
+        {
+            shared_lock<shared_mutex> guard(shard.lock);
+            size_t slot = shard.index.indexOf(probe, hashValue);
+            if (slot < shard.index.capacity()) {
+                return shard.counts[as_const(shard.index).getListAtIndex(slot).value].fetch_add(n, memory_order_relaxed) + n;
+            }
+        }
+        // Ключа нет: вставка под блокировкой на запись (другой поток мог вставить его раньше)
+        unique_lock<shared_mutex> guard(shard.lock);
+        probe.value = shard.counts.size();
+        bool inserted = false;
+        size_t slot = shard.index.findOrInsert(std::move(probe), inserted);
+        if (inserted) {
+            shard.counts.emplace_back(0);
+        }
+        return shard.counts[shard.index.getListAtIndex(slot).value].fetch_add(n, memory_order_relaxed) + n;
+    }
+
+    // Кратность ключа (0, если ключа нет)
+    size_t count(const T& key) const {
+        size_t hashValue = hashFunction(key);
+        const Shard& shard = shardOf(hashValue);
+        shared_lock<shared_mutex> guard(shard.lock);
+        size_t slot = shard.index.indexOf(Entry(key, 0), hashValue);
+        return slot < shard.index.capacity() ? shard.counts[shard.index.getListAtIndex(slot).value].load(memory_order_relaxed) : 0;
+    }
+
+    // Число различных ключей
+    size_t size() const {
+        size_t result = 0;
+        for (const auto& shard : shards) {
+            shared_lock<shared_mutex> guard(shard->lock);
+            result += shard->counts.size();
+        }
+        return result;
+    }
+
+    // Сумма кратностей
+    size_t total() const {
+        size_t result = 0;
+        for (const auto& shard : shards) {
+            shared_lock<shared_mutex> guard(shard->lock);
+            for (const atomic<size_t>& counter : shard->counts) {
+                result += counter.load(memory_order_relaxed);
+            }
+        }
+        return result;
+    }
+
+    size_t shardCount() const {
+        return shards.size();
+    }
+
+    // Сумма статистики таблиц частей. Без HASHLEGACY_STATS все счётчики нулевые
+    HashTableStats getStats() const {
+        HashTableStats result;
+        for (const auto& shard : shards) {
+            shared_lock<shared_mutex> guard(shard->lock);
+            result += shard->index.getStats();
+        }
+        return result;
+    }
+
+    // Обычный счётчик с теми же ключами и кратностями (для most_common и операций над мультимножествами)
+    Counter<T> collect() const {
+        Counter<T> result(2 * size() + 1, hashFunction);
+        for (const auto& shard : shards) {
+            shared_lock<shared_mutex> guard(shard->lock);
+            for (const Entry& entry : shard->index) {
+                result.add(entry.key, shard->counts[entry.value].load(memory_order_relaxed));
+            }
+        }
+        return result;
+    }
+
+    // Объём памяти в байтах: таблицы и счётчики частей
+    size_t memory_usage() const {
+        size_t result = sizeof(*this) + shards.capacity() * sizeof(unique_ptr<Shard>);
+        for (const auto& shard : shards) {
+            shared_lock<shared_mutex> guard(shard->lock);
+            result += sizeof(Shard) - sizeof(shard->index) + shard->index.memory_usage() + shard->counts.size() * sizeof(atomic<size_t>);
+        }
+        return result;
+    }
+
+    static void testAllMethods();
+};
+
+template <typename T, typename Count>
+void Counter<T, Count>::testAllMethods() {
+    Counter<string> words(4);
+    assert(words.empty() && words.count("a") == 0);
+
+    // Увеличение и уменьшение кратностей
+    assert(words.add("a") == 1);
+    assert(words.add("a", 4) == 5);
+    assert(words.add("b", 2) == 2);
+    words.add("c");
+    assert(words.size() == 3 && words.total() == 8 && words.count("a") == 5);
+    assert(words.remove("a", 2) == 3 && words.total() == 6);
+    assert(words.remove("c", 10) == 0 && !words.contains("c") && words.size() == 2 && words.total() == 5);
+    assert(words.remove("missing") == 0 && words.total() == 5);
+    words.erase("b");
+    assert(!words.contains("b") && words.total() == 3);
+
+    // Рост таблицы не теряет кратностей
+    Counter<int> numbers(4);
+    for (int i = 0; i < 1000; i++) {
+        for (int j = 0; j <= i % 10; j++) {
+            numbers.add(i);
+        }
+    }
+    assert(numbers.size() == 1000 && numbers.total() == 5500);
+    for (int i = 0; i < 1000; i++) {
+        assert(numbers.count(i) == static_cast<size_t>(i % 10 + 1));
+    }
+
+    // Самые частые ключи
+    Counter<string> letters;
+    letters.add("x", 7);
+    letters.add("y", 3);
+    letters.add("z", 9);
+    letters.add("w", 1);
+    vector<Counter<string>::Entry> top = letters.most_common(3);
+    assert(top.size() == 3 && top[0].key == "z" && top[1].key == "x" && top[2].key == "y" && top[2].value == 3);
+    assert(letters.most_common(10).size() == 4 && letters.most_common(0).empty());
+    // Равные кратности -- по возрастанию ключа: 100 ключей с кратностью 10 (9, 19, ...), затем с кратностью 9 (8, 18, ...).
+    // Счётчик с другой ёмкостью и обратным порядком вставок даёт тот же результат
+    vector<Counter<int>::Entry> topNumbers = numbers.most_common(150);
+    assert(topNumbers.size() == 150);
+    for (size_t i = 0; i < topNumbers.size(); i++) {
+        assert(topNumbers[i].key == static_cast<int>(i < 100 ? i * 10 + 9 : (i - 100) * 10 + 8));
+    }
+    Counter<int> reversed(4096);
+    for (int i = 999; i >= 0; i--) {
+        reversed.add(i, i % 10 + 1);
+    }
+    vector<Counter<int>::Entry> reversedTop = reversed.most_common(150);
+    for (size_t i = 0; i < reversedTop.size(); i++) {
+        assert(reversedTop[i].key == topNumbers[i].key && reversedTop[i].value == topNumbers[i].value);
+    }
+
+    // Алгебра мультимножеств
+    Counter<string> first;
+    first.add("a", 3);
+    first.add("b", 1);
+    Counter<string> second;
+    second.add("a", 1);
+    second.add("b", 4);
+    second.add("c", 2);
+    Counter<string> sum = first + second;
+    assert(sum.count("a") == 4 && sum.count("b") == 5 && sum.count("c") == 2 && sum.total() == 11);
+    Counter<string> common = first & second;
+    assert(common.count("a") == 1 && common.count("b") == 1 && !common.contains("c") && common.total() == 2);
+    Counter<string> either = first | second;
+    assert(either.count("a") == 3 && either.count("b") == 4 && either.count("c") == 2 && either.total() == 9);
+    assert((first & second) == (second & first) && (first | second) == (second | first));
+    assert(first + second != first);
+    Counter<string> doubled = first;
+    doubled += doubled;
+    assert(doubled.count("a") == 6 && doubled.total() == 8);
+
+    // Смена хеш-функции сохраняет кратности
+    numbers.useSeededHash(KeyedAlgorithm::WyHash);
+    assert(numbers.count(999) == 10 && numbers.total() == 5500);
+    // Пересечение сохраняет случайный ключ хеширования
+    Counter<int> evens;
+    for (int i = 0; i < 2000; i += 2) {
+        evens.add(i, 3);
+    }
+    [[maybe_unused]] Counter<int> common = numbers & evens;
+    assert(common.isSeeded() && common.size() == 500 && common.count(8) == 3 && common.count(2) == 3 && common.count(9) == 0);
+    assert(!(evens & evens).isSeeded());
+
+    numbers.clear();
+    assert(numbers.empty() && numbers.total() == 0);
+
+    ConcurrentCounter<string>::testAllMethods();
+
+    cout << "All tests passed successfully!" << endl;
+}
+
+template <typename T>
+void ConcurrentCounter<T>::testAllMethods() {
+    // Потоки считают пересекающиеся наборы слов: частые слова у всех общие, редкие -- у каждого свои
+    ConcurrentCounter<string> counter(8, 16);
+    const size_t threads = 4;
+    parallelRun(threads, [&](size_t t) {
+        for (int round = 0; round < 200; round++) {
+            counter.add("common");
+            counter.add("w" + to_string(round % 50), 2);
+            counter.add("t" + to_string(t) + "_" + to_string(round));
+        }
+    });
+    assert(counter.count("common") == 800);
+    assert(counter.count("w7") == 4 * 2 * 4);
+    assert(counter.count("t3_199") == 1 && counter.count("t4_0") == 0);
+    assert(counter.size() == 1 + 50 + 4 * 200);
+    assert(counter.total() == 4 * 200 * 4);
+
+    // Перенос в обычный счётчик
+    Counter<string> collected = counter.collect();
+    assert(collected.size() == counter.size() && collected.total() == counter.total());
+    vector<Counter<string>::Entry> top = collected.most_common(1);
+    assert(top[0].key == "common" && top[0].value == 800);
+    assert(counter.shardCount() == 8 && counter.memory_usage() > 0);
+
+#ifdef HASHLEGACY_STATS
+    // Потоки увеличивают одни и те же ключи: поиски под блокировкой на чтение идут в одной части одновременно,
+    // и ни одно увеличение счётчиков статистики не теряется
+    ConcurrentCounter<int> hot(2, 16);
+    parallelRun(threads, [&](size_t) {
+        for (int i = 0; i < 5000; i++) {
+            hot.add(i % 10);
+        }
+    });
+    HashTableStats hotStats = hot.getStats();
+    assert(hotStats.lookups == threads * 5000);
+    assert(hotStats.inserts >= 10);
+    for (int key = 0; key < 10; key++) {
+        assert(hot.count(key) == threads * 500);
+    }
+#endif
+}
@@ -0,0 +1,766 @@
+#pragma once
+// Кукушкина хеш-таблица с корзинами на 4 ключа: вариант HashTable с ограниченным временем поиска.
+// У каждого ключа две корзины -- по одной от каждой из двух хеш-функций, -- и ключ лежит в одной из них
+// или в небольшом запасном списке (stash). Поиск читает не больше двух корзин и запасной список
+// при любых коллизиях, тогда как у линейного зондирования цепочка может пройти всю таблицу.
+// При вставке в заполненные корзины ключи перекладываются в их другие корзины по кратчайшему
+// пути вытеснений, найденному поиском в ширину
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "HashLegacy.h"
+#include "StatsLegacy.h"
+
+using namespace std;
+
+template <typename Key>
+class CuckooHashTable {
+public:
+    // Ключей в корзине
+    static constexpr size_t bucketSize = 4;
+    // Наибольший размер запасного списка
+    static constexpr size_t stashSize = 4;
+    // Наибольшее число корзин, просматриваемых поиском пути вытеснений
+    static constexpr size_t maxPathSearch = 256;
+    // Коэффициент загрузки, ниже которого ключи, не поместившиеся в корзины, считаются неразличимыми для хеш-функций
+    static constexpr double minSeparableLoad = 0.125;
+
+private:
+    // Размер корзины без выравнивания и её выравнивание: корзина до 64 байт выравнивается по наименьшей
+    // вмещающей её степени двойки и целиком лежит в одной строке кэша, большая -- по строке кэша
+    static constexpr size_t bucketBytes = ((bucketSize + alignof(Key) - 1) / alignof(Key)) * alignof(Key) + bucketSize * sizeof(Key);
+    static constexpr size_t bucketAlignment() {
+        size_t alignment = alignof(Key) > 8 ? alignof(Key) : 8;
+        while (alignment < bucketBytes && alignment < 64) {
+            alignment *= 2;
+        }
+        return alignment;
+    }
+
+    // Корзина: метки ключей (0 -- свободный ключ) и сами ключи. Метка -- старший байт первого хеша,
+    // по ней отсеиваются несовпадающие ключи без их сравнения. Метки лежат в начале корзины, поэтому
+    // поиск отсутствующего ключа читает одну строку кэша на корзину и при больших ключах (std::string),
+    // а ключ читается только при совпадении метки
+    struct alignas(bucketAlignment()) Bucket {
+        uint8_t tags[bucketSize];
+        Key keys[bucketSize];
+
+        Bucket() : tags{}, keys() {}
+    };
+    static_assert(sizeof(Key) > 8 || sizeof(Bucket) <= 64, "A bucket of small keys must fit one cache line");
+
+    // Корзины и запасной список
+    vector<Bucket> buckets;
+    vector<Key> stash;
+    // Первая и вторая хеш-функции
+    function<size_t(const Key&)> hashFunction;
+    function<size_t(const Key&)> secondHashFunction;
+    // Количество ключей в таблице
+    size_t _size;
+    // Коэффициент загрузки -- доля занятых ключей в корзинах
+    double loadFactor;
+    // Максимальный коэффициент загрузки
+    double maxLoadFactor;
+    // Минимальный коэффициент загрузки
+    double minLoadFactor;
+#ifdef HASHLEGACY_STATS
+    // Статистика операций и обработчик трассировки
+    mutable HashTableCounters stats;
+    TraceHook traceHook;
+#endif
+
+    // Расположение ключа: две корзины и метка
+    struct Place {
+        size_t first;
+        size_t second;
+        uint8_t tag;
+    };
+
+public:
+    // Хеш-функции по умолчанию: две независимые функции семейства HashLegacy.h
+    static size_t defaultHash(const Key& value) {
+        return fnv1aHash(value);
+    }
+
+    static size_t defaultSecondHash(const Key& value) {
+        return murmurHash(value);
+    }
+
+    // Конструктор таблицы на capacity ключей. Корзины на 4 ключа выдерживают загрузку выше 0.9
+    CuckooHashTable(size_t capacity, function<size_t(const Key&)> hashFunction = defaultHash, double maxLoadFactor = 0.9, double minLoadFactor = 0.2,
+        function<size_t(const Key&)> secondHashFunction = defaultSecondHash)
+        : buckets(max<size_t>((capacity + bucketSize - 1) / bucketSize, 1)), hashFunction(hashFunction), secondHashFunction(secondHashFunction),
+          _size(0), loadFactor(0.0), maxLoadFactor(maxLoadFactor), minLoadFactor(minLoadFactor) {
+        stash.reserve(stashSize);
+        HASHLEGACY_STATS_ONLY(stats.peakBytes = memory_usage();)
+    }
+
+    // Вставка ключа в таблицу. Ключ не проверяется на наличие в таблице.
+    // Бросает исключение runtime_error, если хеш-функции не различают ключей (корзины и запасной список
+    // заполнены при почти пустой таблице) -- увеличение таблицы в этом случае не помогает
+        // Сложность: O(1) в среднем случае
+    void insert(const Key& key) {
+        Place place = locate(key);
+        ProbeCounter counter;
+        add(key, place, counter);
+        record(TraceOperation::Insert, place, counter, true);
+    }
+
+    // Вставка ключа, если его ещё нет в таблице. Возвращает true, если ключ был вставлен
+        // Сложность: O(1) в среднем случае
+    bool insertUnique(const Key& key) {
+        Place place = locate(key);
+        ProbeCounter counter;
+        if (find(key, place, counter) < capacity()) {
+            record(TraceOperation::Insert, place, counter, false);
+            return false;
+        }
+        add(key, place, counter);
+        record(TraceOperation::Insert, place, counter, true);
+        return true;
+    }
+
+    // Пакетная вставка диапазона ключей без дубликатов. Место резервируется один раз; вставка последовательная.
+    // Возвращает число вставленных ключей
+    template <typename Iterator>
+    size_t insertUniqueBulk(Iterator first, Iterator last, size_t threadCount = 0) {
+        (void)threadCount;
+        size_t before = _size;
+        reserve(_size + static_cast<size_t>(last - first));
+        for (; first != last; ++first) {
+            insertUnique(*first);
+        }
+        return _size - before;
+    }
+
+    //Функция хэширования через первую функцию хэш-таблицы
+    size_t hash(const Key& key) const {
+        return hashFunction(key);
+    }
+
+    // Поиск индекса ячейки с ключом. Ячейки корзин -- [0, bucketCount() * bucketSize),
+    // за ними -- ячейки запасного списка. Возвращает capacity(), если ключ не найден
+        // Сложность: O(1)
+    size_t indexOf(const Key& key) const {
+        Place place = locate(key);
+        ProbeCounter counter;
+        size_t index = find(key, place, counter);
+        record(TraceOperation::Find, place, counter, index < capacity());
+        return index;
+    }
+
+    // Удаление ключа из таблицы
+        // Сложность: O(1), перехеширование при загрузке ниже минимальной -- O(n)
+    void erase(const Key& key) {
+        Place place = locate(key);
+        ProbeCounter counter;
+        size_t index = find(key, place, counter);
+        record(TraceOperation::Erase, place, counter, index < capacity());
+        if (index == capacity()) {
+            return;
+        }
+
+        if (index < slotCount()) {
+            Bucket& bucket = buckets[index / bucketSize];
+            bucket.tags[index % bucketSize] = 0;
+            bucket.keys[index % bucketSize] = Key();
+        }
+        else {
+            size_t position = index - slotCount();
+            if (position + 1 != stash.size()) {
+                stash[position] = std::move(stash.back());
+            }
+            stash.pop_back();
+        }
+        _size--;
+        loadFactor = (double)_size / slotCount();
+
+        if (loadFactor < minLoadFactor && buckets.size() > 1) {
+            rehash();
+        }
+        else if (index < slotCount()) {
+            drainStash();
+        }
+    }
+
+    // Проверка наличия ключа в таблице
+        // Сложность: O(1)
+    bool contains(const Key& key) const {
+        Place place = locate(key);
+        ProbeCounter counter;
+        bool found = find(key, place, counter) < capacity();
+        record(TraceOperation::Contains, place, counter, found);
+        return found;
+    }
+
+    //Получить значение ячейки по индексу. Свободная ячейка корзины содержит Key().
+    //Бросает исключение out_of_range, если индекс указан неверно или ячейка запасного списка свободна
+    const Key& getListAtIndex(size_t index) const {
+        checkReadable(index);
+        return index < slotCount() ? buckets[index / bucketSize].keys[index % bucketSize] : stash[index - slotCount()];
+    }
+
+    //Получить значение ячейки по индексу. Свободная ячейка корзины содержит Key().
+    //Бросает исключение out_of_range, если индекс указан неверно или ячейка запасного списка свободна
+    Key& getListAtIndex(size_t index) {
+        checkReadable(index);
+        return index < slotCount() ? buckets[index / bucketSize].keys[index % bucketSize] : stash[index - slotCount()];
+    }
+
+    //Получить занятость ячейки по индексу. Бросает исключение out_of_range, если индекс указан неверно
+    bool isOccupied(size_t index) const {
+        if (index >= capacity()) {
+            throw out_of_range("Index out of range");
+        }
+        return slotOccupied(index);
+    }
+
+    // Перехеширование: увеличение вдвое при превышении максимального коэффициента загрузки, иначе уменьшение вдвое
+    void rehash() {
+        if (loadFactor > maxLoadFactor) {
+            rebuild(buckets.size() * 2);
+        }
+        else {
+            rebuild(buckets.size() / 2);
+        }
+    }
+
+    // Резервирование места под count ключей без перехеширований.
+    // Бросает исключение runtime_error, если хеш-функции не различают ключей (см. insert)
+    void reserve(size_t count) {
+        size_t needed = bucketsFor(count);
+        if (needed > buckets.size()) {
+            rebuild(needed);
+        }
+    }
+
+    // Сжатие таблицы под текущее число ключей, если коэффициент загрузки опустился ниже минимального
+    void shrinkToFit() {
+        if (loadFactor < minLoadFactor) {
+            rebuild(bucketsFor(_size));
+        }
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    // Число ячеек: ячейки всех корзин и запасного списка
+    size_t capacity() const {
+        return slotCount() + stashSize;
+    }
+
+    size_t bucketCount() const {
+        return buckets.size();
+    }
+
+    // Объём памяти таблицы в байтах: сам объект, корзины и запасной список
+    size_t memory_usage() const {
+        return sizeof(*this) + buckets.capacity() * sizeof(Bucket) + stash.capacity() * sizeof(Key);
+    }
+
+    //Хеш-функция таблицы
+    const function<size_t(const Key&)>& getHashFunction() const {
+        return hashFunction;
+    }
+
+    //Вторая хеш-функция таблицы
+    const function<size_t(const Key&)>& getSecondHashFunction() const {
+        return secondHashFunction;
+    }
+
+    //Максимальный коэффициент загрузки
+    double getMaxLoadFactor() const {
+        return maxLoadFactor;
+    }
+
+    //Минимальный коэффициент загрузки
+    double getMinLoadFactor() const {
+        return minLoadFactor;
+    }
+
+    // Накопленная статистика операций. Шаг зондирования -- чтение второй корзины или запасного списка.
+    // Без HASHLEGACY_STATS все счётчики нулевые
+    HashTableStats getStats() const {
+#ifdef HASHLEGACY_STATS
+        return stats.snapshot();
+#else
+        return HashTableStats();
+#endif
+    }
+
+    // Сброс статистики
+    void resetStats() {
+        HASHLEGACY_STATS_ONLY(stats = HashTableCounters(); stats.peakBytes = memory_usage();)
+    }
+
+    // Установка обработчика трассировки, вызываемого после каждой операции. Без HASHLEGACY_STATS не вызывается
+    void setTraceHook(TraceHook hook) {
+#ifdef HASHLEGACY_STATS
+        traceHook = hook;
+#else
+        (void)hook;
+#endif
+    }
+
+    // Итератор по занятым ячейкам таблицы
+    class iterator {
+    private:
+        const CuckooHashTable* owner;
+        size_t index;
+
+        void skipFree() {
+            while (index < owner->capacity() && !owner->slotOccupied(index)) {
+                ++index;
+            }
+        }
+
+    public:
+        iterator(const CuckooHashTable* owner, size_t index) : owner(owner), index(index) {
+            skipFree();
+        }
+
+        iterator& operator++() {
+            ++index;
+            skipFree();
+            return *this;
+        }
+
+        const Key& operator*() const {
+            return owner->getListAtIndex(index);
+        }
+
+        const Key* operator->() const {
+            return &owner->getListAtIndex(index);
+        }
+
+        bool operator==(const iterator& other) const {
+            return index == other.index;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return index != other.index;
+        }
+    };
+
+    //Итератор на начало таблицы
+    iterator begin() const {
+        return iterator(this, 0);
+    }
+    //Итератор на конец таблицы
+    iterator end() const {
+        return iterator(this, capacity());
+    }
+
+    // Метод очистки таблицы
+    void clear() {
+        buckets.assign(buckets.size(), Bucket());
+        stash.clear();
+        _size = 0;
+        loadFactor = 0.0;
+    }
+
+private:
+    size_t slotCount() const {
+        return buckets.size() * bucketSize;
+    }
+
+    bool slotOccupied(size_t index) const {
+        if (index < slotCount()) {
+            return buckets[index / bucketSize].tags[index % bucketSize] != 0;
+        }
+        return index - slotCount() < stash.size();
+    }
+
+    // Число корзин, в которые count ключей помещаются без превышения максимальной загрузки
+    size_t bucketsFor(size_t count) const {
+        return static_cast<size_t>(count / maxLoadFactor / bucketSize) + 1;
+    }
+
+    // Корзины и метка ключа. Хеши перемешиваются, чтобы номера корзин зависели от всех битов хеша
+    Place locate(const Key& key) const {
+        uint64_t first = mixHash(hashFunction(key));
+        uint64_t second = mixHash(secondHashFunction(key));
+        uint8_t tag = static_cast<uint8_t>(first >> 56);
+        return Place{ static_cast<size_t>(first % buckets.size()), static_cast<size_t>(second % buckets.size()), static_cast<uint8_t>(tag == 0 ? 1 : tag) };
+    }
+
+    // Поиск ключа в корзине. Возвращает номер ячейки в корзине или bucketSize
+    size_t findInBucket(const Key& key, size_t bucketIndex, uint8_t tag, ProbeCounter& counter) const {
+        const Bucket& bucket = buckets[bucketIndex];
+        for (size_t slot = 0; slot < bucketSize; ++slot) {
+            if (bucket.tags[slot] == tag) {
+                counter.compare();
+                if (bucket.keys[slot] == key) {
+                    return slot;
+                }
+            }
+        }
+        return bucketSize;
+    }
+
+    // Поиск ключа: первая корзина, вторая корзина, запасной список. Возвращает индекс ячейки или capacity()
+    size_t find(const Key& key, const Place& place, ProbeCounter& counter) const {
+        size_t slot = findInBucket(key, place.first, place.tag, counter);
+        if (slot < bucketSize) {
+            return place.first * bucketSize + slot;
+        }
+        counter.step();
+        slot = findInBucket(key, place.second, place.tag, counter);
+        if (slot < bucketSize) {
+            return place.second * bucketSize + slot;
+        }
+        if (!stash.empty()) {
+            counter.step();
+            for (size_t i = 0; i < stash.size(); ++i) {
+                counter.compare();
+                if (stash[i] == key) {
+                    return slotCount() + i;
+                }
+            }
+        }
+        return capacity();
+    }
+
+    // Свободная ячейка корзины или bucketSize
+    size_t freeSlot(size_t bucketIndex) const {
+        const Bucket& bucket = buckets[bucketIndex];
+        for (size_t slot = 0; slot < bucketSize; ++slot) {
+            if (bucket.tags[slot] == 0) {
+                return slot;
+            }
+        }
+        return bucketSize;
+    }
+
+    // Вторая корзина ключа, лежащего в корзине bucketIndex
+    size_t alternate(const Key& key, size_t bucketIndex) const {
+        Place place = locate(key);
+        return place.first == bucketIndex ? place.second : place.first;
+    }
+
+    // Размещение ключа в корзинах без перехеширования: свободная ячейка одной из двух корзин,
+    // иначе кратчайший путь вытеснений до корзины со свободной ячейкой, иначе запасной список.
+    // Возвращает false, если места нет
+    bool put(const Key& key, const Place& place, ProbeCounter& counter) {
+        for (size_t bucketIndex : { place.first, place.second }) {
+            size_t slot = freeSlot(bucketIndex);
+            if (slot < bucketSize) {
+                buckets[bucketIndex].tags[slot] = place.tag;
+                buckets[bucketIndex].keys[slot] = key;
+                return true;
+            }
+        }
+
+        // Поиск в ширину по корзинам: из корзины можно вытеснить любой из её ключей в его другую корзину.
+        // Каждая корзина входит в дерево поиска один раз, поэтому ячейки пути не повторяются
+        struct PathNode {
+            size_t bucket;
+            size_t parent;
+            size_t slot;
+        };
+        const size_t root = SIZE_MAX;
+        vector<PathNode> nodes;
+        nodes.push_back(PathNode{ place.first, root, 0 });
+        if (place.second != place.first) {
+            nodes.push_back(PathNode{ place.second, root, 0 });
+        }
+        for (size_t head = 0; head < nodes.size() && nodes.size() < maxPathSearch; ++head) {
+            for (size_t slot = 0; slot < bucketSize; ++slot) {
+                size_t next = alternate(buckets[nodes[head].bucket].keys[slot], nodes[head].bucket);
+                bool visited = false;
+                for (const PathNode& node : nodes) {
+                    visited = visited || node.bucket == next;
+                }
+                if (visited) {
+                    continue;
+                }
+                counter.step();
+                nodes.push_back(PathNode{ next, head, slot });
+                size_t free = freeSlot(next);
+                if (free == bucketSize) {
+                    continue;
+                }
+                // Перекладываем ключи с конца пути: каждый ключ занимает ячейку, освобождённую предыдущим
+                size_t node = nodes.size() - 1;
+                while (nodes[node].parent != root) {
+                    Bucket& from = buckets[nodes[nodes[node].parent].bucket];
+                    Bucket& to = buckets[nodes[node].bucket];
+                    to.tags[free] = from.tags[nodes[node].slot];
+                    to.keys[free] = std::move(from.keys[nodes[node].slot]);
+                    free = nodes[node].slot;
+                    node = nodes[node].parent;
+                }
+                buckets[nodes[node].bucket].tags[free] = place.tag;
+                buckets[nodes[node].bucket].keys[free] = key;
+                return true;
+            }
+        }
+
+        if (stash.size() < stashSize) {
+            stash.push_back(key);
+            return true;
+        }
+        return false;
+    }
+
+    // Вставка с увеличением таблицы, если места нет
+    void add(const Key& key, Place& place, ProbeCounter& counter) {
+        if ((double)(_size + 1) / slotCount() > maxLoadFactor) {
+            rebuild(buckets.size() * 2);
+            place = locate(key);
+        }
+        while (!put(key, place, counter)) {
+            if (loadFactor < minSeparableLoad) {
+                throw runtime_error("Hash functions do not separate keys");
+            }
+            rebuild(buckets.size() * 2);
+            place = locate(key);
+        }
+        _size++;
+        loadFactor = (double)_size / slotCount();
+    }
+
+    // Попытка перенести ключи запасного списка в корзины после освобождения места
+    void drainStash() {
+        if (stash.empty()) {
+            return;
+        }
+        vector<Key> pending = std::move(stash);
+        stash.clear();
+        stash.reserve(stashSize);
+        for (const Key& key : pending) {
+            ProbeCounter counter;
+            put(key, locate(key), counter);
+        }
+    }
+
+    // Перенос ключей старых корзин и запасного списка в count пустых корзин.
+    // Возвращает false, если ключи не поместились
+    bool placeAll(const vector<Bucket>& oldBuckets, const vector<Key>& oldStash, size_t count) {
+        buckets.assign(count, Bucket());
+        stash.clear();
+        for (const Bucket& bucket : oldBuckets) {
+            for (size_t slot = 0; slot < bucketSize; ++slot) {
+                ProbeCounter counter;
+                if (bucket.tags[slot] != 0 && !put(bucket.keys[slot], locate(bucket.keys[slot]), counter)) {
+                    return false;
+                }
+            }
+        }
+        for (const Key& key : oldStash) {
+            ProbeCounter counter;
+            if (!put(key, locate(key), counter)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Перестройка таблицы под новое число корзин. Если ключи не помещаются, число корзин удваивается, пока
+    // коэффициент загрузки не опустится ниже minSeparableLoad; тогда таблица остаётся прежней. Уменьшение таблицы
+    // на этом заканчивается, а увеличение бросает исключение runtime_error, как add
+    void rebuild(size_t newBucketCount) {
+        HASHLEGACY_STATS_ONLY(auto started = chrono::steady_clock::now(); size_t oldBytes = memory_usage();)
+        bool growing = newBucketCount >= buckets.size();
+        vector<Bucket> oldBuckets = std::move(buckets);
+        vector<Key> oldStash = std::move(stash);
+        stash.reserve(stashSize);
+
+        newBucketCount = max(newBucketCount, bucketsFor(_size));
+        while (!placeAll(oldBuckets, oldStash, newBucketCount)) {
+            newBucketCount *= 2;
+            if ((double)_size / (newBucketCount * bucketSize) < minSeparableLoad) {
+                buckets = std::move(oldBuckets);
+                stash = std::move(oldStash);
+                if (!growing) {
+                    return;
+                }
+                throw runtime_error("Hash functions do not separate keys");
+            }
+        }
+        loadFactor = (double)_size / slotCount();
+
+#ifdef HASHLEGACY_STATS
+        long long nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+        stats.peakBytes.raise(oldBytes + memory_usage());
+        stats.rehashes++;
+        stats.rehashNanoseconds += nanoseconds;
+        if (traceHook) {
+            traceHook(TraceEvent{ TraceOperation::Rehash, 0, 0, 0, false, capacity(), nanoseconds });
+        }
+#endif
+    }
+
+    // Проверка индекса для getListAtIndex
+    void checkReadable(size_t index) const {
+        if (index >= capacity()) {
+            throw out_of_range("Index out of range");
+        }
+        if (index >= slotCount() && !slotOccupied(index)) {
+            throw out_of_range("Slot is empty");
+        }
+    }
+
+    // Учёт операции в статистике и передача события обработчику трассировки. Без HASHLEGACY_STATS пуст
+    void record(TraceOperation operation, const Place& place, const ProbeCounter& counter, bool found) const {
+#ifdef HASHLEGACY_STATS
+        stats.record(operation, counter);
+        if (traceHook) {
+            traceHook(TraceEvent{ operation, place.first, counter.probes, counter.comparisons, found, capacity(), 0 });
+        }
+#else
+        (void)operation;
+        (void)place;
+        (void)counter;
+        (void)found;
+#endif
+    }
+
+public:
+    static void testAllMethods() {
+        CuckooHashTable<int> table(10);
+        for (int i = 0; i < 10000; i++) {
+            assert(table.insertUnique(i));
+        }
+        assert(!table.insertUnique(5000));
+        assert(table.size() == 10000);
+        for (int i = 0; i < 10000; i++) {
+            assert(table.contains(i));
+        }
+        assert(!table.contains(-1));
+        assert(table.indexOf(-1) == table.capacity());
+        assert(table.getListAtIndex(table.indexOf(1234)) == 1234);
+
+        // Корзины на 4 ключа заполняются плотнее, чем таблица с линейным зондированием
+        CuckooHashTable<int> dense(1000, defaultHash, 0.95);
+        for (int i = 0; i < 950; i++) {
+            dense.insert(i);
+        }
+        assert(dense.capacity() - stashSize == 1000);
+        for (int i = 0; i < 950; i++) {
+            assert(dense.contains(i));
+        }
+        // Каждая корзина лежит в одной строке кэша: поиск читает не больше двух строк и запасной список
+        for (const Bucket& bucket : dense.buckets) {
+            size_t offset = reinterpret_cast<uintptr_t>(&bucket) % 64;
+            assert(offset % bucketAlignment() == 0 && offset + sizeof(Bucket) <= 64);
+        }
+
+        for (int i = 0; i < 10000; i += 2) {
+            table.erase(i);
+        }
+        assert(table.size() == 5000);
+        for (int i = 0; i < 10000; i++) {
+            assert(table.contains(i) == (i % 2 == 1));
+        }
+        size_t count = 0;
+        for (int key : table) {
+            assert(key % 2 == 1);
+            count++;
+        }
+        assert(count == 5000);
+
+        // Перехеширование при удалении почти всех ключей
+        size_t buckets = table.bucketCount();
+        for (int i = 1; i < 9000; i += 2) {
+            table.erase(i);
+        }
+        assert(table.bucketCount() < buckets);
+        assert(table.size() == 500);
+        assert(table.contains(9999));
+
+        // Первая хеш-функция с постоянным значением (как в тесте HashTable): ключи различает вторая функция,
+        // и поиск по-прежнему читает не больше двух корзин
+        CuckooHashTable<int> collisions(100, k0syakHash<int>);
+        for (int i = 0; i < 200; i++) {
+            collisions.insert(i * 7);
+        }
+        for (int i = 0; i < 200; i++) {
+            assert(collisions.contains(i * 7));
+            assert(!collisions.contains(i * 7 + 1));
+        }
+
+        // Обе функции постоянны: 4 ключа в корзине и 4 в запасном списке, дальше таблица не помогает
+        CuckooHashTable<int> degenerate(100, k0syakHash<int>, 0.9, 0.2, k0syakHash<int>);
+        for (int i = 0; i < 8; i++) {
+            degenerate.insert(i);
+        }
+        assert(degenerate.isOccupied(degenerate.capacity() - 1));
+        bool caught = false;
+        try {
+            degenerate.insert(8);
+        }
+        catch (const runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+        assert(degenerate.size() == 8);
+        degenerate.erase(0);
+        assert(!degenerate.contains(0));
+        for (int i = 1; i < 8; i++) {
+            assert(degenerate.contains(i));
+        }
+
+        // Обе функции постоянны; вторая разводит ключи с первой по 25 корзинам, но не по 2^5..2^16 корзинам.
+        // 12 ключей заполняют две корзины и запасной список. При 32 корзинах ключи не помещаются, удвоения
+        // не помогают: перестройка бросает исключение и оставляет таблицу прежней
+        size_t apart = 0;
+        while (mixHash(apart) % 25 == mixHash(k0syakHash(0)) % 25 || mixHash(apart) % 65536 != mixHash(k0syakHash(0)) % 65536) {
+            apart++;
+        }
+        CuckooHashTable<int> limited(100, k0syakHash<int>, 0.9, 0.2, [apart](const int&) { return apart; });
+        for (int i = 0; i < 12; i++) {
+            limited.insert(i);
+        }
+        assert(limited.bucketCount() == 25);
+        caught = false;
+        try {
+            limited.reserve(112);
+        }
+        catch (const runtime_error&) {
+            caught = true;
+        }
+        assert(caught);
+        assert(limited.bucketCount() == 25 && limited.size() == 12);
+        for (int i = 0; i < 12; i++) {
+            assert(limited.contains(i));
+        }
+
+        // Строки, резервирование, пакетная вставка, копия и очистка
+        CuckooHashTable<string> strings(10);
+        strings.reserve(1000);
+        size_t reservedBuckets = strings.bucketCount();
+        vector<string> words;
+        for (int i = 0; i < 1000; i++) {
+            words.push_back("word" + to_string(i % 700));
+        }
+        assert(strings.insertUniqueBulk(words.begin(), words.end()) == 700);
+        assert(strings.bucketCount() == reservedBuckets);
+        CuckooHashTable<string> copy = strings;
+        copy.erase("word1");
+        assert(strings.contains("word1"));
+        assert(!copy.contains("word1"));
+        strings.clear();
+        assert(strings.size() == 0);
+        assert(!strings.contains("word2"));
+        assert(strings.memory_usage() > sizeof(strings));
+
+#ifdef HASHLEGACY_STATS
+        // Поиск не читает больше двух корзин и запасного списка
+        copy.resetStats();
+        for (int i = 0; i < 2000; i++) {
+            copy.contains("word" + to_string(i));
+        }
+        assert(copy.getStats().lookups == 2000);
+        assert(copy.getStats().maxProbeLength <= 2);
+#endif
+
+        cout << "All tests passed successfully!" << endl;
+    }
+};
@@ -1,5 +1,8 @@
+#pragma once
 #include "HashLegacy.h"
 #include "PairLegacy.h"
+#include "FilterLegacy.h"
+#include "ParallelLegacy.h"
 //HashTable<Key>::
 using namespace std;
 
@@ -9,153 +12,266 @@ size_t hash_value(const KeyValuePair<K, V>& pair) {
     return djb2Hash<K>(pair.key);
 }
 
+// Шаблонный класс словаря. Slots -- способ хранения ячеек таблицы (см. SlotsLegacy.h).
+// До InlineCapacity пар хранятся в самом объекте без выделения памяти (см. компактный режим HashTable).
+// Filter -- фильтр перед таблицей для быстрых ответов на поиски отсутствующих ключей (см. FilterLegacy.h)
+template <typename Key, typename Value, typename Slots = DenseSlots<KeyValuePair<Key, Value>>, size_t InlineCapacity = 8, typename Filter = NoFilter>
+class Dictionary;
+
+// Словарь с копированием при записи: snapshot() и копирование стоят O(1) (см. CowSlots)
 template <typename Key, typename Value>
+using PersistentDictionary = Dictionary<Key, Value, CowSlots<KeyValuePair<Key, Value>>>;
+
+template <typename Key, typename Value, typename Slots, size_t InlineCapacity, typename Filter>
 class Dictionary {
 private:
     // Хеш-таблица для хранения пар ключ-значение
-    HashTable<KeyValuePair<Key, Value>> table;
+    HashTable<KeyValuePair<Key, Value>, Slots, InlineCapacity> table;
+    // Фильтр перед таблицей
+    FilterFront<Filter> filter;
 
 public:
     // Конструктор словаря. 47 -- простое число, число элементов по умолчанию
     Dictionary(size_t capacity = 47, function<size_t(const KeyValuePair<Key, Value>&)> hashFunction = [](const KeyValuePair<Key, Value>& p) { return HashTable<Key>::defaultHash(p.key); }, double maxLoadFactor = 0.7)
         : table(capacity, hashFunction, maxLoadFactor) {}
 
-    // Вставка пары ключ-значение в словарь
+    // Вставка пары ключ-значение в словарь. Если ключ уже есть, значение обновляется
     void insert(const Key& key, const Value& value) {
         KeyValuePair<Key, Value> tempPair(key, value);
-        if (contains(key))
+        size_t index = filter.indexOf(table, tempPair);
+        if (index < table.capacity())
         {
-            size_t index = table.hash(tempPair) % table.capacity();
-            size_t originalIndex = index;
-
-            do {
-                // Проверяем, занята ли ячейка
-                if (table.isOccupied(index)) {
-                    KeyValuePair<Key, Value>& pair = table.getListAtIndex(index);
-                    if (pair.key == key) {
-                        table.getListAtIndex(index) = tempPair;
-                    }
-                }
-                index = (index + 1) % table.capacity();
-            } while (index != originalIndex);
+            table.getListAtIndex(index) = tempPair;
         }
         else
         {
         table.insert(tempPair);
+        filter.inserted(table, tempPair);
         }
     }
 
     // Удаление пары ключ-значение из словаря.
     void erase(const Key& key) {
         table.erase(KeyValuePair<Key, Value>(key, Value())); // V() создает дефолтное значение для V, необходимо для поиска и удаления
+        filter.erased(table);
     }
 
 
     // Получение значения по ключу. Бросает исключение runtime_error, если ключ не найден
     Value& operator[](const Key& key) {
-        KeyValuePair<Key, Value> tempPair(key, Value());
-        size_t index = table.hash(tempPair) % table.capacity();
-        size_t originalIndex = index;
-
-        do {
-            // Проверяем, занята ли ячейка
-            if (table.isOccupied(index)) {
-                KeyValuePair<Key, Value>& pair = table.getListAtIndex(index);
-                if (pair.key == key) {
-                    return pair.value;
-                }
-            }
-            index = (index + 1) % table.capacity();
-        } while (index != originalIndex);
-
-        throw runtime_error("Key not found");
+        size_t index = locate(key);
+        if (index == table.capacity()) {
+            throw runtime_error("Key not found");
+        }
+        return table.getListAtIndex(index).value;
     }
 
     // Получение значения по ключу (константная версия). Бросает исключение runtime_error, если ключ не найден
     const Value& operator[](const Key& key) const {
-        KeyValuePair<Key, Value> tempPair(key, Value());
-        size_t index = table.hash(tempPair) % table.capacity();
-        size_t originalIndex = index;
-
-        do {
-            // Проверяем, занята ли ячейка
-            if (table.isOccupied(index)) {
-                const KeyValuePair<Key, Value>& pair = table.getListAtIndex(index);
-                if (pair.key == key) {
-                    return pair.value;
-                }
-            }
-            index = (index + 1) % table.capacity();
-        } while (index != originalIndex);
-
-        throw runtime_error("Key not found");
+        size_t index = locate(key);
+        if (index == table.capacity()) {
+            throw runtime_error("Key not found");
+        }
+        return table.getListAtIndex(index).value;
     }
 
     // Поиск значения по ключу. Возвращает nullptr, если значение не найдено
     Value* find(const Key& key) {
-        KeyValuePair<Key, Value> tempPair(key, Value());
-        size_t index = table.hash(tempPair) % table.capacity();
-        size_t originalIndex = index;
-
-        do {
-            // Проверяем, занята ли ячейка
-            if (table.isOccupied(index)) {
-                KeyValuePair<Key, Value>& pair = table.getListAtIndex(index);
-                if (pair.key == key) {
-                    return &pair.value;
-                }
-            }
-            index = (index + 1) % table.capacity();
-        } while (index != originalIndex);
-
-        return nullptr;
+        size_t index = locate(key);
+        if (index == table.capacity()) {
+            return nullptr;
+        }
+        return &table.getListAtIndex(index).value;
     }
 
     // Поиск значения по ключу (константная версия). Возвращает nullptr, если значение не найдено
     const Value* find(const Key& key) const {
-        KeyValuePair<Key, Value> tempPair(key, Value());
-        size_t index = table.hash(tempPair) % table.capacity();
-        size_t originalIndex = index;
-
-        do {
-            // Проверяем, занята ли ячейка
-            if (table.isOccupied(index)) {
-                const KeyValuePair<Key, Value>& pair = table.getListAtIndex(index);
-                if (pair.key == key) {
-                    return &pair.value;
-                }
+        size_t index = locate(key);
+        if (index == table.capacity()) {
+            return nullptr;
+        }
+        return &table.getListAtIndex(index).value;
+    }
+
+
+    // Количество пар в словаре
+    size_t size() const {
+        return table.size();
+    }
+
+    // Резервирование места под count пар без перехеширований
+    void reserve(size_t count) {
+        table.reserve(count);
+        filter.rebuild(table);
+    }
+
+    // Неизменяемый снимок словаря (см. Set::snapshot). С CowSlots (PersistentDictionary) стоит O(1) плюс копия фильтра;
+    // изменение значения через operator[] или find копирует только блок ячеек с этой парой
+    Dictionary snapshot() const {
+        return *this;
+    }
+
+    // Слияние со словарём other. Для ключа, который есть в обоих словарях, значение становится
+    // reducer(значение в этом словаре, значение в other); без reducer -- значением из other, как при insert.
+    // Место резервируется заранее, каждая пара other ищется и вставляется за один проход зондирования
+        // Сложность: O(other.size()) в среднем случае
+    template <typename Reducer>
+    void merge(const Dictionary& other, Reducer reducer) {
+        reserve(size() + other.size());
+        for (const KeyValuePair<Key, Value>& pair : other.table) {
+            absorb(pair, pair.value, reducer, false);
+        }
+    }
+
+    void merge(const Dictionary& other) {
+        merge(other, takeIncoming);
+    }
+
+    // Слияние с поглощением other: пары перемещаются без копирования ключей и значений, other становится пустым.
+    // Если other больше, словари сначала обмениваются таблицами, и в большую таблицу переносятся пары меньшей
+        // Сложность: O(min(size(), other.size())) в среднем случае
+    template <typename Reducer>
+    void merge(Dictionary&& other, Reducer reducer) {
+        if (this == &other) {
+            return;
+        }
+        bool swapped = other.size() > size();
+        if (swapped) {
+            swap(table, other.table);
+            swap(filter, other.filter);
+        }
+        reserve(size() + other.size());
+        for (size_t i = 0; i < other.table.capacity(); ++i) {
+            if (other.table.isOccupied(i)) {
+                KeyValuePair<Key, Value>& pair = other.table.getListAtIndex(i);
+                absorb(std::move(pair), pair.value, reducer, swapped);
             }
-            index = (index + 1) % table.capacity();
-        } while (index != originalIndex);
+        }
+        other.table.clear();
+        other.filter.rebuild(other.table);
+    }
+
+    void merge(Dictionary&& other) {
+        merge(std::move(other), takeIncoming);
+    }
+
+    // Слияние многих словарей попарно по дереву: на каждом уровне пары словарей сливаются параллельно,
+    // threadCount потоками (0 -- по числу ядер). Словари parts поглощаются
+        // Сложность: O(n log(parts.size()) / threadCount) в среднем случае, n -- суммарный размер
+    template <typename Reducer>
+    static Dictionary mergeAll(vector<Dictionary>& parts, Reducer reducer, size_t threadCount = 0) {
+        if (parts.empty()) {
+            return Dictionary();
+        }
+        if (threadCount == 0) {
+            threadCount = defaultThreadCount();
+        }
+        for (size_t step = 1; step < parts.size(); step *= 2) {
+            // Слияния уровня: parts[i] поглощает parts[i + step] для i, кратных 2 * step
+            size_t merges = (parts.size() - step + 2 * step - 1) / (2 * step);
+            size_t workers = min(threadCount, merges);
+            parallelRun(workers, [&](size_t t) {
+                for (size_t m = partBound(merges, workers, t); m < partBound(merges, workers, t + 1); ++m) {
+                    size_t i = m * 2 * step;
+                    parts[i].merge(std::move(parts[i + step]), reducer);
+                }
+            });
+        }
+        return std::move(parts[0]);
+    }
+
+    static Dictionary mergeAll(vector<Dictionary>& parts, size_t threadCount = 0) {
+        return mergeAll(parts, takeIncoming, threadCount);
+    }
 
-        return nullptr;
+    // Объём памяти словаря в байтах (см. HashTable::memory_usage), включая фильтр
+    size_t memory_usage() const {
+        return table.memory_usage() + filter.memoryUsage();
     }
 
+    // Накопленная статистика таблицы и фильтра словаря (см. StatsLegacy.h)
+    HashTableStats getStats() const {
+        HashTableStats stats = table.getStats();
+        stats.filter = filter.getStats();
+        return stats;
+    }
+
+    // Сброс статистики таблицы и фильтра словаря
+    void resetStats() {
+        table.resetStats();
+        filter.resetStats();
+    }
+
+    // Установка обработчика трассировки операций таблицы словаря
+    void setTraceHook(TraceHook hook) {
+        table.setTraceHook(hook);
+    }
+
+    // Переход таблицы словаря на хеш-функцию со случайным ключом (см. HashTable::useSeededHash)
+    void useSeededHash(KeyedAlgorithm algorithm = KeyedAlgorithm::SipHash) {
+        table.useSeededHash(algorithm);
+        filter.rebuild(table);
+    }
+
+    // Используется ли хеш-функция со случайным ключом
+    bool isSeeded() const {
+        return table.isSeeded();
+    }
 
     // Проверка наличия ключа в словаре
     bool contains(const Key& key) const {
         // Создаем временную пару с фиктивным значением для поиска
-        return table.contains(KeyValuePair<Key, Value>(key, Value()));
+        return filter.contains(table, KeyValuePair<Key, Value>(key, Value()));
     }
     //Итератор, указывающий на начало словаря
-    typename HashTable<KeyValuePair<Key, Value>>::iterator begin() {
+    typename HashTable<KeyValuePair<Key, Value>, Slots, InlineCapacity>::iterator begin() {
         return table.begin();
     }
     //Итератор, указывающий на конец словаря
-    typename HashTable<KeyValuePair<Key, Value>>::iterator end() {
+    typename HashTable<KeyValuePair<Key, Value>, Slots, InlineCapacity>::iterator end() {
         return table.end();
     }
 
     //Итератор, указывающий на начало словаря (константная версия)
-    typename HashTable<KeyValuePair<Key, Value>>::iterator begin() const {
+    typename HashTable<KeyValuePair<Key, Value>, Slots, InlineCapacity>::iterator begin() const {
         return table.begin(); // или table.cbegin(), если HashTable его предоставляет
     }
 
     //Итератор, указывающий на конец словаря (константная версия)
-    typename HashTable<KeyValuePair<Key, Value>>::iterator end() const {
+    typename HashTable<KeyValuePair<Key, Value>, Slots, InlineCapacity>::iterator end() const {
         return table.end(); // или table.cend(), если HashTable его предоставляет
     }
 
+private:
+    // Редуктор слияния по умолчанию: значение из другого словаря
+    static Value takeIncoming(const Value&, const Value& incoming) {
+        return incoming;
+    }
+
+    // Перенос пары при слиянии: вставка, если ключа нет, иначе свёртка значений reducer.
+    // incoming -- значение переносимой пары (до её перемещения); при swapped эта пара из словаря-получателя
+    template <typename Pair, typename Reducer>
+    void absorb(Pair&& pair, const Value& incoming, Reducer& reducer, bool swapped) {
+        bool inserted = false;
+        size_t index = table.findOrInsert(std::forward<Pair>(pair), inserted);
+        KeyValuePair<Key, Value>& stored = table.getListAtIndex(index);
+        if (inserted) {
+            filter.inserted(table, stored);
+        }
+        else if (swapped) {
+            stored.value = reducer(incoming, stored.value);
+        }
+        else {
+            stored.value = reducer(stored.value, incoming);
+        }
+    }
+
+    // Индекс ячейки с ключом или capacity(), если ключа нет. Все поиски словаря проходят через фильтр и зондирование таблицы
+    size_t locate(const Key& key) const {
+        return filter.indexOf(table, KeyValuePair<Key, Value>(key, Value()));
+    }
+
+public:
     // Статический метод для тестирования
     static void testDictionary() {
         Dictionary<int, string> dict(10);
@@ -209,6 +325,165 @@ public:
         assert(dict.contains(1));
         assert(*dict.find(1) == "one_again");
 
+        // Тестирование обновления значения и поиска после перехеширования
+        dict.insert(2, "two_again");
+        assert(dict[2] == "two_again");
+        for (int i = 100; i < 200; i++) {
+            dict.insert(i, to_string(i));
+        }
+        for (int i = 100; i < 200; i++) {
+            assert(dict[i] == to_string(i));
+        }
+        assert(dict.find(300) == nullptr);
+
+        // Словарь с неинициализированными свободными ячейками
+        Dictionary<int, string, RawSlots<KeyValuePair<int, string>>> rawDict(10);
+        for (int i = 0; i < 100; i++) {
+            rawDict.insert(i, to_string(i));
+        }
+        rawDict.insert(5, "five");
+        rawDict.erase(6);
+        assert(rawDict[5] == "five");
+        assert(rawDict.find(6) == nullptr);
+        assert(*rawDict.find(99) == "99");
+        assert(rawDict.memory_usage() > 0);
+
+        // Маленький словарь хранит пары в самом объекте, пока их не больше InlineCapacity
+        Dictionary<string, int> tinyDict;
+        size_t tinyBytes = tinyDict.memory_usage();
+        tinyDict.insert("one", 1);
+        tinyDict.insert("two", 2);
+        tinyDict.insert("one", 11);
+        assert(tinyDict.memory_usage() == tinyBytes);
+        assert(tinyDict["one"] == 11);
+        assert(tinyDict.find("three") == nullptr);
+        tinyDict.erase("one");
+        assert(!tinyDict.contains("one"));
+        assert(*tinyDict.find("two") == 2);
+        for (int i = 0; i < 20; i++) {
+            tinyDict.insert("k" + to_string(i), i);
+        }
+        assert(tinyDict.memory_usage() > tinyBytes);
+        assert(tinyDict["two"] == 2);
+        assert(tinyDict["k19"] == 19);
+
+        // Словарь с фильтром Блума перед таблицей
+        Dictionary<int, string, DenseSlots<KeyValuePair<int, string>>, 8, BlockedBloomFilter> filteredDict;
+        for (int i = 0; i < 500; i++) {
+            filteredDict.insert(i, to_string(i));
+        }
+        filteredDict.insert(7, "seven");
+        filteredDict.erase(8);
+        assert(filteredDict[7] == "seven");
+        assert(filteredDict.find(8) == nullptr);
+        assert(filteredDict.find(1000) == nullptr);
+        assert(!filteredDict.contains(-1));
+        assert(*filteredDict.find(499) == "499");
+        filteredDict.useSeededHash(KeyedAlgorithm::WyHash);
+        assert(filteredDict[7] == "seven");
+        assert(filteredDict.find(8) == nullptr);
+        for (int i = 500; i < 1000; i++) {
+            filteredDict.insert(i, to_string(i));
+        }
+        assert(*filteredDict.find(999) == "999");
+        assert(!filteredDict.contains(1000));
+
+        // Слияние словарей: сумма частот, значение по умолчанию из другого словаря, порядок аргументов редуктора
+        Dictionary<string, size_t> countsA;
+        Dictionary<string, size_t> countsB;
+        for (int i = 0; i < 100; i++) {
+            countsA.insert("w" + to_string(i), 1);
+        }
+        for (int i = 50; i < 300; i++) {
+            countsB.insert("w" + to_string(i), 2);
+        }
+        Dictionary<string, size_t> summed = countsA;
+        summed.merge(countsB, plus<size_t>());
+        assert(summed.size() == 300);
+        assert(summed["w0"] == 1 && summed["w60"] == 3 && summed["w299"] == 2);
+        assert(countsB.size() == 250);
+        Dictionary<string, size_t> replaced = countsA;
+        replaced.merge(countsB);
+        assert(replaced["w0"] == 1 && replaced["w60"] == 2);
+        auto keepFirst = [](size_t existing, size_t) { return existing; };
+        // Поглощаемый словарь больше: таблицы меняются местами, но редуктор получает значения в прежнем порядке
+        Dictionary<string, size_t> smaller = countsA;
+        smaller.merge(std::move(countsB), keepFirst);
+        assert(smaller.size() == 300);
+        assert(smaller["w60"] == 1 && smaller["w299"] == 2);
+        assert(countsB.size() == 0 && !countsB.contains("w60"));
+        Dictionary<string, size_t> larger = smaller;
+        larger.merge(std::move(countsA), keepFirst);
+        assert(larger["w60"] == 1 && larger.size() == 300 && countsA.size() == 0);
+        countsA.merge(std::move(larger));
+        assert(countsA.size() == 300 && larger.size() == 0);
+
+        // Попарное слияние многих словарей несколькими потоками
+        vector<Dictionary<int, int>> parts(7);
+        for (int p = 0; p < 7; p++) {
+            for (int i = p * 100; i < p * 100 + 500; i++) {
+                parts[p].insert(i, 1);
+            }
+        }
+        Dictionary<int, int> total = Dictionary<int, int>::mergeAll(parts, plus<int>(), 3);
+        assert(total.size() == 1100);
+        assert(total[0] == 1 && total[450] == 5 && total[1099] == 1);
+        for (const Dictionary<int, int>& part : parts) {
+            assert(part.size() == 0 || &part == &parts[0]);
+        }
+        vector<Dictionary<int, int>> noParts;
+        Dictionary<int, int> nothing = Dictionary<int, int>::mergeAll(noParts);
+        assert(nothing.size() == 0);
+
+        // Слияние словарей с фильтром: фильтр учитывает перенесённые ключи
+        Dictionary<int, string, DenseSlots<KeyValuePair<int, string>>, 8, BlockedBloomFilter> filteredOther;
+        for (int i = 900; i < 1100; i++) {
+            filteredOther.insert(i, "new");
+        }
+        filteredDict.merge(std::move(filteredOther), [](const string& a, const string& b) { return a + b; });
+        assert(filteredDict[999] == "999new" && filteredDict[1050] == "new");
+        assert(!filteredDict.contains(1100) && filteredDict.size() == 1099);
+
+        // Снимки словаря с копированием при записи: изменения значений и ключей не видны снимку
+        PersistentDictionary<int, int> versions;
+        for (int i = 0; i < 1000; i++) {
+            versions.insert(i, i);
+        }
+        const PersistentDictionary<int, int> version1 = versions.snapshot();
+        versions[5] = -5;
+        *versions.find(6) = -6;
+        versions.erase(7);
+        versions.insert(1000, 1000);
+        assert(version1[5] == 5 && version1[6] == 6 && version1.contains(7) && !version1.contains(1000));
+        assert(versions[5] == -5 && versions[6] == -6 && !versions.contains(7) && versions[1000] == 1000);
+        assert(version1.size() == 1000 && versions.size() == 1000);
+
+        // Читатель суммирует значения снимка в своём потоке, пока писатель изменяет словарь
+        const PersistentDictionary<int, int> version2 = versions.snapshot();
+        long long sum = 0;
+        parallelRun(2, [&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < 3000; i++) {
+                    versions.insert(i, 1);
+                }
+            }
+            else {
+                for (const auto& pair : version2) {
+                    sum += pair.value;
+                }
+            }
+        });
+        assert(sum == 499500 - 5 + -5 - 6 + -6 - 7 + 1000);
+        assert(versions.size() == 3000 && versions[5] == 1 && version2[5] == -5);
+
+#ifdef HASHLEGACY_STATS
+        // Поиски словаря учитываются в статистике таблицы
+        dict.resetStats();
+        dict.find(150);
+        dict.find(300);
+        assert(dict.getStats().lookups == 2);
+#endif
+
 
 
 
@@ -0,0 +1,242 @@
+#pragma once
+// Фильтр перед таблицей множества или словаря (последний параметр шаблона Set и Dictionary).
+// Фильтр по хешу ключа отвечает «ключа точно нет» или «ключ может быть». Поиск отсутствующего ключа
+// в таблице проходит всю цепочку зондирования, а фильтр отвечает на большинство таких поисков
+// чтением одной строки кэша, не обращаясь к таблице.
+//
+// Способы:
+//   NoFilter            -- без фильтра (по умолчанию)
+//   BlockedBloomFilter  -- блочный фильтр Блума: все биты ключа лежат в одном 64-байтовом блоке
+#include <cstdint>
+#include <vector>
+#include "HashLegacy.h"
+
+using namespace std;
+
+// Отсутствие фильтра: все поиски идут сразу в таблицу
+struct NoFilter {
+};
+
+// Блочный фильтр Блума. Блок -- 8 слов по 64 бита (одна строка кэша), ключ устанавливает по одному биту в каждом слове.
+// Номер блока и номера битов берутся из перемешанного хеша ключа. При 10 битах на ключ доля ложных срабатываний около 1%.
+// Удалять ключи из фильтра нельзя: после удаления ключа его биты остаются до перестроения фильтра
+class BlockedBloomFilter {
+private:
+    struct alignas(64) Block {
+        uint64_t words[8];
+    };
+
+    vector<Block> blocks;
+
+    // Номер бита в слове word: старшие 6 бит произведения половины хеша на нечётную «соль» слова
+    static unsigned bitIndex(uint64_t mixed, size_t word) {
+        static const uint32_t salts[8] = { 0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+                                           0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u };
+        return (static_cast<uint32_t>(mixed) * salts[word]) >> 26;
+    }
+
+    size_t blockIndex(uint64_t mixed) const {
+        return static_cast<size_t>((mixed >> 32) % blocks.size());
+    }
+
+public:
+    // Фильтр на expectedKeys ключей по bitsPerKey бит на ключ. Пустой фильтр (expectedKeys == 0) не выделяет памяти
+    // и пропускает все ключи
+    BlockedBloomFilter(size_t expectedKeys = 0, size_t bitsPerKey = 10)
+        : blocks((expectedKeys * bitsPerKey + 511) / 512, Block{}) {}
+
+    // Добавление ключа по хешу. В пустой фильтр добавлять нельзя
+    void add(size_t hash) {
+        uint64_t mixed = mixHash(hash);
+        Block& block = blocks[blockIndex(mixed)];
+        for (size_t word = 0; word < 8; ++word) {
+            block.words[word] |= uint64_t(1) << bitIndex(mixed, word);
+        }
+    }
+
+    // false -- ключа с таким хешем точно не добавляли
+    bool mayContain(size_t hash) const {
+        if (blocks.empty()) {
+            return true;
+        }
+        uint64_t mixed = mixHash(hash);
+        const Block& block = blocks[blockIndex(mixed)];
+        uint64_t missing = 0;
+        for (size_t word = 0; word < 8; ++word) {
+            missing |= ~block.words[word] & (uint64_t(1) << bitIndex(mixed, word));
+        }
+        return missing == 0;
+    }
+
+    // Объём памяти в байтах
+    size_t memoryUsage() const {
+        return blocks.capacity() * sizeof(Block);
+    }
+};
+
+// Фильтр перед таблицей. Размер фильтра рассчитывается по загрузке таблицы: на столько ключей,
+// сколько таблица вмещает до перехеширования. Фильтр перестраивается по ключам таблицы, когда меняется
+// ёмкость таблицы или удалённых ключей в фильтре становится больше половины оставшихся.
+// В компактном режиме таблицы (см. HashTable) фильтр не используется: поиск и так читает один массив
+template <typename Filter>
+class FilterFront {
+private:
+    Filter filter;
+    // Фильтр построен и соответствует ключам таблицы
+    bool active = false;
+    // Ёмкость таблицы, под которую построен фильтр
+    size_t builtCapacity = 0;
+    // Номер хеш-функции таблицы, хешами которой заполнен фильтр (см. HashTable::getHashGeneration)
+    size_t builtGeneration = 0;
+    // Удалённые из таблицы ключи, биты которых остались в фильтре
+    size_t stale = 0;
+#ifdef HASHLEGACY_STATS
+    mutable FilterCounters stats;
+#endif
+
+    template <typename Table>
+    bool outdated(const Table& table) const {
+        return !active || table.capacity() != builtCapacity || table.getHashGeneration() != builtGeneration ||
+               stale * 2 > table.size();
+    }
+
+    // Фильтр можно использовать для поиска: он построен хешами текущей хеш-функции таблицы.
+    // Таблица со случайным ключом может сменить ключ при вставке, до перестроения фильтр пропускается
+    template <typename Table>
+    bool usable(const Table& table) const {
+        return active && table.getHashGeneration() == builtGeneration;
+    }
+
+public:
+    // Перестроение фильтра по ключам таблицы
+    template <typename Table>
+    void rebuild(const Table& table) {
+        stale = 0;
+        if (table.isInline()) {
+            if (active) {
+                filter = Filter();
+                active = false;
+            }
+            return;
+        }
+        active = true;
+        builtCapacity = table.capacity();
+        builtGeneration = table.getHashGeneration();
+        filter = Filter(static_cast<size_t>(table.capacity() * table.getMaxLoadFactor()) + 1);
+        for (const auto& key : table) {
+            filter.add(table.hash(key));
+        }
+    }
+
+    // Учёт ключа, только что вставленного в таблицу
+    template <typename Table, typename Key>
+    void inserted(const Table& table, const Key& key) {
+        if (table.isInline()) {
+            return;
+        }
+        if (outdated(table)) {
+            rebuild(table);
+        }
+        else {
+            filter.add(table.hash(key));
+        }
+    }
+
+    // Учёт ключа, только что удалённого из таблицы
+    template <typename Table>
+    void erased(const Table& table) {
+        if (!active) {
+            return;
+        }
+        stale++;
+        if (outdated(table)) {
+            rebuild(table);
+        }
+    }
+
+    // Поиск индекса ключа в таблице через фильтр. Возвращает capacity() таблицы, если ключа нет
+    template <typename Table, typename Key>
+    size_t indexOf(const Table& table, const Key& key) const {
+        if (!usable(table)) {
+            return table.indexOf(key);
+        }
+        size_t hashValue = table.hash(key);
+        HASHLEGACY_STATS_ONLY(stats.lookups++;)
+        if (!filter.mayContain(hashValue)) {
+            HASHLEGACY_STATS_ONLY(stats.rejects++;)
+            return table.capacity();
+        }
+        size_t index = table.indexOf(key, hashValue);
+        HASHLEGACY_STATS_ONLY(if (index == table.capacity()) stats.falsePositives++;)
+        return index;
+    }
+
+    // Проверка наличия ключа в таблице через фильтр
+    template <typename Table, typename Key>
+    bool contains(const Table& table, const Key& key) const {
+        if (!usable(table)) {
+            return table.contains(key);
+        }
+        size_t hashValue = table.hash(key);
+        HASHLEGACY_STATS_ONLY(stats.lookups++;)
+        if (!filter.mayContain(hashValue)) {
+            HASHLEGACY_STATS_ONLY(stats.rejects++;)
+            return false;
+        }
+        bool found = table.contains(key, hashValue);
+        HASHLEGACY_STATS_ONLY(if (!found) stats.falsePositives++;)
+        return found;
+    }
+
+    // Статистика фильтра. Без HASHLEGACY_STATS все счётчики нулевые
+    FilterStats getStats() const {
+#ifdef HASHLEGACY_STATS
+        return stats.snapshot();
+#else
+        return FilterStats();
+#endif
+    }
+
+    void resetStats() {
+        HASHLEGACY_STATS_ONLY(stats = FilterCounters();)
+    }
+
+    // Объём памяти фильтра в байтах (без самого объекта)
+    size_t memoryUsage() const {
+        return filter.memoryUsage();
+    }
+};
+
+// Без фильтра все операции передаются таблице, объект не хранит данных
+template <>
+class FilterFront<NoFilter> {
+public:
+    template <typename Table>
+    void rebuild(const Table&) {}
+
+    template <typename Table, typename Key>
+    void inserted(const Table&, const Key&) {}
+
+    template <typename Table>
+    void erased(const Table&) {}
+
+    template <typename Table, typename Key>
+    size_t indexOf(const Table& table, const Key& key) const {
+        return table.indexOf(key);
+    }
+
+    template <typename Table, typename Key>
+    bool contains(const Table& table, const Key& key) const {
+        return table.contains(key);
+    }
+
+    FilterStats getStats() const {
+        return FilterStats();
+    }
+
+    void resetStats() {}
+
+    size_t memoryUsage() const {
+        return 0;
+    }
+};
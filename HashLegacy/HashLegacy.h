@@ -6,8 +6,18 @@
 #include <functional>
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include <random>
 #include <ctime>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "ParallelLegacy.h"
+#include "StatsLegacy.h"
+#include "SlotsLegacy.h"
+#include "SimdLegacy.h"
+#include "KeyedHashLegacy.h"
 
 using namespace std;
 
@@ -118,26 +128,82 @@ size_t k0syakHash(const Key& key) {
     return hash;
 }
 
+//Хэш-функция djb2 по байтам строки. constexpr: таблицы с ключами, известными при компиляции,
+//строятся без затрат при запуске (см. StaticLegacy.h)
+constexpr size_t djb2StringHash(string_view key) {
+    size_t hash = 5381;
+    for (char c : key) {
+        hash = ((hash << 5) + hash) + static_cast<unsigned char>(c);
+    }
+    return hash;
+}
 
-// Шаблонный класс хеш-таблицы
-template <typename Key>
+//Хэш-функция FNV-1a (64 бита) по байтам строки, constexpr
+constexpr size_t fnv1aStringHash(string_view key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+// Перемешивание 64-битного хеша (финализатор splitmix64). Хеш-функции выше для целых ключей
+// почти не меняют младшие биты, а скетчам и фильтрам нужны независимые равномерные биты
+inline uint64_t mixHash(uint64_t hash) {
+    hash += 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+
+// Шаблонный класс хеш-таблицы. Slots -- способ хранения ячеек (см. SlotsLegacy.h):
+// DenseSlots (по умолчанию), RawSlots (свободные ячейки не конструируются), IndirectSlots (ячейка -- 32-битный номер ключа)
+// или CowSlots (копирование при записи: копия таблицы стоит O(1), блоки ячеек копируются при первом изменении).
+// InlineCapacity > 0 включает компактный режим: первые InlineCapacity ключей хранятся прямо в объекте, в плоском массиве
+// без хеширования и выделения памяти. При переполнении массива таблица переходит к хешированным ячейкам
+template <typename Key, typename Slots = DenseSlots<Key>, size_t InlineCapacity = 0>
 class HashTable {
 private:
-    // Вектор ключей для хранения данных
-    vector<Key> table;
-    // Вектор флагов, указывающих, занята ли ячейка
-    vector<bool> occupied;
+    // Ячейки таблицы: ключи, флаги занятости и надгробий
+    Slots slots;
     // Хеш-функция
     function<size_t(const Key&)> hashFunction;
     // Количество ключей в таблице
     size_t _size;
+    // Количество надгробий в таблице
+    size_t _tombstones;
     // Коэффициент загрузки -- степень загруженности таблицы
     double loadFactor;
     // Максимальный коэффициент загрузки
     double maxLoadFactor;
     // Минимальный коэффициент загрузки
     double minLoadFactor;
+    // Ключи компактного режима: занятые ячейки -- [0, _size), свободные содержат Key()
+    array<Key, InlineCapacity> inlineKeys;
+    // Перешла ли таблица к хешированным ячейкам. Без компактного режима всегда true
+    bool promoted;
+    // Ёмкость, заказанная в конструкторе: с неё начинаются хешированные ячейки после перехода
+    size_t initialCapacity;
+    // Хеш-функция со случайным ключом (useSeededHash) и её алгоритм
+    bool seeded;
+    KeyedAlgorithm keyedAlgorithm;
+    // Номер хеш-функции: растёт при каждой смене ключа хеширования
+    size_t hashGeneration;
+    // Размер таблицы, до которого повторная смена ключа из-за длинной цепочки не выполняется
+    size_t nextReseedSize;
+    // Число потоков перехеширования (0 -- по числу ядер, см. setRehashThreadCount)
+    size_t rehashThreads;
+#ifdef HASHLEGACY_STATS
+    // Статистика операций и обработчик трассировки
+    mutable HashTableCounters stats;
+    TraceHook traceHook;
+#endif
 public:
+    // Минимальное число ключей, начиная с которого пакетная вставка и перехеширование распределяются по потокам
+    static constexpr size_t parallelThreshold = 1 << 14;
+
     // Хеш-функция по умолчанию
     static size_t defaultHash(const Key& value) {
         // Простая хеш-функция, которая возвращает значение ключа
@@ -146,7 +212,18 @@ public:
 
     // Конструктор хеш-таблицы
     HashTable(size_t capacity, function<size_t(const Key&)> hashFunction = defaultHash, double maxLoadFactor = 0.7, double minLoadFactor = 0.2)
-        : table(capacity), occupied(capacity, false), hashFunction(hashFunction), _size(0), loadFactor(0.0), maxLoadFactor(maxLoadFactor), minLoadFactor(minLoadFactor) {}
+        : slots(InlineCapacity == 0 ? capacity : 0), hashFunction(hashFunction), _size(0), _tombstones(0), loadFactor(0.0), maxLoadFactor(maxLoadFactor), minLoadFactor(minLoadFactor),
+          inlineKeys(), promoted(InlineCapacity == 0), initialCapacity(capacity),
+          seeded(false), keyedAlgorithm(KeyedAlgorithm::SipHash), hashGeneration(0), nextReseedSize(0), rehashThreads(0) {
+        HASHLEGACY_STATS_ONLY(stats.peakBytes = slots.memoryUsage();)
+    }
+
+    // Копирование копирует ячейки (с CowSlots -- за O(1)), перемещение их не копирует.
+    // Перемещённую таблицу можно только уничтожить или присвоить ей другую
+    HashTable(const HashTable&) = default;
+    HashTable(HashTable&&) = default;
+    HashTable& operator=(const HashTable&) = default;
+    HashTable& operator=(HashTable&&) = default;
 
     // Деструктор хеш-таблицы
     ~HashTable() {}
@@ -154,48 +231,265 @@ public:
     // Вставка ключа в таблицу
         // Сложность: O(1) в среднем случае, O(n) в худшем случае
     void insert(const Key& key) {
-        size_t index = hashFunction(key) % table.size();
+        if (isInline()) {
+            if (_size < InlineCapacity) {
+                inlineKeys[_size++] = key;
+                record(TraceOperation::Insert, traceHash(key), ProbeCounter(), true);
+                return;
+            }
+            promote(_size + 1);
+        }
+        insert(key, hash(key));
+    }
+
+    // Вставка ключа по заранее вычисленному хешу hashValue == hash(key)
+    void insert(const Key& key, size_t hashValue) {
+        if (isInline()) {
+            insert(key);
+            return;
+        }
+        size_t index = hashValue % slots.capacity();
+        size_t steps = 0;
+        ProbeCounter counter;
 
         // Линейное зондирование для разрешения коллизий
-        while (occupied[index]) {
-            index = (index + 1) % table.size();
+        while (slots.isOccupied(index)) {
+            counter.step();
+            steps++;
+            index = (index + 1) % slots.capacity();
         }
 
-        table[index] = key;
-        occupied[index] = true;
-        _size++;
-        loadFactor = (double)_size / table.size();
+        place(index, key);
+        record(TraceOperation::Insert, hashValue, counter, true);
+        checkProbeLength(steps);
+    }
 
-        if (loadFactor > maxLoadFactor) {
-            rehash();
+    // Вставка ключа, если его ещё нет в таблице. Поиск и вставка выполняются за один проход зондирования.
+    // Возвращает true, если ключ был вставлен
+        // Сложность: O(1) в среднем случае, O(n) в худшем случае
+    bool insertUnique(const Key& key) {
+        bool inserted = false;
+        findOrInsert(key, inserted);
+        return inserted;
+    }
+
+    // Поиск ключа с вставкой, если его нет, за один проход зондирования. Возвращает индекс ячейки с ключом,
+    // inserted -- был ли ключ вставлен; ключ-rvalue перемещается в таблицу. Перехеширование, которое нужно
+    // после вставки, выполняется до неё, поэтому индекс действителен до следующего изменения таблицы
+        // Сложность: O(1) в среднем случае, O(n) в худшем случае
+    template <typename K>
+    size_t findOrInsert(K&& key, bool& inserted) {
+        if (isInline()) {
+            size_t index = inlineFind(key);
+            if (index < InlineCapacity) {
+                record(TraceOperation::Insert, traceHash(key), ProbeCounter(), false);
+                inserted = false;
+                return index;
+            }
+            if (_size < InlineCapacity) {
+                inlineKeys[_size] = std::forward<K>(key);
+                record(TraceOperation::Insert, traceHash(inlineKeys[_size]), ProbeCounter(), true);
+                inserted = true;
+                return _size++;
+            }
+            promote(_size + 1);
+        }
+        size_t hashValue;
+        ProbeCounter counter;
+        size_t freeIndex;
+        while (true) {
+            // Хеш считается заново: перестройка могла сменить ключ хеширования
+            hashValue = hash(key);
+            size_t steps = 0;
+            size_t index = probeUnique(key, hashValue, freeIndex, steps, counter);
+            if (index < slots.capacity()) {
+                record(TraceOperation::Insert, hashValue, counter, false);
+                inserted = false;
+                return index;
+            }
+            if (!rebuildBeforeInsert(freeIndex, steps)) {
+                break;
+            }
+        }
+
+        if (slots.isDeleted(freeIndex)) {
+            _tombstones--;
         }
+        slots.put(freeIndex, std::forward<K>(key));
+        _size++;
+        loadFactor = (double)_size / slots.capacity();
+        record(TraceOperation::Insert, hashValue, counter, true);
+        inserted = true;
+        return freeIndex;
     }
 
+    // Пакетная вставка диапазона ключей без дубликатов (итераторы произвольного доступа). Возвращает число вставленных ключей.
+    // Таблица резервируется один раз. Ключи делятся по домашней ячейке (hash % capacity) на непрерывные области таблицы,
+    // и каждая область заполняется своим потоком. Ключи, цепочка зондирования которых доходит до границы области,
+    // вставляются вторым, последовательным проходом. Статистика учитывает только вставки второго прохода.
+    // Для хранения без параллельной записи (IndirectSlots) и в компактном режиме вставка последовательная.
+        // Сложность: O(n / threadCount) в среднем случае
+    template <typename Iterator>
+    size_t insertUniqueBulk(Iterator first, Iterator last, size_t threadCount = 0) {
+        size_t count = static_cast<size_t>(last - first);
+        size_t before = _size;
+        if (threadCount == 0) {
+            threadCount = defaultThreadCount();
+        }
+
+        reserve(_size + count);
+        if (threadCount < 2 || count < parallelThreshold || !Slots::concurrentPut || isInline()) {
+            for (; first != last; ++first) {
+                insertUnique(*first);
+            }
+            return _size - before;
+        }
+        // Вставки в обход place() не проверяют надгробия, поэтому заранее убираем их, если места не хватит
+        if ((double)(_size + _tombstones + count) / slots.capacity() > maxLoadFactor) {
+            rebuild(slots.capacity());
+        }
+
+        // Границы областей выровнены по 64 ячейкам, чтобы потоки не писали в одно машинное слово флагов vector<bool>
+        size_t cap = slots.capacity();
+        vector<size_t> bounds(threadCount + 1);
+        for (size_t r = 0; r <= threadCount; ++r) {
+            bounds[r] = partBound(cap, threadCount, r, 64);
+        }
+
+        // Первый проход: хеширование и распределение ключей по областям. buckets[t][r] -- ключи потока t для области r
+        vector<size_t> homes(count);
+        vector<vector<vector<size_t>>> buckets(threadCount, vector<vector<size_t>>(threadCount));
+        parallelRun(threadCount, [&](size_t t) {
+            for (size_t i = partBound(count, threadCount, t); i < partBound(count, threadCount, t + 1); ++i) {
+                homes[i] = hash(first[i]) % cap;
+                size_t region = upper_bound(bounds.begin(), bounds.end(), homes[i]) - bounds.begin() - 1;
+                buckets[t][region].push_back(i);
+            }
+        });
+
+        // Второй проход: каждый поток зондирует только ячейки своей области
+        vector<size_t> placed(threadCount, 0);
+        vector<size_t> reused(threadCount, 0);
+        vector<vector<size_t>> deferred(threadCount);
+        parallelRun(threadCount, [&](size_t r) {
+            size_t regionEnd = bounds[r + 1];
+            for (size_t t = 0; t < threadCount; ++t) {
+                for (size_t i : buckets[t][r]) {
+                    size_t freeIndex = regionEnd;
+                    bool absent = false;
+                    bool duplicate = false;
+                    for (size_t index = homes[i]; index < regionEnd; ++index) {
+                        if (slots.isOccupied(index)) {
+                            if (slots.get(index) == first[i]) {
+                                duplicate = true;
+                                break;
+                            }
+                        }
+                        else {
+                            if (freeIndex == regionEnd)
+                                freeIndex = index;
+                            if (!slots.isDeleted(index)) {
+                                absent = true;
+                                break;
+                            }
+                        }
+                    }
+                    if (duplicate) {
+                        continue;
+                    }
+                    if (!absent) {
+                        deferred[r].push_back(i);
+                        continue;
+                    }
+                    if (slots.isDeleted(freeIndex)) {
+                        reused[r]++;
+                    }
+                    slots.put(freeIndex, first[i]);
+                    placed[r]++;
+                }
+            }
+        });
+
+        for (size_t r = 0; r < threadCount; ++r) {
+            _size += placed[r];
+            _tombstones -= reused[r];
+        }
+        loadFactor = (double)_size / slots.capacity();
+
+        // Ключи на границах областей
+        for (size_t r = 0; r < threadCount; ++r) {
+            for (size_t i : deferred[r]) {
+                insertUnique(first[i]);
+            }
+        }
+        return _size - before;
+    }
 
     //Функция хэширования через функцию хэш-таблицы
     size_t hash(const Key& key) const {
         return hashFunction(key);
     }
 
+    // Поиск индекса ячейки с ключом. Возвращает capacity(), если ключ не найден.
+    // Зондирование останавливается на ячейке, которая ни разу не была занята
+        // Сложность: O(1) в среднем случае, O(n) в худшем случае
+    size_t indexOf(const Key& key) const {
+        if (isInline()) {
+            size_t index = inlineFind(key);
+            record(TraceOperation::Find, traceHash(key), ProbeCounter(), index < InlineCapacity);
+            return index;
+        }
+        return indexOf(key, hash(key));
+    }
+
+    // Поиск индекса ячейки с ключом по заранее вычисленному хешу hashValue == hash(key)
+    size_t indexOf(const Key& key, size_t hashValue) const {
+        if (isInline()) {
+            size_t index = inlineFind(key);
+            record(TraceOperation::Find, hashValue, ProbeCounter(), index < InlineCapacity);
+            return index;
+        }
+        ProbeCounter counter;
+        size_t index = probe(key, hashValue, counter);
+        record(TraceOperation::Find, hashValue, counter, index < slots.capacity());
+        return index;
+    }
+
     // Удаление ключа из таблицы
         // Сложность: O(1) в среднем случае, O(n) в худшем случае
     void erase(const Key& key) {
-        size_t index = hash(key) % table.size();
-        size_t start_index = index;
+        // В компактном режиме на место удалённого ключа переносится последний
+        if (isInline()) {
+            size_t index = inlineFind(key);
+            record(TraceOperation::Erase, traceHash(key), ProbeCounter(), index < InlineCapacity);
+            if (index < InlineCapacity) {
+                _size--;
+                if (index != _size) {
+                    inlineKeys[index] = std::move(inlineKeys[_size]);
+                }
+                inlineKeys[_size] = Key();
+            }
+            return;
+        }
+        erase(key, hash(key));
+    }
 
-        // Линейное зондирование для поиска ключа
-        while (table[index] != key) {
-            index = (index + 1) % table.size();
-            if (start_index == index)
-                break;
+    // Удаление ключа по заранее вычисленному хешу hashValue == hash(key)
+    void erase(const Key& key, size_t hashValue) {
+        if (isInline()) {
+            erase(key);
+            return;
         }
+        ProbeCounter counter;
+        size_t index = probe(key, hashValue, counter);
+        record(TraceOperation::Erase, hashValue, counter, index < slots.capacity());
 
-        // Если ключ найден, удаляем его, устанавливая флаг occupied в false
-        if (occupied[index] && table[index] == key) {
-            occupied[index] = false;
-            table[index] = Key();
+        // Если ключ найден, удаляем его, оставляя на его месте надгробие
+        if (index < slots.capacity()) {
+            slots.remove(index);
             _size--;
-            loadFactor = (double)_size / table.size();
+            _tombstones++;
+            loadFactor = (double)_size / slots.capacity();
             if (loadFactor < minLoadFactor)
             {
                 rehash();
@@ -208,66 +502,85 @@ public:
     // Проверка наличия ключа в таблице
         // Сложность: O(1) в среднем случае, O(n) в худшем случае
     bool contains(const Key& key) const {
-        size_t index = hash(key) % table.size();
-        size_t start_index = index;
-        // Линейное зондирование для поиска ключа
-        while (table[index] != key) {
-            index = (index + 1) % table.size();
-            if (start_index == index)
-                break;
+        if (isInline()) {
+            bool found = inlineFind(key) < InlineCapacity;
+            record(TraceOperation::Contains, traceHash(key), ProbeCounter(), found);
+            return found;
         }
+        return contains(key, hash(key));
+    }
 
-        return occupied[index] && table[index] == key;
+    // Проверка наличия ключа по заранее вычисленному хешу hashValue == hash(key)
+    bool contains(const Key& key, size_t hashValue) const {
+        if (isInline()) {
+            bool found = inlineFind(key) < InlineCapacity;
+            record(TraceOperation::Contains, hashValue, ProbeCounter(), found);
+            return found;
+        }
+        ProbeCounter counter;
+        size_t index = probe(key, hashValue, counter);
+        record(TraceOperation::Contains, hashValue, counter, index < slots.capacity());
+        return index < slots.capacity();
     }
     //Получить значение ячейки по индексу. Бросает исключение out_of_range, если индекс указан неверно
+    //или если ячейка свободна, а способ хранения не держит в свободных ячейках ключей (RawSlots, IndirectSlots)
     const Key& getListAtIndex(size_t index) const {
-        if (index >= table.size()) {
-            throw out_of_range("Index out of range");
-        }
-        return table[index];
+        checkReadable(index);
+        return slotKey(index);
     }
     //Получить значение ячейки по индексу. Бросает исключение out_of_range, если индекс указан неверно
+    //или если ячейка свободна, а способ хранения не держит в свободных ячейках ключей (RawSlots, IndirectSlots)
     Key& getListAtIndex(size_t index) {
-        if (index >= table.size()) {
-            throw out_of_range("Index out of range");
-        }
-        return table[index];
+        checkReadable(index);
+        return isInline() ? inlineKeys[index] : slots.get(index);
     }
     //Получить занятость ячейки по индексу. Бросает исключение out_of_range, если индекс указан неверно
     bool isOccupied(size_t index) const {
-        if (index >= table.size()) {
+        if (index >= capacity()) {
             throw out_of_range("Index out of range");
         }
-        return occupied[index];
+        return slotOccupied(index);
     }
 
 
 
 
-    // Перехеширование при превышении максимального коэффициента загрузки
+    // Перехеширование при превышении максимального коэффициента загрузки. В компактном режиме ничего не делает
     void rehash() {
-        size_t oldSize = table.size();
-        vector<Key> oldTable = table;
-        vector<bool> oldOccupied = occupied;
+        if (isInline()) {
+            return;
+        }
+        size_t oldSize = slots.capacity();
 
         if (loadFactor > maxLoadFactor)
         {
-            table.assign(oldSize * 2, Key());
-            occupied.assign(oldSize * 2, false);
+            rebuild(oldSize * 2);
         }
         else
         {
-            table.assign(oldSize / 2, Key());
-            occupied.assign(oldSize / 2, false);
+            rebuild(oldSize / 2);
         }
-        _size = 0;
-        loadFactor = 0.0;
-        for (size_t i = 0; i < oldSize; ++i) {
-            if (oldOccupied[i]) {
-                insert(oldTable[i]);
+    }
+
+    // Резервирование места под count ключей: последующие вставки до этого размера обойдутся без перехеширования
+    void reserve(size_t count) {
+        if (isInline()) {
+            if (count > InlineCapacity) {
+                promote(count);
             }
+            return;
         }
+        size_t needed = static_cast<size_t>(count / maxLoadFactor) + 1;
+        if (needed > slots.capacity()) {
+            rebuild(needed);
+        }
+    }
 
+    // Сжатие таблицы под текущее число ключей, если коэффициент загрузки опустился ниже минимального
+    void shrinkToFit() {
+        if (!isInline() && loadFactor < minLoadFactor) {
+            rebuild(static_cast<size_t>(_size / maxLoadFactor) + 1);
+        }
     }
 
     size_t size() const {
@@ -275,76 +588,658 @@ public:
     }
 
     size_t capacity() const {
-        return table.size();
+        return isInline() ? InlineCapacity : slots.capacity();
+    }
+
+    // Хранятся ли ключи в компактном режиме, без хеширования
+    bool isInline() const {
+        return InlineCapacity != 0 && !promoted;
+    }
+
+    // Объём памяти таблицы в байтах: сам объект (вместе с массивом компактного режима) и ячейки (без динамической памяти внутри ключей, например длинных строк)
+    size_t memory_usage() const {
+        return sizeof(*this) + slots.memoryUsage();
+    }
+
+    //Ячейки таблицы (в компактном режиме не используются)
+    const Slots& storage() const {
+        return slots;
+    }
+
+    //Хеш-функция таблицы
+    const function<size_t(const Key&)>& getHashFunction() const {
+        return hashFunction;
+    }
+
+    //Максимальный коэффициент загрузки
+    double getMaxLoadFactor() const {
+        return maxLoadFactor;
+    }
+
+    //Минимальный коэффициент загрузки
+    double getMinLoadFactor() const {
+        return minLoadFactor;
+    }
+
+    // Переход на хеш-функцию со случайным ключом (см. KeyedHashLegacy.h) с перехешированием имеющихся ключей.
+    // После этого вставка, цепочка зондирования которой оказалась слишком длинной (признак подобранных коллизий),
+    // меняет ключ хеширования и перехеширует таблицу -- не чаще одного раза на удвоение размера таблицы
+    void useSeededHash(KeyedAlgorithm algorithm = KeyedAlgorithm::SipHash) {
+        seeded = true;
+        keyedAlgorithm = algorithm;
+        reseed();
+    }
+
+    // Используется ли хеш-функция со случайным ключом
+    bool isSeeded() const {
+        return seeded;
+    }
+
+    // Пустая таблица на capacity ячеек с тем же состоянием хеширования: хеш-функцией (со случайным ключом, если он есть),
+    // признаком случайного ключа с его алгоритмом и номером хеш-функции, коэффициентами загрузки и числом потоков перехеширования
+    HashTable emptyLike(size_t capacity) const {
+        HashTable result(capacity, hashFunction, maxLoadFactor, minLoadFactor);
+        result.seeded = seeded;
+        result.keyedAlgorithm = keyedAlgorithm;
+        result.hashGeneration = hashGeneration;
+        result.rehashThreads = rehashThreads;
+        return result;
+    }
+
+    // Номер хеш-функции: меняется, когда таблица выбирает новый ключ хеширования.
+    // Хеши, сохранённые вне таблицы (например, фильтром), с другим номером недействительны
+    size_t getHashGeneration() const {
+        return hashGeneration;
+    }
+
+    // Длина цепочки зондирования вставки, после которой таблица со случайным ключом меняет ключ:
+    // 32 шага на каждый двоичный разряд ёмкости. При случайном хешировании такие цепочки практически не встречаются
+    size_t reseedProbeLimit() const {
+        size_t bits = 1;
+        for (size_t cap = capacity(); cap > 1; cap >>= 1) {
+            bits++;
+        }
+        return 32 * bits;
+    }
+
+    // Накопленная статистика операций. Без HASHLEGACY_STATS все счётчики нулевые
+    HashTableStats getStats() const {
+#ifdef HASHLEGACY_STATS
+        return stats.snapshot();
+#else
+        return HashTableStats();
+#endif
     }
 
+    // Сброс статистики. Пиковый объём памяти начинает отсчёт с текущего размера таблицы
+    void resetStats() {
+        HASHLEGACY_STATS_ONLY(stats = HashTableCounters(); stats.peakBytes = memory_usage();)
+    }
 
+    // Установка обработчика трассировки, вызываемого после каждой операции. Без HASHLEGACY_STATS не вызывается
+    void setTraceHook(TraceHook hook) {
+#ifdef HASHLEGACY_STATS
+        traceHook = hook;
+#else
+        (void)hook;
+#endif
+    }
+
+    // Число потоков перехеширования таблиц от parallelThreshold ключей: 0 -- по числу ядер, 1 -- последовательно
+    void setRehashThreadCount(size_t threadCount) {
+        rehashThreads = threadCount;
+    }
+
+
+    // Итератор по занятым ячейкам таблицы
     class iterator {
     private:
-        const std::vector<Key>* table; // Теперь храним указатель на table
-        typename std::vector<Key>::const_iterator current; // const_iterator
-        typename std::vector<Key>::const_iterator end; // const_iterator
-        const std::vector<bool>* occupied;
+        const HashTable* owner;
+        size_t index;
 
+        // Пропуск свободных ячеек и надгробий
+        void skipFree() {
+            while (index < owner->capacity() && !owner->slotOccupied(index)) {
+                ++index;
+            }
+        }
 
     public:
-        iterator(const std::vector<Key>* table, typename std::vector<Key>::const_iterator begin,  // const_iterator
-            typename std::vector<Key>::const_iterator end, const std::vector<bool>* occupied)
-            : table(table), current(begin), end(end), occupied(occupied) {
+        iterator(const HashTable* owner, size_t index) : owner(owner), index(index) {
             // Находим первый занятый элемент
-            while (current != end && !(*occupied)[std::distance(table->begin(), current)]) {
-                ++current;
-            }
+            skipFree();
         }
 
         iterator& operator++() {
-            ++current;
-            while (current != end && !(*occupied)[std::distance(table->begin(), current)]) {
-                ++current;
-            }
+            ++index;
+            skipFree();
             return *this;
         }
 
-        const Key& operator*() const { // const Key&
-            return *current;
+        const Key& operator*() const {
+            return owner->slotKey(index);
+        }
+
+        const Key* operator->() const {
+            return &owner->slotKey(index);
+        }
+
+        bool operator==(const iterator& other) const {
+            return index == other.index;
         }
 
         bool operator!=(const iterator& other) const {
-            return current != other.current;
+            return index != other.index;
         }
     };
     //Итератор на начало таблицы
     iterator begin() {
-        return iterator(&table, table.begin(), table.end(), &occupied);
+        return iterator(this, 0);
     }
     //Итератор на конец таблицы
     iterator end() {
-        return iterator(&table, table.end(), table.end(), &occupied);
+        return iterator(this, capacity());
     }
 
     // Константные версии begin() и end()
     const iterator begin() const {
-        return iterator(&table, table.begin(), table.end(), &occupied); 
+        return iterator(this, 0);
     }
 
     const iterator end() const {
-        return iterator(&table, table.end(), table.end(), &occupied); 
+        return iterator(this, capacity());
     }
 
     // Метод очистки значений хэш-таблицы
     void clear() {
-        // Очищаем таблицу
-        for (auto& key : table) {
-            key = Key();
-        }
-        for (auto& key : occupied) {
-            key = false;
+        // В компактном режиме достаточно сбросить занятые ключи
+        if (isInline()) {
+            for (size_t i = 0; i < _size; ++i) {
+                inlineKeys[i] = Key();
+            }
+            _size = 0;
+            return;
         }
+        // Очищаем таблицу
+        slots = Slots(slots.capacity());
         // Сбрасываем размер таблицы и коэффициент загрузки
         _size = 0;
+        _tombstones = 0;
         loadFactor = 0.0;
     }
 
+private:
+    // Линейное зондирование от домашней ячейки. Возвращает индекс ячейки с ключом или capacity(), если ключа нет.
+    // Останавливается на ячейке, которая ни разу не была занята
+    size_t probe(const Key& key, size_t hashValue, ProbeCounter& counter) const {
+        size_t index = hashValue % slots.capacity();
+
+        for (size_t step = 0; step < slots.capacity(); ++step) {
+            if (slots.isOccupied(index)) {
+                counter.compare();
+                if (slots.get(index) == key)
+                    return index;
+            }
+            else if (!slots.isDeleted(index)) {
+                break;
+            }
+            counter.step();
+            index = (index + 1) % slots.capacity();
+        }
+
+        return slots.capacity();
+    }
+
+    // Учёт операции в статистике и передача события обработчику трассировки. Без HASHLEGACY_STATS пуст
+    void record(TraceOperation operation, size_t hashValue, const ProbeCounter& counter, bool found) const {
+#ifdef HASHLEGACY_STATS
+        stats.record(operation, counter);
+        if (traceHook) {
+            traceHook(TraceEvent{ operation, hashValue, counter.probes, counter.comparisons, found, capacity(), 0 });
+        }
+#else
+        (void)operation;
+        (void)hashValue;
+        (void)counter;
+        (void)found;
+#endif
+    }
+
+    // Поиск ключа в массиве компактного режима. Возвращает InlineCapacity, если ключа нет.
+    // Целые ключи сравниваются векторными инструкциями по несколько за раз
+    size_t inlineFind(const Key& key) const {
+        size_t index = _size;
+        if constexpr (is_integral<Key>::value) {
+            index = simdFind(inlineKeys.data(), _size, key);
+        }
+        else {
+            for (size_t i = 0; i < _size; ++i) {
+                if (inlineKeys[i] == key) {
+                    index = i;
+                    break;
+                }
+            }
+        }
+        return index < _size ? index : InlineCapacity;
+    }
+
+    // Хеш ключа для трассировки компактного режима, где хеш не нужен для поиска. Без HASHLEGACY_STATS не вычисляется
+    size_t traceHash(const Key& key) const {
+#ifdef HASHLEGACY_STATS
+        return hash(key);
+#else
+        (void)key;
+        return 0;
+#endif
+    }
+
+    // Занятость и ключ ячейки с учётом компактного режима
+    bool slotOccupied(size_t index) const {
+        return isInline() ? index < _size : slots.isOccupied(index);
+    }
+
+    const Key& slotKey(size_t index) const {
+        return isInline() ? inlineKeys[index] : slots.get(index);
+    }
+
+    // Новый случайный ключ хеширования и перехеширование ключей
+    void reseed() {
+        hashFunction = SeededHash<Key>{ HashSeed::random(), keyedAlgorithm };
+        hashGeneration++;
+        nextReseedSize = 2 * _size + 64;
+        HASHLEGACY_STATS_ONLY(stats.reseeds++;)
+        if (!isInline()) {
+            rebuild(slots.capacity());
+        }
+    }
+
+    // Смена ключа хеширования после слишком длинной цепочки зондирования при вставке
+    void checkProbeLength(size_t steps) {
+        if (seeded && steps > reseedProbeLimit() && _size >= nextReseedSize) {
+            reseed();
+        }
+    }
+
+    // Переход из компактного режима к хешированным ячейкам с местом не меньше чем под count ключей
+    void promote(size_t count) {
+        size_t newCapacity = max(initialCapacity, static_cast<size_t>(count / maxLoadFactor) + 1);
+        slots = Slots(newCapacity);
+        promoted = true;
+        for (size_t i = 0; i < _size; ++i) {
+            size_t index = hash(inlineKeys[i]) % newCapacity;
+            while (slots.isOccupied(index)) {
+                index = (index + 1) % newCapacity;
+            }
+            slots.put(index, std::move(inlineKeys[i]));
+            inlineKeys[i] = Key();
+        }
+        loadFactor = (double)_size / newCapacity;
+        HASHLEGACY_STATS_ONLY(stats.peakBytes.raise(slots.memoryUsage());)
+    }
+
+    // Проверка индекса для getListAtIndex. Свободные ячейки компактного режима содержат Key() и читаются
+    void checkReadable(size_t index) const {
+        if (index >= capacity()) {
+            throw out_of_range("Index out of range");
+        }
+        if (!isInline() && !Slots::emptySlotsReadable && !slots.isOccupied(index)) {
+            throw out_of_range("Slot is empty");
+        }
+    }
+
+    // Запись ключа в свободную ячейку (пустую или надгробие) с пересчётом загрузки
+    void place(size_t index, const Key& key) {
+        if (slots.isDeleted(index)) {
+            _tombstones--;
+        }
+        slots.put(index, key);
+        _size++;
+        loadFactor = (double)_size / slots.capacity();
+
+        if (loadFactor > maxLoadFactor) {
+            rehash();
+        }
+        // Надгробия удлиняют цепочки поиска: при их избытке перестраиваем таблицу того же размера
+        else if ((double)(_size + _tombstones) / slots.capacity() > maxLoadFactor) {
+            rebuild(slots.capacity());
+        }
+    }
+
+    // Зондирование для вставки без дубликатов: индекс ячейки с ключом или capacity(). Если ключа нет, freeIndex --
+    // первая свободная ячейка цепочки (зондирование идёт дальше по надгробиям: ключ может быть за ними), steps -- длина цепочки
+    size_t probeUnique(const Key& key, size_t hashValue, size_t& freeIndex, size_t& steps, ProbeCounter& counter) const {
+        size_t index = hashValue % slots.capacity();
+        freeIndex = slots.capacity();
+        for (steps = 0; steps < slots.capacity(); ++steps) {
+            if (slots.isOccupied(index)) {
+                counter.compare();
+                if (slots.get(index) == key) {
+                    return index;
+                }
+            }
+            else {
+                if (freeIndex == slots.capacity())
+                    freeIndex = index;
+                if (!slots.isDeleted(index))
+                    break;
+            }
+            counter.step();
+            index = (index + 1) % slots.capacity();
+        }
+        return slots.capacity();
+    }
+
+    // Перестройка, которую place() и checkProbeLength() выполнили бы после вставки ключа в ячейку freeIndex
+    // с цепочкой длины steps: рост, очистка надгробий или смена ключа хеширования. Возвращает true, если таблица перестроена
+    bool rebuildBeforeInsert(size_t freeIndex, size_t steps) {
+        size_t tombstones = _tombstones - (slots.isDeleted(freeIndex) ? 1 : 0);
+        if ((double)(_size + 1) / slots.capacity() > maxLoadFactor) {
+            rebuild(slots.capacity() * 2);
+            return true;
+        }
+        if ((double)(_size + 1 + tombstones) / slots.capacity() > maxLoadFactor) {
+            rebuild(slots.capacity());
+            return true;
+        }
+        if (seeded && steps > reseedProbeLimit() && _size + 1 >= nextReseedSize) {
+            reseed();
+            return true;
+        }
+        return false;
+    }
+
+    // Перестройка таблицы под новую ёмкость с повторной вставкой всех ключей
+    // Ключи переносятся в порядке старых ячеек напрямую, без учёта в статистике как вставки
+    void rebuild(size_t newCapacity) {
+        HASHLEGACY_STATS_ONLY(auto started = chrono::steady_clock::now();)
+        if (newCapacity == 0) {
+            newCapacity = 1;
+        }
+        Slots oldSlots = std::move(slots);
+        slots = Slots(newCapacity);
+        size_t threadCount = rehashThreads == 0 ? defaultThreadCount() : rehashThreads;
+        _tombstones = 0;
+        if (threadCount >= 2 && _size >= parallelThreshold && Slots::concurrentPut && max(oldSlots.capacity(), newCapacity) <= UINT32_MAX) {
+            parallelMove(oldSlots, threadCount);
+        }
+        else {
+            _size = 0;
+            for (size_t i = 0; i < oldSlots.capacity(); ++i) {
+                if (oldSlots.isOccupied(i)) {
+                    size_t index = hash(as_const(oldSlots).get(i)) % newCapacity;
+                    while (slots.isOccupied(index)) {
+                        index = (index + 1) % newCapacity;
+                    }
+                    slots.put(index, oldSlots.take(i));
+                    _size++;
+                }
+            }
+        }
+        HASHLEGACY_STATS_ONLY(stats.peakBytes.raise(oldSlots.memoryUsage() + slots.memoryUsage());)
+        loadFactor = (double)_size / newCapacity;
+
+#ifdef HASHLEGACY_STATS
+        long long nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+        stats.rehashes++;
+        stats.rehashNanoseconds += nanoseconds;
+        if (traceHook) {
+            traceHook(TraceEvent{ TraceOperation::Rehash, 0, 0, 0, false, newCapacity, nanoseconds });
+        }
+#endif
+        // Ёмкость 1-2 ячейки может оказаться переполненной сразу после переноса
+        if (loadFactor > maxLoadFactor) {
+            rehash();
+        }
+    }
+
+    // Параллельный перенос ключей из oldSlots в пустые ячейки slots при перехешировании. Новая таблица делится
+    // на непрерывные области по домашней ячейке, как в insertUniqueBulk. Первый проход: потоки делят старые ячейки,
+    // вычисляют домашние ячейки и считают ключи каждой области. Второй: по подсчёту каждый поток знает свои места
+    // в общем списке и без синхронизации раскладывает туда номера старых ячеек, сгруппированные по областям.
+    // Третий: каждый поток переносит ключи своей области, не выходя за её границу. Ключи, цепочка зондирования
+    // которых дошла до границы области, переносятся последовательно в конце.
+    // Домашние ячейки и номера старых ячеек хранятся 32-битными (rebuild вызывает перенос только для ёмкостей
+    // до 2^32): сверх обеих таблиц -- 4 байта на старую ячейку и 4 на ключ вместо 8 и 8
+    void parallelMove(Slots& oldSlots, size_t threadCount) {
+        size_t oldCapacity = oldSlots.capacity();
+        size_t cap = slots.capacity();
+        // Границы областей выровнены по 64 ячейкам, чтобы потоки не писали в одно машинное слово флагов vector<bool>
+        vector<size_t> bounds(threadCount + 1);
+        for (size_t r = 0; r <= threadCount; ++r) {
+            bounds[r] = partBound(cap, threadCount, r, 64);
+        }
+        auto regionOf = [&bounds](size_t home) {
+            return static_cast<size_t>(upper_bound(bounds.begin(), bounds.end(), home) - bounds.begin() - 1);
+        };
+
+        // counts[t][r] -- ключи области r среди старых ячеек потока t
+        vector<uint32_t> homes(oldCapacity);
+        vector<vector<size_t>> counts(threadCount);
+        parallelRun(threadCount, [&](size_t t) {
+            vector<size_t> local(threadCount, 0);
+            for (size_t i = partBound(oldCapacity, threadCount, t); i < partBound(oldCapacity, threadCount, t + 1); ++i) {
+                if (oldSlots.isOccupied(i)) {
+                    homes[i] = static_cast<uint32_t>(hash(as_const(oldSlots).get(i)) % cap);
+                    local[regionOf(homes[i])]++;
+                }
+            }
+            counts[t] = std::move(local);
+        });
+
+        // offsets[t][r] -- первое место ключей потока t в части списка области r; regionStart[r] -- начало этой части
+        vector<vector<size_t>> offsets(threadCount, vector<size_t>(threadCount));
+        vector<size_t> regionStart(threadCount + 1, 0);
+        for (size_t r = 0; r < threadCount; ++r) {
+            size_t position = regionStart[r];
+            for (size_t t = 0; t < threadCount; ++t) {
+                offsets[t][r] = position;
+                position += counts[t][r];
+            }
+            regionStart[r + 1] = position;
+        }
+
+        vector<uint32_t> order(regionStart[threadCount]);
+        parallelRun(threadCount, [&](size_t t) {
+            vector<size_t>& next = offsets[t];
+            for (size_t i = partBound(oldCapacity, threadCount, t); i < partBound(oldCapacity, threadCount, t + 1); ++i) {
+                if (oldSlots.isOccupied(i)) {
+                    order[next[regionOf(homes[i])]++] = static_cast<uint32_t>(i);
+                }
+            }
+        });
+
+        HASHLEGACY_STATS_ONLY(stats.peakBytes.raise(oldSlots.memoryUsage() + slots.memoryUsage() + homes.capacity() * sizeof(uint32_t) + order.capacity() * sizeof(uint32_t));)
+
+        vector<vector<size_t>> deferred(threadCount);
+        parallelRun(threadCount, [&](size_t r) {
+            size_t regionEnd = bounds[r + 1];
+            for (size_t k = regionStart[r]; k < regionStart[r + 1]; ++k) {
+                size_t i = order[k];
+                size_t index = homes[i];
+                while (index < regionEnd && slots.isOccupied(index)) {
+                    ++index;
+                }
+                if (index == regionEnd) {
+                    deferred[r].push_back(i);
+                }
+                else {
+                    slots.put(index, oldSlots.take(i));
+                }
+            }
+        });
+
+        // Ключи на границах областей
+        for (size_t r = 0; r < threadCount; ++r) {
+            for (size_t i : deferred[r]) {
+                size_t index = homes[i];
+                while (slots.isOccupied(index)) {
+                    index = (index + 1) % cap;
+                }
+                slots.put(index, oldSlots.take(i));
+            }
+        }
+        _size = order.size();
+    }
+
+public:
+    // Тестирование таблицы строк с заданным способом хранения ячеек
+    template <typename OtherSlots>
+    static void testStorage() {
+        HashTable<string, OtherSlots> storageHashTable(10);
+        for (int i = 0; i < 200; i++) {
+            storageHashTable.insert("key" + to_string(i));
+        }
+        for (int i = 0; i < 150; i++) {
+            storageHashTable.erase("key" + to_string(i));
+        }
+        assert(storageHashTable.size() == 50);
+        for (int i = 0; i < 200; i++) {
+            assert(storageHashTable.contains("key" + to_string(i)) == (i >= 150));
+        }
+        assert(!storageHashTable.insertUnique("key199"));
+        assert(storageHashTable.insertUnique("key0"));
+
+        // Копия не зависит от оригинала
+        HashTable<string, OtherSlots> copyHashTable = storageHashTable;
+        copyHashTable.erase("key0");
+        assert(storageHashTable.contains("key0"));
+        assert(!copyHashTable.contains("key0"));
+
+        int count = 0;
+        for (const string& key : storageHashTable) {
+            assert(key == "key0" || key >= "key150");
+            count++;
+        }
+        assert(count == 51);
+
+        // Свободная ячейка читается, только если способ хранения держит в ней ключ
+        size_t freeIndex = 0;
+        while (storageHashTable.isOccupied(freeIndex)) {
+            freeIndex++;
+        }
+        bool caught = false;
+        try {
+            storageHashTable.getListAtIndex(freeIndex);
+        }
+        catch (const out_of_range&) {
+            caught = true;
+        }
+        assert(caught == !OtherSlots::emptySlotsReadable);
+
+        storageHashTable.clear();
+        assert(storageHashTable.size() == 0);
+        assert(!storageHashTable.contains("key199"));
+    }
+
+    // Тестирование копирования при записи (CowSlots): копия разделяет блоки с оригиналом до их изменения
+    static void testCopyOnWrite() {
+        HashTable<string, CowSlots<string, 64>> original(1000);
+        for (int i = 0; i < 500; i++) {
+            original.insert("key" + to_string(i));
+        }
+        size_t chunks = (original.capacity() + 63) / 64;
+
+        // Копия разделяет все блоки; изменение одного ключа копирует один блок
+        HashTable<string, CowSlots<string, 64>> copy = original;
+        assert(copy.storage().sharedChunks() == chunks);
+        size_t index = copy.indexOf("key7");
+        copy.erase("key7");
+        assert(copy.storage().sharedChunks() == chunks - 1);
+        assert(original.storage().sharedChunks() == chunks - 1);
+        assert(original.contains("key7") && !copy.contains("key7"));
+        assert(!copy.isOccupied(index) && original.isOccupied(index));
+
+        // Поиск в оригинале не копирует блоков
+        for (int i = 0; i < 500; i++) {
+            assert(original.contains("key" + to_string(i)));
+        }
+        assert(original.storage().sharedChunks() == chunks - 1);
+
+        // Перестроение копии переносит ключи копированием и не портит оригинал
+        for (int i = 500; i < 2000; i++) {
+            copy.insert("key" + to_string(i));
+        }
+        assert(copy.size() == 1999 && original.size() == 500);
+        assert(original.storage().sharedChunks() == 0);
+        for (int i = 0; i < 2000; i++) {
+            assert(original.contains("key" + to_string(i)) == (i < 500));
+            assert(copy.contains("key" + to_string(i)) == (i != 7));
+        }
+
+        // Перемещение не копирует блоков
+        size_t shared = copy.storage().sharedChunks();
+        HashTable<string, CowSlots<string, 64>> moved = std::move(copy);
+        assert(moved.size() == 1999 && moved.storage().sharedChunks() == shared);
+        assert(moved.contains("key1999"));
+
+        // Общий пустой блок между записанными блоками учитывается в памяти один раз
+        CowSlots<int, 64> sparse(5 * 64);
+        size_t fresh = sparse.memoryUsage();
+        CowSlots<int, 64> full(5 * 64);
+        for (size_t i = 0; i < 5; i++) {
+            full.put(i * 64, 1);
+        }
+        size_t chunkBytes = (full.memoryUsage() - fresh) / 4;
+        sparse.put(64, 1);
+        sparse.put(3 * 64, 2);
+        assert(sparse.memoryUsage() == fresh + 2 * chunkBytes);
+    }
+
+    // Тестирование хеширования со случайным ключом
+    static void testSeededHash() {
+        // Контрольные значения SipHash-2-4 из описания алгоритма: ключ 00..0f, сообщения длины 0 и 15
+        HashSeed referenceSeed{ 0x0706050403020100ull, 0x0f0e0d0c0b0a0908ull };
+        uint8_t message[15];
+        for (uint8_t i = 0; i < 15; i++) {
+            message[i] = i;
+        }
+        assert(sipHash24(message, 0, referenceSeed) == 0x726fdb47dd0e0e31ull);
+        assert(sipHash24(message, 15, referenceSeed) == 0xa129ca6149be45e5ull);
+        assert(wyHash(message, 15, 1) == wyHash(message, 15, 1));
+        assert(wyHash(message, 15, 1) != wyHash(message, 15, 2));
+        assert(wyHash(message, 14, 1) != wyHash(message, 15, 1));
+
+        // Подобранные ключи: при хеш-функции по умолчанию все кратные 65536 попадают в одну цепочку
+        HashTable<int> floodedTable(1024);
+        HashTable<int> seededTable(1024);
+        seededTable.useSeededHash();
+        assert(seededTable.isSeeded() && seededTable.getHashGeneration() == 1);
+        for (int i = 0; i < 4000; i++) {
+            floodedTable.insert(i * 65536);
+            assert(seededTable.insertUnique(i * 65536));
+        }
+        for (int i = 0; i < 4000; i++) {
+            assert(floodedTable.contains(i * 65536));
+            assert(seededTable.contains(i * 65536));
+        }
+        assert(!seededTable.contains(1));
+        assert(seededTable.size() == 4000);
+#ifdef HASHLEGACY_STATS
+        assert(floodedTable.getStats().maxProbeLength >= 3999);
+        assert(seededTable.getStats().maxProbeLength < seededTable.reseedProbeLimit());
+        assert(seededTable.getStats().reseeds == 1);
+#endif
+
+        // Одинаковые ключи хеш-функция с ключом не разведёт: смена ключа происходит не чаще раза на удвоение таблицы
+        HashTable<int> duplicateTable(16);
+        duplicateTable.useSeededHash(KeyedAlgorithm::WyHash);
+        for (int i = 0; i < 1000; i++) {
+            duplicateTable.insert(7);
+        }
+        assert(duplicateTable.size() == 1000);
+        assert(duplicateTable.contains(7) && !duplicateTable.contains(8));
+        assert(duplicateTable.getHashGeneration() >= 2 && duplicateTable.getHashGeneration() <= 5);
+
+        // Смена ключа в компактном режиме и перехеширование строк
+        HashTable<string, DenseSlots<string>, 4> inlineTable(16);
+        inlineTable.insert("a");
+        inlineTable.useSeededHash();
+        for (int i = 0; i < 100; i++) {
+            inlineTable.insertUnique("s" + to_string(i));
+        }
+        assert(inlineTable.contains("a") && inlineTable.contains("s99") && !inlineTable.contains("s100"));
+    }
+
     // Статический метод для тестирования всех методов класса
     static void testAllMethods() {
         HashTable<int> hashTable(10);
@@ -540,6 +1435,220 @@ public:
             assert(badHashTable.getListAtIndex(i) == 0);
             assert(badHashTable.isOccupied(i) == false);
         }
+
+        //Проверка надгробий: удаление из середины цепочки не обрывает поиск следующих ключей
+        HashTable<int> chainHashTable(20, k0syakHash<int>);
+        for (int i = 0; i < 5; i++) {
+            chainHashTable.insert(i);
+        }
+        chainHashTable.erase(2);
+        assert(!chainHashTable.contains(2));
+        assert(chainHashTable.contains(3));
+        assert(chainHashTable.contains(4));
+        assert(chainHashTable.indexOf(2) == chainHashTable.capacity());
+        // Вставка без дубликатов: существующий ключ за надгробием не дублируется, новый занимает надгробие
+        assert(!chainHashTable.insertUnique(4));
+        assert(chainHashTable.insertUnique(2));
+        assert(chainHashTable.size() == 5);
+        assert(chainHashTable.getListAtIndex(123 % 20 + 2) == 2);
+
+        //Проверка пакетной вставки: дубликаты во входных данных и уже имеющиеся ключи не вставляются повторно
+        HashTable<int> bulkHashTable(10);
+        for (int i = 0; i < 100; i++) {
+            bulkHashTable.insert(i);
+        }
+        vector<int> bulkKeys;
+        for (int i = 0; i < 60000; i++) {
+            bulkKeys.push_back(i % 50000);
+        }
+        assert(bulkHashTable.insertUniqueBulk(bulkKeys.begin(), bulkKeys.end(), 4) == 49900);
+        assert(bulkHashTable.size() == 50000);
+        for (int i = 0; i < 50000; i++) {
+            assert(bulkHashTable.contains(i));
+        }
+        assert(!bulkHashTable.contains(50000));
+        count = 0;
+        for (auto it = bulkHashTable.begin(); it != bulkHashTable.end(); ++it) {
+            count++;
+        }
+        assert(count == 50000);
+
+#ifdef HASHLEGACY_STATS
+        //Проверка счётчиков: при постоянной хеш-функции k-я вставка проходит k занятых ячеек
+        HashTable<int> statsHashTable(100, k0syakHash<int>);
+        vector<TraceEvent> events;
+        statsHashTable.setTraceHook([&events](const TraceEvent& event) { events.push_back(event); });
+        for (int i = 0; i < 10; i++) {
+            statsHashTable.insert(i);
+        }
+        HashTableStats stats = statsHashTable.getStats();
+        assert(stats.inserts == 10);
+        assert(stats.probes == 45);
+        assert(stats.maxProbeLength == 9);
+        assert(stats.peakBytes >= 100 * sizeof(int));
+        assert(events.size() == 10 && events[9].operation == TraceOperation::Insert && events[9].probes == 9);
+
+        statsHashTable.resetStats();
+        assert(statsHashTable.contains(9));
+        assert(!statsHashTable.contains(100));
+        stats = statsHashTable.getStats();
+        assert(stats.lookups == 2);
+        assert(stats.comparisons == 20);
+        assert(stats.probes == 19);
+        assert(events.back().operation == TraceOperation::Contains && !events.back().found);
+
+        for (int i = 10; i < 80; i++) {
+            statsHashTable.insert(i);
+        }
+        stats = statsHashTable.getStats();
+        assert(stats.rehashes == 1);
+        assert(statsHashTable.capacity() == 200);
+        assert(stats.peakBytes >= 300 * sizeof(int));
+        assert(count_if(events.begin(), events.end(), [](const TraceEvent& event) { return event.operation == TraceOperation::Rehash; }) == 1);
+
+        // Поиски из нескольких потоков одновременно: счётчики атомарные, и ни один поиск не теряется.
+        // Обработчик трассировки вызывается из всех потоков и считает события сам атомарно
+        atomic<size_t> tracedLookups(0);
+        statsHashTable.setTraceHook([&tracedLookups](const TraceEvent&) { tracedLookups.fetch_add(1, memory_order_relaxed); });
+        statsHashTable.resetStats();
+        parallelRun(4, [&](size_t t) {
+            for (int i = 0; i < 10000; i++) {
+                assert(statsHashTable.contains(i % 100) == (i % 100 < 80));
+                statsHashTable.indexOf(static_cast<int>(t));
+            }
+        });
+        stats = statsHashTable.getStats();
+        assert(stats.lookups == 80000);
+        assert(tracedLookups == 80000);
+        assert(stats.maxProbeLength >= 79);
+        statsHashTable.setTraceHook(nullptr);
+#endif
+
+        //Проверка параллельного перехеширования: ёмкость и ключи те же, что после последовательного
+        HashTable<int> parallelHashTable(16);
+        HashTable<int> serialHashTable(16);
+        parallelHashTable.setRehashThreadCount(4);
+        serialHashTable.setRehashThreadCount(1);
+        for (int i = 0; i < 100000; i++) {
+            parallelHashTable.insert(i * 3);
+            serialHashTable.insert(i * 3);
+        }
+        assert(parallelHashTable.size() == 100000);
+        assert(parallelHashTable.capacity() == serialHashTable.capacity());
+        for (int i = 0; i < 300000; i++) {
+            assert(parallelHashTable.contains(i) == (i % 3 == 0));
+        }
+        for (int i = 0; i < 100000; i += 2) {
+            parallelHashTable.erase(i * 3);
+        }
+        parallelHashTable.reserve(400000);
+        for (int i = 0; i < 100000; i++) {
+            assert(parallelHashTable.contains(i * 3) == (i % 2 == 1));
+        }
+        HashTable<string> parallelStrings(16);
+        parallelStrings.setRehashThreadCount(3);
+        for (int i = 0; i < 40000; i++) {
+            parallelStrings.insertUnique("key" + to_string(i));
+        }
+        assert(parallelStrings.size() == 40000);
+        for (int i = 0; i < 40000; i++) {
+            assert(parallelStrings.contains("key" + to_string(i)));
+        }
+
+        //Проверка хеширования со случайным ключом
+        testSeededHash();
+
+        //Проверка способов хранения ячеек
+        testStorage<RawSlots<string>>();
+        testStorage<IndirectSlots<string>>();
+        testStorage<CowSlots<string, 64>>();
+        testCopyOnWrite();
+
+        //Проверка учёта памяти: в разреженной таблице косвенное хранение дешевле плотного
+        HashTable<User> denseUserTable(1000);
+        HashTable<User, IndirectSlots<User>> indirectUserTable(1000);
+        for (int i = 0; i < 10; i++) {
+            denseUserTable.insert(User(i, "User" + to_string(i)));
+            indirectUserTable.insert(User(i, "User" + to_string(i)));
+        }
+        assert(denseUserTable.memory_usage() >= 1000 * sizeof(User));
+        assert(indirectUserTable.memory_usage() < denseUserTable.memory_usage() / 4);
+        assert(indirectUserTable.contains(User(5, "User5")));
+
+        //Проверка резервирования: после reserve вставки не меняют ёмкость
+        HashTable<int> reservedHashTable(10);
+        reservedHashTable.reserve(1000);
+        size_t reservedCapacity = reservedHashTable.capacity();
+        for (int i = 0; i < 1000; i++) {
+            reservedHashTable.insert(i);
+        }
+        assert(reservedHashTable.capacity() == reservedCapacity);
+        for (int i = 0; i < 990; i++) {
+            reservedHashTable.erase(i);
+        }
+        reservedHashTable.shrinkToFit();
+        assert(reservedHashTable.capacity() < reservedCapacity);
+        for (int i = 990; i < 1000; i++) {
+            assert(reservedHashTable.contains(i));
+        }
+
+        //Проверка векторного поиска в массиве
+        int smallInts[7] = { 5, 1, 9, 4, 7, 3, 8 };
+        assert(simdFind(smallInts, 7, 4) == 3);
+        assert(simdFind(smallInts, 7, 8) == 6);
+        assert(simdFind(smallInts, 7, 2) == 7);
+        long long smallLongs[5] = { 1LL << 40, 2, 3LL << 40, 2LL << 40, 7 };
+        assert(simdFind(smallLongs, 5, 2LL << 40) == 3);
+        assert(simdFind(smallLongs, 5, 7LL) == 4);
+        assert(simdFind(smallLongs, 5, (1LL << 40) + 1) == 5);
+
+        //Проверка компактного режима: до 4 ключей таблица не выделяет памяти под ячейки, пятый ключ переводит её к хешированию
+        HashTable<int, DenseSlots<int>, 4> inlineHashTable(16);
+        for (int i = 1; i <= 4; i++) {
+            assert(inlineHashTable.insertUnique(i * 10));
+        }
+        assert(!inlineHashTable.insertUnique(20));
+        assert(inlineHashTable.isInline());
+        assert(inlineHashTable.capacity() == 4);
+        assert(inlineHashTable.memory_usage() == sizeof(inlineHashTable));
+        assert(inlineHashTable.indexOf(30) == 2);
+        assert(inlineHashTable.indexOf(50) == inlineHashTable.capacity());
+        inlineHashTable.erase(20);
+        assert(!inlineHashTable.contains(20));
+        assert(inlineHashTable.contains(40));
+        assert(inlineHashTable.size() == 3);
+        inlineHashTable.insert(20);
+        inlineHashTable.insert(50);
+        assert(!inlineHashTable.isInline());
+        assert(inlineHashTable.capacity() >= 16);
+        assert(inlineHashTable.size() == 5);
+        count = 0;
+        for (int key : inlineHashTable) {
+            assert(key % 10 == 0 && key >= 10 && key <= 50);
+            count++;
+        }
+        assert(count == 5);
+        for (int i = 6; i <= 100; i++) {
+            inlineHashTable.insert(i * 10);
+        }
+        for (int i = 1; i <= 100; i++) {
+            assert(inlineHashTable.contains(i * 10));
+        }
+
+        // Компактный режим для строк и переход по reserve
+        HashTable<string, DenseSlots<string>, 4> inlineStringTable(10);
+        inlineStringTable.insert("a");
+        inlineStringTable.insert("b");
+        for (const string& key : inlineStringTable) {
+            assert(key == "a" || key == "b");
+        }
+        inlineStringTable.clear();
+        assert(inlineStringTable.size() == 0);
+        assert(!inlineStringTable.contains("a"));
+        inlineStringTable.insert("c");
+        inlineStringTable.reserve(100);
+        assert(!inlineStringTable.isInline());
+        assert(inlineStringTable.contains("c"));
         cout << "All tests passed successfully!" << endl;
     }
 
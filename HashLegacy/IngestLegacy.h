@@ -0,0 +1,599 @@
+#pragma once
+// Конвейерное чтение файлов: чтение с диска и обработка текста идут одновременно.
+// Поток чтения читает файлы крупными выровненными блоками в кольцо буферов, рабочие потоки
+// обрабатывают прочитанные блоки. Очереди между стадиями ограничены (BoundedQueue): если обработка
+// не успевает, чтение ждёт свободного буфера, и память не растёт с объёмом файлов.
+//
+// Чтение:
+//   io_uring -- если задан макрос HASHLEGACY_IO_URING (CMake задаёт его, когда найдена liburing):
+//               несколько запросов чтения в полёте одновременно
+//   pread    -- без io_uring на POSIX-системах
+//   ifstream -- на остальных системах
+//
+// Обработчик получает фрагменты из целых слов: конец блока переносится на последний пробельный символ,
+// а начало разорванного слова приклеивается к следующему блоку. Конец файла -- тоже граница слова.
+// Читаются обычные файлы: размер файла определяется при открытии
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ParallelLegacy.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HASHLEGACY_HAS_PREAD 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(HASHLEGACY_IO_URING) && defined(HASHLEGACY_HAS_PREAD)
+#define HASHLEGACY_USE_IO_URING 1
+#include <liburing.h>
+#endif
+
+using namespace std;
+
+// Пробельный символ, разделяющий слова (как у operator>> для строки в локали "C")
+inline bool isWordSeparator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Параметры конвейерного чтения
+struct IngestOptions {
+    // Размер блока чтения; округляется вверх до кратного BlockReader::alignment
+    size_t blockSize = size_t(1) << 20;
+    // Число буферов в кольце: половина в чтении, остальные в очереди и в обработке
+    size_t bufferCount = 8;
+    // Число рабочих потоков; 0 -- по числу ядер без потока чтения
+    size_t workerCount = 0;
+};
+
+// Чтение файла блоками по порядку. submit ставит в очередь чтение следующего блока в буфер,
+// complete дожидается самого раннего из поставленных чтений. С io_uring поставленные чтения
+// выполняются ядром параллельно, без него -- в complete
+class BlockReader {
+public:
+    // Выравнивание буферов и блоков (размер страницы)
+    static constexpr size_t alignment = 4096;
+
+private:
+    struct Request {
+        char* buffer;
+        uint64_t offset;
+        size_t length;
+        bool queued;
+        bool done;
+        long long result;
+    };
+
+    // Поставленные чтения по порядку смещений. deque не перемещает элементы при добавлении в конец
+    // и удалении из начала, поэтому адрес запроса служит его меткой в io_uring
+    deque<Request> requests;
+    uint64_t nextOffset;
+    uint64_t fileSize;
+#if defined(HASHLEGACY_HAS_PREAD)
+    int fd;
+#else
+    ifstream file;
+#endif
+#if defined(HASHLEGACY_USE_IO_URING)
+    io_uring ring;
+    bool ringReady;
+    // Отправка в кольцо не удалась, новые чтения идут синхронно (см. submit)
+    bool submitFailed;
+#endif
+
+    // Синхронное чтение length байт со смещения offset. Возвращает число прочитанных байт (меньше -- конец файла)
+    size_t readRange(char* buffer, uint64_t offset, size_t length) {
+        size_t done = 0;
+#if defined(HASHLEGACY_HAS_PREAD)
+        while (done < length) {
+            ssize_t result = ::pread(fd, buffer + done, length - done, static_cast<off_t>(offset + done));
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result < 0) {
+                throw runtime_error("File read error");
+            }
+            if (result == 0) {
+                break;
+            }
+            done += static_cast<size_t>(result);
+        }
+#else
+        (void)offset;
+        file.read(buffer, static_cast<streamsize>(length));
+        done = static_cast<size_t>(file.gcount());
+        if (file.bad()) {
+            throw runtime_error("File read error");
+        }
+#endif
+        return done;
+    }
+
+#if defined(HASHLEGACY_USE_IO_URING)
+    // Учёт записи из очереди завершений. У отменённой записи (см. submit) метки нет
+    void reap(io_uring_cqe* cqe) {
+        Request* completed = static_cast<Request*>(io_uring_cqe_get_data(cqe));
+        if (completed != nullptr) {
+            completed->done = true;
+            completed->result = cqe->res;
+        }
+        io_uring_cqe_seen(&ring, cqe);
+    }
+#endif
+
+    // Ожидание всех чтений, отправленных в ядро: буферы нельзя освобождать, пока ядро пишет в них
+    void drain() noexcept {
+#if defined(HASHLEGACY_USE_IO_URING)
+        for (Request& request : requests) {
+            while (request.queued && !request.done) {
+                io_uring_cqe* cqe = nullptr;
+                int error = io_uring_wait_cqe(&ring, &cqe);
+                if (error == -EINTR) {
+                    continue;
+                }
+                if (error < 0) {
+                    return;
+                }
+                reap(cqe);
+            }
+        }
+#endif
+        requests.clear();
+    }
+
+public:
+    // depth -- наибольшее число одновременно поставленных чтений
+    explicit BlockReader(unsigned depth = 4) : nextOffset(0), fileSize(0) {
+#if defined(HASHLEGACY_HAS_PREAD)
+        fd = -1;
+#endif
+#if defined(HASHLEGACY_USE_IO_URING)
+        // Если io_uring недоступен (старое ядро, запрет в контейнере), чтение идёт через pread
+        ringReady = io_uring_queue_init(max(depth, 1u), &ring, 0) == 0;
+        submitFailed = false;
+#else
+        (void)depth;
+#endif
+    }
+
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    ~BlockReader() {
+        close();
+#if defined(HASHLEGACY_USE_IO_URING)
+        if (ringReady) {
+            io_uring_queue_exit(&ring);
+        }
+#endif
+    }
+
+    // Открытие файла для чтения с начала. Возвращает false, если файл не удалось открыть
+    bool open(const string& filename) {
+        close();
+#if defined(HASHLEGACY_HAS_PREAD)
+        fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            close();
+            return false;
+        }
+        fileSize = static_cast<uint64_t>(info.st_size);
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#else
+        file.open(filename, ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.seekg(0, ios::end);
+        fileSize = static_cast<uint64_t>(file.tellg());
+        file.seekg(0, ios::beg);
+#endif
+        nextOffset = 0;
+        return true;
+    }
+
+    // Закрытие файла; поставленные чтения дожидаются завершения и отбрасываются
+    void close() {
+        drain();
+#if defined(HASHLEGACY_HAS_PREAD)
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#else
+        if (file.is_open()) {
+            file.close();
+        }
+        file.clear();
+#endif
+        nextOffset = 0;
+        fileSize = 0;
+    }
+
+    // Остались ли непоставленные блоки файла
+    bool hasMore() const {
+        return nextOffset < fileSize;
+    }
+
+    // Число поставленных и ещё не полученных чтений
+    size_t pending() const {
+        return requests.size();
+    }
+
+    // Постановка чтения следующего блока файла (не больше capacity байт) в buffer
+    void submit(char* buffer, size_t capacity) {
+        size_t length = static_cast<size_t>(min<uint64_t>(capacity, fileSize - nextOffset));
+        requests.push_back(Request{ buffer, nextOffset, length, false, false, 0 });
+        nextOffset += length;
+#if defined(HASHLEGACY_USE_IO_URING)
+        Request& request = requests.back();
+        io_uring_sqe* sqe = ringReady && !submitFailed ? io_uring_get_sqe(&ring) : nullptr;
+        if (sqe != nullptr) {
+            io_uring_prep_read(sqe, fd, buffer, static_cast<unsigned>(length), request.offset);
+            io_uring_sqe_set_data(sqe, &request);
+            int submitted;
+            do {
+                submitted = io_uring_submit(&ring);
+            } while (submitted == -EINTR);
+            request.queued = submitted == 1;
+            if (!request.queued) {
+                // Запись могла остаться в очереди отправки и уйти в ядро со следующей отправкой, когда запроса
+                // и буфера уже нет. Она заменяется пустой операцией без метки, и новые чтения в кольцо не ставятся:
+                // этот и следующие блоки читаются синхронно, уже отправленные чтения дожидаются как обычно
+                io_uring_prep_nop(sqe);
+                io_uring_sqe_set_data(sqe, nullptr);
+                submitFailed = true;
+            }
+        }
+#endif
+    }
+
+    // Получение самого раннего поставленного блока: буфер и число прочитанных байт.
+    // Бросает исключение runtime_error при ошибке чтения
+    pair<char*, size_t> complete() {
+        assert(!requests.empty());
+        Request& request = requests.front();
+        size_t done = 0;
+#if defined(HASHLEGACY_USE_IO_URING)
+        while (request.queued && !request.done) {
+            io_uring_cqe* cqe = nullptr;
+            int error = io_uring_wait_cqe(&ring, &cqe);
+            if (error == -EINTR) {
+                continue;
+            }
+            if (error < 0) {
+                throw runtime_error("io_uring wait error");
+            }
+            reap(cqe);
+        }
+        if (request.queued) {
+            if (request.result < 0) {
+                throw runtime_error("File read error");
+            }
+            done = static_cast<size_t>(request.result);
+        }
+#endif
+        // Синхронное чтение или дочитывание после короткого чтения io_uring
+        if (done < request.length) {
+            done += readRange(request.buffer + done, request.offset + done, request.length - done);
+        }
+        pair<char*, size_t> block(request.buffer, done);
+        requests.pop_front();
+        return block;
+    }
+};
+
+// Конвейерное чтение набора файлов: поток чтения (вызывающий поток) и рабочие потоки обработки.
+//
+//   FileIngest ingest;
+//   vector<string> missing = ingest.run(filenames, [&](size_t worker, const char* text, size_t size) { ... });
+//
+// Обработчик вызывается одновременно из разных рабочих потоков; worker -- номер потока от 0 до workerCount() - 1,
+// по нему обработчик выбирает свои данные (например, словарь потока), которые затем сливаются
+class FileIngest {
+private:
+    // Прочитанный фрагмент: head, затем [begin, end) буфера. Оба куска состоят из целых слов
+    struct Chunk {
+        // Перенесённый конец предыдущего блока и начало этого блока до первого пробельного символа
+        string head;
+        // Буфер из кольца (nullptr -- фрагмент только из head)
+        char* buffer = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    // Кольцо выровненных буферов
+    class Buffers {
+    private:
+        vector<char*> items;
+
+    public:
+        Buffers(size_t count, size_t size) {
+            for (size_t i = 0; i < count; ++i) {
+                items.push_back(static_cast<char*>(::operator new(size, align_val_t(BlockReader::alignment))));
+            }
+        }
+
+        Buffers(const Buffers&) = delete;
+        Buffers& operator=(const Buffers&) = delete;
+
+        ~Buffers() {
+            for (char* buffer : items) {
+                ::operator delete(buffer, align_val_t(BlockReader::alignment));
+            }
+        }
+
+        const vector<char*>& all() const {
+            return items;
+        }
+    };
+
+    IngestOptions options;
+
+public:
+    explicit FileIngest(IngestOptions ingestOptions = IngestOptions()) : options(ingestOptions) {
+        options.blockSize = max(BlockReader::alignment, (options.blockSize + BlockReader::alignment - 1) / BlockReader::alignment * BlockReader::alignment);
+        options.bufferCount = max<size_t>(2, options.bufferCount);
+        if (options.workerCount == 0) {
+            options.workerCount = max<size_t>(1, defaultThreadCount() - 1);
+        }
+    }
+
+    size_t workerCount() const {
+        return options.workerCount;
+    }
+
+    size_t blockSize() const {
+        return options.blockSize;
+    }
+
+    // Чтение файлов по порядку с обработкой фрагментов consumer(worker, text, size) в рабочих потоках.
+    // Возвращает имена файлов, которые не удалось открыть. Исключение обработчика или ошибка чтения
+    // останавливает конвейер и передаётся вызывающему
+    template <typename Consumer>
+    vector<string> run(const vector<string>& filenames, Consumer consumer) const {
+        const size_t blockSize = options.blockSize;
+        const unsigned depth = static_cast<unsigned>(max<size_t>(1, options.bufferCount / 2));
+        Buffers buffers(options.bufferCount, blockSize);
+        BoundedQueue<char*> freeBuffers(options.bufferCount);
+        for (char* buffer : buffers.all()) {
+            freeBuffers.push(buffer);
+        }
+        BoundedQueue<Chunk> chunks(options.bufferCount);
+
+        vector<string> missing;
+        exception_ptr failure;
+        mutex failureLock;
+        auto fail = [&](exception_ptr error) {
+            {
+                lock_guard<mutex> guard(failureLock);
+                if (!failure) {
+                    failure = error;
+                }
+            }
+            chunks.close();
+            freeBuffers.close();
+        };
+
+        // Разбиение прочитанного блока по границам слов. Возвращает false, если конвейер остановлен
+        string carry;
+        auto emit = [&](char* buffer, size_t size) {
+            size_t first = 0;
+            while (first < size && !isWordSeparator(buffer[first])) {
+                first++;
+            }
+            if (first == size) {
+                // Блок без пробельных символов -- часть длинного слова
+                carry.append(buffer, size);
+                freeBuffers.push(buffer);
+                return true;
+            }
+            size_t last = size;
+            while (!isWordSeparator(buffer[last - 1])) {
+                last--;
+            }
+            Chunk chunk;
+            carry.append(buffer, first);
+            chunk.head.swap(carry);
+            carry.assign(buffer + last, size - last);
+            chunk.buffer = buffer;
+            chunk.begin = first;
+            chunk.end = last;
+            return chunks.push(std::move(chunk));
+        };
+
+        auto read = [&]() {
+            BlockReader reader(depth);
+            for (const string& filename : filenames) {
+                if (!reader.open(filename)) {
+                    missing.push_back(filename);
+                    continue;
+                }
+                while (reader.hasMore() || reader.pending() > 0) {
+                    // Пока есть свободные буферы, ставим чтения вперёд; ждём буфер, только если читать нечего
+                    char* buffer = nullptr;
+                    while (reader.hasMore() && reader.pending() < depth
+                        && (reader.pending() == 0 ? freeBuffers.pop(buffer) : freeBuffers.tryPop(buffer))) {
+                        reader.submit(buffer, blockSize);
+                    }
+                    if (reader.pending() == 0) {
+                        return;
+                    }
+                    pair<char*, size_t> block = reader.complete();
+                    if (!emit(block.first, block.second)) {
+                        return;
+                    }
+                }
+                if (!carry.empty()) {
+                    Chunk chunk;
+                    chunk.head.swap(carry);
+                    if (!chunks.push(std::move(chunk))) {
+                        return;
+                    }
+                }
+            }
+        };
+
+        parallelRun(options.workerCount + 1, [&](size_t t) {
+            if (t == 0) {
+                try {
+                    read();
+                }
+                catch (...) {
+                    fail(current_exception());
+                }
+                chunks.close();
+                return;
+            }
+            size_t worker = t - 1;
+            try {
+                Chunk chunk;
+                while (chunks.pop(chunk)) {
+                    if (!chunk.head.empty()) {
+                        consumer(worker, chunk.head.data(), chunk.head.size());
+                    }
+                    if (chunk.buffer != nullptr) {
+                        if (chunk.end > chunk.begin) {
+                            consumer(worker, chunk.buffer + chunk.begin, chunk.end - chunk.begin);
+                        }
+                        freeBuffers.push(chunk.buffer);
+                    }
+                }
+            }
+            catch (...) {
+                fail(current_exception());
+            }
+        });
+
+        if (failure) {
+            rethrow_exception(failure);
+        }
+        return missing;
+    }
+
+    static void testAllMethods();
+};
+
+inline void FileIngest::testAllMethods() {
+    auto tokens = [](const char* text, size_t size, unordered_map<string, size_t>& counts) {
+        size_t i = 0;
+        while (i < size) {
+            while (i < size && isWordSeparator(text[i])) {
+                i++;
+            }
+            size_t start = i;
+            while (i < size && !isWordSeparator(text[i])) {
+                i++;
+            }
+            if (i > start) {
+                counts[string(text + start, i - start)]++;
+            }
+        }
+    };
+
+    // Файлы: обычный текст со всеми пробельными символами, слово длиннее блока, файл без завершающего
+    // перевода строки, пустой файл. Слова на стыке файлов не склеиваются
+    string base = "hashlegacy_ingest_test_" + to_string(reinterpret_cast<uintptr_t>(&base)) + "_";
+    vector<string> contents(4);
+    const char separators[] = { ' ', '\n', '\t', '\r', '\v', '\f' };
+    uint64_t state = 12345;
+    for (int i = 0; i < 60000; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        contents[0] += "w" + to_string((state >> 33) % 5000);
+        contents[0] += separators[(state >> 20) % 6];
+    }
+    contents[1] = "head " + string(3 * BlockReader::alignment + 17, 'x') + " tail\n";
+    contents[2] = "last words without newline";
+    contents[3] = "";
+    vector<string> filenames;
+    for (size_t i = 0; i < contents.size(); i++) {
+        filenames.push_back(base + to_string(i) + ".txt");
+        ofstream out(filenames.back(), ios::binary);
+        out << contents[i];
+    }
+
+    unordered_map<string, size_t> expected;
+    for (const string& content : contents) {
+        tokens(content.data(), content.size(), expected);
+    }
+
+    for (size_t workers : { 1, 3 }) {
+        for (size_t bufferCount : { 2, 5 }) {
+            IngestOptions options;
+            options.blockSize = 1;
+            options.bufferCount = bufferCount;
+            options.workerCount = workers;
+            FileIngest ingest(options);
+            assert(ingest.blockSize() == BlockReader::alignment);
+            assert(ingest.workerCount() == workers);
+
+            vector<unordered_map<string, size_t>> parts(workers);
+            vector<string> withMissing = filenames;
+            withMissing.insert(withMissing.begin() + 1, base + "missing.txt");
+            vector<string> missing = ingest.run(withMissing, [&](size_t worker, const char* text, size_t size) {
+                assert(worker < parts.size());
+                assert(size > 0);
+                tokens(text, size, parts[worker]);
+            });
+            assert(missing.size() == 1 && missing[0] == base + "missing.txt");
+
+            unordered_map<string, size_t> total;
+            for (const auto& part : parts) {
+                for (const auto& item : part) {
+                    total[item.first] += item.second;
+                }
+            }
+            assert(total == expected);
+        }
+    }
+
+    // Исключение обработчика останавливает конвейер и доходит до вызывающего
+    IngestOptions small;
+    small.blockSize = BlockReader::alignment;
+    small.bufferCount = 2;
+    small.workerCount = 2;
+    [[maybe_unused]] bool caught = false;
+    try {
+        FileIngest(small).run(filenames, [](size_t, const char*, size_t) {
+            throw runtime_error("consumer failure");
+        });
+    }
+    catch (const runtime_error&) {
+        caught = true;
+    }
+    assert(caught);
+
+    // Чтение блоками напрямую
+    BlockReader reader(2);
+    assert(!reader.open(base + "missing.txt"));
+    assert(reader.open(filenames[2]) && reader.hasMore());
+    vector<char> block(BlockReader::alignment);
+    reader.submit(block.data(), block.size());
+    assert(!reader.hasMore() && reader.pending() == 1);
+    [[maybe_unused]] pair<char*, size_t> result = reader.complete();
+    assert(result.second == contents[2].size() && string(result.first, result.second) == contents[2]);
+    reader.close();
+
+    for (const string& filename : filenames) {
+        remove(filename.c_str());
+    }
+    cout << "All tests passed successfully!" << endl;
+}
@@ -0,0 +1,880 @@
+#pragma once
+// Хеш-таблица целых ключей: вариант HashTable без служебных массивов и без вызова хеш-функции через function.
+// Свободная ячейка хранит особое значение ключа EmptyKey (по умолчанию наибольшее значение типа),
+// поэтому вся таблица -- один массив ключей, и вставлять сам EmptyKey нельзя.
+// Ёмкость -- степень двойки, номер начальной ячейки -- старшие биты перемешанного ключа (умножение
+// на 2^64 / золотое сечение после сдвига с исключающим или). Зондирование линейное, но ключ сравнивается
+// сразу с группой из 8 ячеек (4 для 64-битных ключей) инструкциями SSE2 (см. SimdLegacy.h).
+// Удаление сдвигает следующие ключи цепочки назад, поэтому надгробий нет
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+#include "SimdLegacy.h"
+#include "StatsLegacy.h"
+#include "PairLegacy.h"
+
+using namespace std;
+
+template <typename Key, Key EmptyKey>
+class IntCounter;
+
+template <typename Key, Key EmptyKey = numeric_limits<Key>::max()>
+class IntHashTable {
+    static_assert(is_integral<Key>::value, "IntHashTable requires an integral key type");
+
+    // Счётчик целых ключей использует то же зондирование группами
+    template <typename K, K E>
+    friend class IntCounter;
+
+public:
+    // Ячеек в группе, сравниваемой с ключом за один шаг зондирования: 32 байта
+    static constexpr size_t groupSize = sizeof(Key) == 8 ? 4 : 8;
+
+private:
+    // Ячейки таблицы: ключи и EmptyKey в свободных ячейках
+    vector<Key> slots;
+    // Ёмкость минус один и сдвиг, оставляющий от перемешанного ключа номер ячейки
+    size_t mask;
+    int shift;
+    // Количество ключей в таблице
+    size_t _size;
+    // Максимальный коэффициент загрузки
+    double maxLoadFactor;
+    // Минимальный коэффициент загрузки
+    double minLoadFactor;
+#ifdef HASHLEGACY_STATS
+    // Статистика операций и обработчик трассировки
+    mutable HashTableCounters stats;
+    TraceHook traceHook;
+#endif
+
+public:
+    // Значение свободной ячейки
+    static constexpr Key emptyKey() {
+        return EmptyKey;
+    }
+
+    // Перемешивание ключа: старшие биты результата зависят от всех битов ключа
+    static size_t hash(Key key) {
+        uint64_t value = static_cast<uint64_t>(key);
+        return static_cast<size_t>((value ^ (value >> 32)) * 0x9E3779B97F4A7C15ull);
+    }
+
+    // Конструктор таблицы. Ёмкость округляется вверх до степени двойки, но не меньше размера группы
+    IntHashTable(size_t capacity, double maxLoadFactor = 0.7, double minLoadFactor = 0.2)
+        : mask(0), shift(0), _size(0), maxLoadFactor(maxLoadFactor), minLoadFactor(minLoadFactor) {
+        allocate(roundCapacity(capacity));
+        HASHLEGACY_STATS_ONLY(stats.peakBytes = memory_usage();)
+    }
+
+    // Вставка ключа в таблицу. Ключ не проверяется на наличие в таблице.
+    // Бросает исключение invalid_argument для ключа, совпадающего со значением свободной ячейки
+        // Сложность: O(1) в среднем случае
+    void insert(Key key) {
+        checkKey(key);
+        if (capacityFor(_size + 1) > capacity()) {
+            rebuild(capacity() * 2);
+        }
+        ProbeCounter counter;
+        size_t home = homeOf(key);
+        slots[freeSlot(home, counter)] = key;
+        _size++;
+        record(TraceOperation::Insert, home, counter, true);
+    }
+
+    // Вставка ключа, если его ещё нет в таблице. Возвращает true, если ключ был вставлен.
+    // Бросает исключение invalid_argument для ключа, совпадающего со значением свободной ячейки
+        // Сложность: O(1) в среднем случае
+    bool insertUnique(Key key) {
+        checkKey(key);
+        ProbeCounter counter;
+        size_t home = homeOf(key);
+        size_t freeIndex = capacity();
+        if (probe(key, home, freeIndex, counter) < capacity()) {
+            record(TraceOperation::Insert, home, counter, false);
+            return false;
+        }
+        if (capacityFor(_size + 1) > capacity()) {
+            rebuild(capacity() * 2);
+            home = homeOf(key);
+            freeIndex = freeSlot(home, counter);
+        }
+        assert(freeIndex < capacity());
+        slots[freeIndex] = key;
+        _size++;
+        record(TraceOperation::Insert, home, counter, true);
+        return true;
+    }
+
+    // Поиск индекса ячейки с ключом. Возвращает capacity(), если ключ не найден
+        // Сложность: O(1) в среднем случае
+    size_t indexOf(Key key) const {
+        ProbeCounter counter;
+        size_t home = homeOf(key);
+        size_t freeIndex = capacity();
+        size_t index = key == EmptyKey ? capacity() : probe(key, home, freeIndex, counter);
+        record(TraceOperation::Find, home, counter, index < capacity());
+        return index;
+    }
+
+    // Проверка наличия ключа в таблице
+        // Сложность: O(1) в среднем случае
+    bool contains(Key key) const {
+        ProbeCounter counter;
+        size_t home = homeOf(key);
+        size_t freeIndex = capacity();
+        bool found = key != EmptyKey && probe(key, home, freeIndex, counter) < capacity();
+        record(TraceOperation::Contains, home, counter, found);
+        return found;
+    }
+
+    // Удаление ключа из таблицы. Следующие ключи цепочки сдвигаются назад на освободившееся место,
+    // если их начальная ячейка не лежит между освободившейся ячейкой и ими самими
+        // Сложность: O(1) в среднем случае, перехеширование при загрузке ниже минимальной -- O(n)
+    void erase(Key key) {
+        ProbeCounter counter;
+        size_t home = homeOf(key);
+        size_t freeIndex = capacity();
+        size_t index = key == EmptyKey ? capacity() : probe(key, home, freeIndex, counter);
+        record(TraceOperation::Erase, home, counter, index < capacity());
+        if (index == capacity()) {
+            return;
+        }
+
+        size_t hole = index;
+        for (size_t next = (hole + 1) & mask; slots[next] != EmptyKey; next = (next + 1) & mask) {
+            size_t nextHome = homeOf(slots[next]);
+            if (((next - nextHome) & mask) >= ((next - hole) & mask)) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole] = EmptyKey;
+        _size--;
+
+        if ((double)_size / capacity() < minLoadFactor && capacity() > groupSize) {
+            rehash();
+        }
+    }
+
+    //Получить значение ячейки по индексу. Бросает исключение out_of_range, если индекс указан неверно или ячейка свободна
+    Key getListAtIndex(size_t index) const {
+        if (!isOccupied(index)) {
+            throw out_of_range("Slot is empty");
+        }
+        return slots[index];
+    }
+
+    //Получить занятость ячейки по индексу. Бросает исключение out_of_range, если индекс указан неверно
+    bool isOccupied(size_t index) const {
+        if (index >= capacity()) {
+            throw out_of_range("Index out of range");
+        }
+        return slots[index] != EmptyKey;
+    }
+
+    // Перехеширование: увеличение вдвое при превышении максимального коэффициента загрузки, иначе уменьшение вдвое
+    void rehash() {
+        if ((double)_size / capacity() > maxLoadFactor) {
+            rebuild(capacity() * 2);
+        }
+        else {
+            rebuild(capacity() / 2);
+        }
+    }
+
+    // Резервирование места под count ключей без перехеширований
+    void reserve(size_t count) {
+        if (capacityFor(count) > capacity()) {
+            rebuild(capacityFor(count));
+        }
+    }
+
+    // Сжатие таблицы под текущее число ключей, если коэффициент загрузки опустился ниже минимального
+    void shrinkToFit() {
+        if ((double)_size / capacity() < minLoadFactor) {
+            rebuild(capacityFor(_size));
+        }
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+
+    // Объём памяти таблицы в байтах: сам объект и массив ячеек
+    size_t memory_usage() const {
+        return sizeof(*this) + slots.capacity() * sizeof(Key);
+    }
+
+    //Максимальный коэффициент загрузки
+    double getMaxLoadFactor() const {
+        return maxLoadFactor;
+    }
+
+    //Минимальный коэффициент загрузки
+    double getMinLoadFactor() const {
+        return minLoadFactor;
+    }
+
+    // Накопленная статистика операций. Шаг зондирования -- переход к следующей группе ячеек,
+    // сравнение -- сравнение ключа с группой. Без HASHLEGACY_STATS все счётчики нулевые
+    HashTableStats getStats() const {
+#ifdef HASHLEGACY_STATS
+        return stats.snapshot();
+#else
+        return HashTableStats();
+#endif
+    }
+
+    // Сброс статистики
+    void resetStats() {
+        HASHLEGACY_STATS_ONLY(stats = HashTableCounters(); stats.peakBytes = memory_usage();)
+    }
+
+    // Установка обработчика трассировки, вызываемого после каждой операции. Без HASHLEGACY_STATS не вызывается
+    void setTraceHook(TraceHook hook) {
+#ifdef HASHLEGACY_STATS
+        traceHook = hook;
+#else
+        (void)hook;
+#endif
+    }
+
+    // Итератор по занятым ячейкам таблицы
+    class iterator {
+    private:
+        const IntHashTable* owner;
+        size_t index;
+
+        void skipFree() {
+            while (index < owner->capacity() && owner->slots[index] == EmptyKey) {
+                ++index;
+            }
+        }
+
+    public:
+        iterator(const IntHashTable* owner, size_t index) : owner(owner), index(index) {
+            skipFree();
+        }
+
+        iterator& operator++() {
+            ++index;
+            skipFree();
+            return *this;
+        }
+
+        const Key& operator*() const {
+            return owner->slots[index];
+        }
+
+        bool operator==(const iterator& other) const {
+            return index == other.index;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return index != other.index;
+        }
+    };
+
+    //Итератор на начало таблицы
+    iterator begin() const {
+        return iterator(this, 0);
+    }
+    //Итератор на конец таблицы
+    iterator end() const {
+        return iterator(this, capacity());
+    }
+
+    // Метод очистки таблицы
+    void clear() {
+        slots.assign(slots.size(), EmptyKey);
+        _size = 0;
+    }
+
+private:
+    // Наименьшая степень двойки не меньше capacity и размера группы
+    static size_t roundCapacity(size_t capacity) {
+        size_t rounded = groupSize;
+        while (rounded < capacity) {
+            rounded *= 2;
+        }
+        return rounded;
+    }
+
+    // Ёмкость, в которую count ключей помещаются без превышения максимальной загрузки
+    // и с хотя бы одной свободной ячейкой, на которой останавливается зондирование
+    size_t capacityFor(size_t count) const {
+        size_t result = groupSize;
+        while (count >= result || (double)count / result > maxLoadFactor) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    void allocate(size_t capacity) {
+        slots.assign(capacity, EmptyKey);
+        mask = capacity - 1;
+        shift = 64;
+        for (size_t bits = capacity; bits > 1; bits >>= 1) {
+            shift--;
+        }
+    }
+
+    // Начальная ячейка ключа
+    size_t homeOf(Key key) const {
+        // При ёмкости 1 << 64 сдвиг на 64 не определён, но такая ёмкость недостижима
+        return static_cast<size_t>(static_cast<uint64_t>(hash(key)) >> shift) & mask;
+    }
+
+    static void checkKey(Key key) {
+        if (key == EmptyKey) {
+            throw invalid_argument("Key is reserved for empty slots");
+        }
+    }
+
+    // Маска ячеек группы, начинающейся с first и равных value: бит i -- ячейка first + i
+    static unsigned matchGroup(const Key* first, Key value) {
+        if constexpr (sizeof(Key) == 4) {
+            uint32_t bits = static_cast<uint32_t>(value);
+            return simdMatch4x32(first, bits) | (simdMatch4x32(first + 4, bits) << 4);
+        }
+        else if constexpr (sizeof(Key) == 8) {
+            uint64_t bits = static_cast<uint64_t>(value);
+            return simdMatch2x64(first, bits) | (simdMatch2x64(first + 2, bits) << 2);
+        }
+        else {
+            unsigned result = 0;
+            for (size_t i = 0; i < groupSize; ++i) {
+                result |= (first[i] == value ? 1u : 0u) << i;
+            }
+            return result;
+        }
+    }
+
+    // Зондирование группами от начальной ячейки home по массиву slots ёмкости mask + 1. Группы выровнены по своему
+    // размеру, а ёмкость кратна ему, поэтому группа не выходит за конец массива. Свободные ячейки первой группы
+    // до home не останавливают поиск при первом проходе, но цепочка может обойти таблицу и закончиться в них же,
+    // поэтому первая группа просматривается ещё раз целиком. Общее для IntHashTable и IntCounter.
+    // Возвращает индекс ячейки с ключом или mask + 1; в freeIndex -- первая свободная ячейка цепочки
+    static size_t probeGroups(const Key* slots, size_t mask, Key key, size_t home, size_t& freeIndex, ProbeCounter& counter) {
+        size_t capacity = mask + 1;
+        size_t group = home & ~(groupSize - 1);
+        unsigned skipped = (1u << (home - group)) - 1;
+        for (size_t visited = 0; visited <= capacity; visited += groupSize) {
+            const Key* first = slots + group;
+            counter.compare();
+            unsigned matches = matchGroup(first, key);
+            if (matches != 0) {
+                return group + lowestSetBit(matches);
+            }
+            unsigned free = matchGroup(first, EmptyKey) & ~skipped;
+            if (free != 0) {
+                freeIndex = group + lowestSetBit(free);
+                return capacity;
+            }
+            skipped = 0;
+            counter.step();
+            group = (group + groupSize) & mask;
+        }
+        return capacity;
+    }
+
+    size_t probe(Key key, size_t home, size_t& freeIndex, ProbeCounter& counter) const {
+        return probeGroups(slots.data(), mask, key, home, freeIndex, counter);
+    }
+
+    // Первая свободная ячейка цепочки от home. Таблица никогда не заполнена полностью (см. capacityFor)
+    size_t freeSlot(size_t home, ProbeCounter& counter) const {
+        size_t group = home & ~(groupSize - 1);
+        unsigned skipped = (1u << (home - group)) - 1;
+        while (true) {
+            unsigned free = matchGroup(slots.data() + group, EmptyKey) & ~skipped;
+            if (free != 0) {
+                return group + lowestSetBit(free);
+            }
+            skipped = 0;
+            counter.step();
+            group = (group + groupSize) & mask;
+        }
+    }
+
+    // Перестройка таблицы под новую ёмкость (не меньше нужной для текущих ключей)
+    void rebuild(size_t newCapacity) {
+        HASHLEGACY_STATS_ONLY(auto started = chrono::steady_clock::now(); size_t oldBytes = memory_usage();)
+        vector<Key> oldSlots = std::move(slots);
+        allocate(max(roundCapacity(newCapacity), capacityFor(_size)));
+        for (Key key : oldSlots) {
+            if (key != EmptyKey) {
+                ProbeCounter counter;
+                slots[freeSlot(homeOf(key), counter)] = key;
+            }
+        }
+
+#ifdef HASHLEGACY_STATS
+        long long nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+        stats.peakBytes.raise(oldBytes + memory_usage());
+        stats.rehashes++;
+        stats.rehashNanoseconds += nanoseconds;
+        if (traceHook) {
+            traceHook(TraceEvent{ TraceOperation::Rehash, 0, 0, 0, false, capacity(), nanoseconds });
+        }
+#endif
+    }
+
+    // Учёт операции в статистике и передача события обработчику трассировки. Без HASHLEGACY_STATS пуст
+    void record(TraceOperation operation, size_t home, const ProbeCounter& counter, bool found) const {
+#ifdef HASHLEGACY_STATS
+        stats.record(operation, counter);
+        if (traceHook) {
+            traceHook(TraceEvent{ operation, home, counter.probes, counter.comparisons, found, capacity(), 0 });
+        }
+#else
+        (void)operation;
+        (void)home;
+        (void)counter;
+        (void)found;
+#endif
+    }
+
+public:
+    static void testAllMethods() {
+        IntHashTable<int> table(10);
+        assert(table.capacity() == 16);
+        for (int i = 0; i < 10000; i++) {
+            assert(table.insertUnique(i));
+        }
+        assert(!table.insertUnique(5000));
+        assert(table.size() == 10000);
+        assert(table.capacity() == 16384);
+        for (int i = 0; i < 10000; i++) {
+            assert(table.contains(i));
+        }
+        assert(!table.contains(-1));
+        assert(!table.contains(emptyKey()));
+        assert(table.indexOf(-1) == table.capacity());
+        assert(table.getListAtIndex(table.indexOf(1234)) == 1234);
+
+        for (int i = 0; i < 10000; i += 2) {
+            table.erase(i);
+        }
+        table.erase(emptyKey());
+        assert(table.size() == 5000);
+        for (int i = 0; i < 10000; i++) {
+            assert(table.contains(i) == (i % 2 == 1));
+        }
+        size_t count = 0;
+        for (int key : table) {
+            assert(key % 2 == 1);
+            count++;
+        }
+        assert(count == 5000);
+
+        // Перехеширование при удалении почти всех ключей
+        size_t capacity = table.capacity();
+        for (int i = 1; i < 9000; i += 2) {
+            table.erase(i);
+        }
+        assert(table.capacity() < capacity);
+        assert(table.size() == 500);
+        assert(table.contains(9999));
+
+        // Значение свободной ячейки вставить нельзя
+        bool caught = false;
+        try {
+            table.insert(emptyKey());
+        }
+        catch (const invalid_argument&) {
+            caught = true;
+        }
+        assert(caught);
+
+        // Сравнение со стандартным множеством на случайных операциях при высокой загрузке:
+        // удаление со сдвигом назад не должно терять ключи, лежащие дальше в цепочке
+        IntHashTable<int> random(8, 0.9, 0.05);
+        unordered_set<int> reference;
+        mt19937 generator(12345);
+        for (int i = 0; i < 200000; i++) {
+            int key = static_cast<int>(generator() % 4096);
+            if (generator() % 3 == 0) {
+                random.erase(key);
+                reference.erase(key);
+            }
+            else {
+                assert(random.insertUnique(key) == reference.insert(key).second);
+            }
+            if (i % 1000 == 0) {
+                for (int probeKey = 0; probeKey < 4096; probeKey++) {
+                    assert(random.contains(probeKey) == (reference.count(probeKey) == 1));
+                }
+            }
+        }
+        assert(random.size() == reference.size());
+
+        // 64-битные ключи со свободной ячейкой 0 и 16-битные ключи (сравнение группы без SSE2)
+        IntHashTable<uint64_t, 0> wide(4);
+        assert(wide.capacity() == 4);
+        for (uint64_t i = 1; i <= 1000; i++) {
+            wide.insert(i << 40);
+        }
+        for (uint64_t i = 1; i <= 1000; i++) {
+            assert(wide.contains(i << 40));
+            assert(!wide.contains((i << 40) + 1));
+        }
+        assert(!wide.contains(0));
+        IntHashTable<int16_t> narrow(16);
+        for (int i = -500; i < 500; i++) {
+            narrow.insertUnique(static_cast<int16_t>(i));
+        }
+        assert(narrow.size() == 1000);
+        assert(narrow.contains(-500) && !narrow.contains(500));
+
+        // Цепочка, обходящая конец таблицы: ключи с начальными ячейками 0..7 и 15 занимают ячейки 0..7 и 15,
+        // и следующий ключ с начальной ячейкой 15 попадает в ячейку 8 первой группы, лежащую до его начальной
+        IntHashTable<int> wrapped(16);
+        auto keyWithHome = [&](size_t home, int from) {
+            int key = from;
+            while (wrapped.homeOf(key) != home) {
+                key++;
+            }
+            return key;
+        };
+        vector<int> wrappedKeys;
+        for (size_t home = 0; home < 8; home++) {
+            wrappedKeys.push_back(keyWithHome(home, 0));
+        }
+        wrappedKeys.push_back(keyWithHome(15, 0));
+        wrappedKeys.push_back(keyWithHome(15, wrappedKeys.back() + 1));
+        for (int key : wrappedKeys) {
+            assert(wrapped.insertUnique(key));
+        }
+        assert(wrapped.capacity() == 16 && wrapped.size() == 10);
+        assert(wrapped.getListAtIndex(8) == wrappedKeys.back());
+        for (int key : wrappedKeys) {
+            assert(!wrapped.insertUnique(key));
+            assert(wrapped.contains(key));
+        }
+        wrapped.erase(wrappedKeys[8]);
+        assert(!wrapped.contains(wrappedKeys[8]) && wrapped.contains(wrappedKeys.back()));
+        // При ёмкости 4 начальная ячейка -- два старших бита перемешанного ключа
+        IntHashTable<uint64_t> wrappedWide(4);
+        uint64_t firstWide = 0;
+        while ((IntHashTable<uint64_t>::hash(firstWide) >> 62) != 3) {
+            firstWide++;
+        }
+        uint64_t secondWide = firstWide + 1;
+        while ((IntHashTable<uint64_t>::hash(secondWide) >> 62) != 3) {
+            secondWide++;
+        }
+        assert(wrappedWide.insertUnique(firstWide) && wrappedWide.insertUnique(secondWide));
+        assert(wrappedWide.capacity() == 4 && wrappedWide.contains(firstWide) && wrappedWide.contains(secondWide));
+
+        // Резервирование, копия, сжатие и очистка
+        IntHashTable<int> reserved(8);
+        reserved.reserve(1000);
+        size_t reservedCapacity = reserved.capacity();
+        for (int i = 0; i < 1000; i++) {
+            reserved.insert(i * 16);
+        }
+        assert(reserved.capacity() == reservedCapacity);
+        IntHashTable<int> copy = reserved;
+        copy.erase(0);
+        assert(reserved.contains(0));
+        assert(!copy.contains(0));
+        for (int i = 1; i < 1000; i++) {
+            copy.erase(i * 16);
+        }
+        assert(copy.size() == 0);
+        reserved.clear();
+        assert(reserved.size() == 0);
+        assert(!reserved.contains(16));
+        assert(reserved.memory_usage() == sizeof(reserved) + reservedCapacity * sizeof(int));
+
+#ifdef HASHLEGACY_STATS
+        // Последовательные ключи при загрузке 0.7 почти всегда находятся в первой группе
+        IntHashTable<int> statsTable(16);
+        for (int i = 0; i < 1000; i++) {
+            statsTable.insert(i);
+        }
+        statsTable.resetStats();
+        for (int i = 0; i < 2000; i++) {
+            statsTable.contains(i);
+        }
+        assert(statsTable.getStats().lookups == 2000);
+        assert(statsTable.getStats().averageProbeLength() < 1.0);
+#endif
+
+        cout << "All tests passed successfully!" << endl;
+    }
+};
+
+// Счётчик целых ключей: ключ -> число появлений. Ключи лежат в отдельном массиве с EmptyKey в свободных ячейках
+// и ищутся тем же зондированием группами, что и в IntHashTable; счётчики -- в параллельном массиве.
+// Удаления нет, поэтому ключи не сдвигаются, и номер ячейки ключа меняется только при перестройке.
+// Ключ, совпадающий со значением свободной ячейки, считать нельзя
+template <typename Key, Key EmptyKey = numeric_limits<Key>::max()>
+class IntCounter {
+private:
+    using Table = IntHashTable<Key, EmptyKey>;
+    static constexpr size_t groupSize = Table::groupSize;
+
+    // Ключи и EmptyKey в свободных ячейках
+    vector<Key> keys;
+    // Счётчик ключа той же ячейки
+    vector<size_t> counts;
+    size_t mask;
+    int shift;
+    // Количество различных ключей
+    size_t _size;
+    // Сумма счётчиков
+    size_t _total;
+
+    static constexpr double maxLoadFactor = 0.7;
+
+public:
+    explicit IntCounter(size_t capacity = 16) : mask(0), shift(0), _size(0), _total(0) {
+        allocate(Table::roundCapacity(capacity));
+    }
+
+    // Увеличение счётчика ключа на n за один проход зондирования. Возвращает новое значение счётчика.
+    // Бросает исключение invalid_argument для ключа, совпадающего со значением свободной ячейки
+        // Сложность: O(1) в среднем случае
+    size_t add(Key key, size_t n = 1) {
+        Table::checkKey(key);
+        size_t freeIndex = capacity();
+        size_t index = probe(key, freeIndex);
+        if (index == capacity()) {
+            if (capacityFor(_size + 1) > capacity()) {
+                rebuild(capacity() * 2);
+                probe(key, freeIndex);
+            }
+            index = freeIndex;
+            assert(index < capacity());
+            keys[index] = key;
+            _size++;
+        }
+        counts[index] += n;
+        _total += n;
+        return counts[index];
+    }
+
+    // Значение счётчика ключа (0, если ключ не встречался)
+        // Сложность: O(1) в среднем случае
+    size_t count(Key key) const {
+        if (key == EmptyKey) {
+            return 0;
+        }
+        size_t freeIndex = capacity();
+        size_t index = probe(key, freeIndex);
+        return index < capacity() ? counts[index] : 0;
+    }
+
+    // Прибавление счётчиков другого счётчика
+    void merge(const IntCounter& other) {
+        reserve(_size + other._size);
+        for (size_t i = 0; i < other.capacity(); ++i) {
+            if (other.keys[i] != EmptyKey) {
+                add(other.keys[i], other.counts[i]);
+            }
+        }
+    }
+
+    // Не более k ключей с наибольшими счётчиками, по убыванию; при равных счётчиках -- по возрастанию ключа
+        // Сложность: O(n log k)
+    vector<KeyValuePair<Key, size_t>> most_common(size_t k) const {
+        vector<size_t> order;
+        order.reserve(_size);
+        for (size_t i = 0; i < capacity(); ++i) {
+            if (keys[i] != EmptyKey) {
+                order.push_back(i);
+            }
+        }
+        k = min(k, order.size());
+        partial_sort(order.begin(), order.begin() + k, order.end(), [&](size_t a, size_t b) {
+            return counts[a] > counts[b] || (counts[a] == counts[b] && keys[a] < keys[b]);
+            });
+        vector<KeyValuePair<Key, size_t>> result;
+        result.reserve(k);
+        for (size_t i = 0; i < k; ++i) {
+            result.push_back(KeyValuePair<Key, size_t>(keys[order[i]], counts[order[i]]));
+        }
+        return result;
+    }
+
+    // Резервирование места под count различных ключей без перестроек
+    void reserve(size_t count) {
+        if (capacityFor(count) > capacity()) {
+            rebuild(capacityFor(count));
+        }
+    }
+
+    // Занятость ячейки, её ключ и счётчик -- для обхода всех ключей по номерам ячеек [0, capacity())
+    bool isOccupied(size_t index) const {
+        return keys[index] != EmptyKey;
+    }
+
+    Key keyAt(size_t index) const {
+        return keys[index];
+    }
+
+    size_t countAt(size_t index) const {
+        return counts[index];
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    // Сумма счётчиков всех ключей
+    size_t total() const {
+        return _total;
+    }
+
+    size_t capacity() const {
+        return keys.size();
+    }
+
+    // Объём памяти в байтах: объект и массивы ключей и счётчиков
+    size_t memory_usage() const {
+        return sizeof(*this) + keys.capacity() * sizeof(Key) + counts.capacity() * sizeof(size_t);
+    }
+
+    void clear() {
+        keys.assign(keys.size(), EmptyKey);
+        counts.assign(counts.size(), 0);
+        _size = 0;
+        _total = 0;
+    }
+
+private:
+    size_t capacityFor(size_t count) const {
+        size_t result = groupSize;
+        while (count >= result || (double)count / result > maxLoadFactor) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    void allocate(size_t capacity) {
+        keys.assign(capacity, EmptyKey);
+        counts.assign(capacity, 0);
+        mask = capacity - 1;
+        shift = 64;
+        for (size_t bits = capacity; bits > 1; bits >>= 1) {
+            shift--;
+        }
+    }
+
+    size_t homeOf(Key key) const {
+        return static_cast<size_t>(static_cast<uint64_t>(Table::hash(key)) >> shift) & mask;
+    }
+
+    // Зондирование группами IntHashTable::probeGroups. Возвращает индекс ячейки с ключом или capacity();
+    // в freeIndex -- первая свободная ячейка цепочки
+    size_t probe(Key key, size_t& freeIndex) const {
+        ProbeCounter counter;
+        return Table::probeGroups(keys.data(), mask, key, homeOf(key), freeIndex, counter);
+    }
+
+    void rebuild(size_t newCapacity) {
+        vector<Key> oldKeys = std::move(keys);
+        vector<size_t> oldCounts = std::move(counts);
+        allocate(max(Table::roundCapacity(newCapacity), capacityFor(_size)));
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldKeys[i] != EmptyKey) {
+                size_t freeIndex = capacity();
+                probe(oldKeys[i], freeIndex);
+                assert(freeIndex < capacity());
+                keys[freeIndex] = oldKeys[i];
+                counts[freeIndex] = oldCounts[i];
+            }
+        }
+    }
+
+public:
+    static void testAllMethods() {
+        IntCounter<uint64_t> counter(4);
+        assert(counter.count(7) == 0 && counter.size() == 0);
+        assert(counter.add(7) == 1 && counter.add(7, 4) == 5);
+        counter.add(uint64_t(1) << 40);
+        assert(counter.count(7) == 5 && counter.count(uint64_t(1) << 40) == 1 && counter.count(8) == 0);
+
+        // Рост таблицы сохраняет счётчики; ключи с общими младшими битами не мешают друг другу
+        for (uint64_t i = 0; i < 5000; i++) {
+            counter.add(i << 32, i % 7 + 1);
+        }
+        assert(counter.size() == 5001);
+        for (uint64_t i = 1; i < 5000; i++) {
+            assert(counter.count(i << 32) == i % 7 + 1 + (i == 256 ? 1 : 0));
+        }
+        assert(counter.count(0) == 1 && counter.count(uint64_t(1) << 40) == 1 + 256 % 7 + 1);
+
+        // Цепочка, обходящая конец таблицы: два ключа с последней начальной ячейкой при ёмкости в одну группу
+        IntCounter<uint64_t> wrapped(4);
+        uint64_t first = 0;
+        while ((Table::hash(first) >> 62) != 3) {
+            first++;
+        }
+        uint64_t second = first + 1;
+        while ((Table::hash(second) >> 62) != 3) {
+            second++;
+        }
+        assert(wrapped.add(first) == 1 && wrapped.add(second) == 1 && wrapped.add(second) == 2);
+        assert(wrapped.capacity() == 4 && wrapped.count(first) == 1 && wrapped.count(second) == 2);
+        for (uint64_t key = second + 1; wrapped.size() < 100; key++) {
+            wrapped.add(key);
+        }
+        assert(wrapped.count(first) == 1 && wrapped.count(second) == 2);
+
+        // Самые частые ключи: по убыванию счётчика, при равенстве -- по возрастанию ключа
+        IntCounter<int> small;
+        small.add(3, 2);
+        small.add(1, 5);
+        small.add(2, 2);
+        small.add(4, 1);
+        vector<KeyValuePair<int, size_t>> top = small.most_common(3);
+        assert(top.size() == 3 && top[0].key == 1 && top[1].key == 2 && top[2].key == 3 && top[2].value == 2);
+        assert(small.total() == 10);
+
+        // Слияние и обход по ячейкам
+        IntCounter<int> other;
+        other.add(1);
+        other.add(9, 3);
+        small.merge(other);
+        assert(small.count(1) == 6 && small.count(9) == 3 && small.size() == 5 && small.total() == 14);
+        size_t sum = 0;
+        for (size_t i = 0; i < small.capacity(); i++) {
+            if (small.isOccupied(i)) {
+                sum += small.countAt(i);
+                assert(small.count(small.keyAt(i)) == small.countAt(i));
+            }
+        }
+        assert(sum == small.total());
+
+        bool caught = false;
+        try {
+            small.add(numeric_limits<int>::max());
+        }
+        catch (const invalid_argument&) {
+            caught = true;
+        }
+        assert(caught);
+
+        small.clear();
+        assert(small.size() == 0 && small.total() == 0 && small.count(1) == 0);
+        assert(small.memory_usage() >= small.capacity() * (sizeof(int) + sizeof(size_t)));
+
+        cout << "All tests passed successfully!" << endl;
+    }
+};
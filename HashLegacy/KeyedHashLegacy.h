@@ -0,0 +1,228 @@
+#pragma once
+// Хеширование со случайным ключом (seed) для защиты от подбора коллизий.
+// Хеш-функции HashLegacy.h используют постоянные коэффициенты, и по ним легко подобрать ключи,
+// которые попадут в одну цепочку зондирования. Ключ хеширования выбирается случайно для каждой таблицы,
+// поэтому подобрать такие ключи заранее нельзя.
+//
+// Алгоритмы:
+//   SipHash -- SipHash-2-4, криптографически стойкая функция с 128-битным ключом (по умолчанию)
+//   WyHash  -- wyhash с 64-битным ключом: быстрее на длинных строках, но без гарантий стойкости
+//
+// Байты ключа читаются в порядке little-endian (x86, ARM)
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <type_traits>
+#include "PairLegacy.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+// Алгоритм хеширования с ключом
+enum class KeyedAlgorithm {
+    SipHash,
+    WyHash
+};
+
+// 128-битный ключ хеширования
+struct HashSeed {
+    uint64_t k0 = 0;
+    uint64_t k1 = 0;
+
+    // Случайный ключ: random_device, смешанный с текущим временем (random_device бывает детерминированным)
+    static HashSeed random() {
+        random_device device;
+        uint64_t now = static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+        HashSeed seed;
+        seed.k0 = ((uint64_t(device()) << 32) | device()) ^ now;
+        seed.k1 = ((uint64_t(device()) << 32) | device()) ^ (now * 0x9E3779B97F4A7C15ull);
+        return seed;
+    }
+};
+
+inline uint64_t rotateLeft64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t readLittle64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t readLittle32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// SipHash-2-4
+inline uint64_t sipHash24(const void* data, size_t length, const HashSeed& seed) {
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    uint64_t v0 = 0x736f6d6570736575ull ^ seed.k0;
+    uint64_t v1 = 0x646f72616e646f6dull ^ seed.k1;
+    uint64_t v2 = 0x6c7967656e657261ull ^ seed.k0;
+    uint64_t v3 = 0x7465646279746573ull ^ seed.k1;
+    auto round = [&]() {
+        v0 += v1; v1 = rotateLeft64(v1, 13); v1 ^= v0; v0 = rotateLeft64(v0, 32);
+        v2 += v3; v3 = rotateLeft64(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotateLeft64(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotateLeft64(v1, 17); v1 ^= v2; v2 = rotateLeft64(v2, 32);
+    };
+
+    size_t end = length - length % 8;
+    for (size_t i = 0; i < end; i += 8) {
+        uint64_t m = readLittle64(in + i);
+        v3 ^= m;
+        round();
+        round();
+        v0 ^= m;
+    }
+    uint64_t last = uint64_t(length) << 56;
+    for (size_t i = 0; i < length % 8; ++i) {
+        last |= uint64_t(in[end + i]) << (8 * i);
+    }
+    v3 ^= last;
+    round();
+    round();
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    round();
+    round();
+    round();
+    round();
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// Полное 128-битное произведение: младшая половина в a, старшая в b
+inline void multiply128(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(product);
+    b = static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    a = _umul128(a, b, &b);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = t < rl;
+    uint64_t low = t + (rm1 << 32);
+    carry += low < t;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    a = low;
+#endif
+}
+
+inline uint64_t wyMix(uint64_t a, uint64_t b) {
+    multiply128(a, b);
+    return a ^ b;
+}
+
+// wyhash (версия final4) с ключом seed и стандартными секретными константами
+inline uint64_t wyHash(const void* data, size_t length, uint64_t seed) {
+    static const uint64_t secret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    seed ^= wyMix(seed ^ secret[0], secret[1]);
+    uint64_t a;
+    uint64_t b;
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (readLittle32(p) << 32) | readLittle32(p + ((length >> 3) << 2));
+            b = (readLittle32(p + length - 4) << 32) | readLittle32(p + length - 4 - ((length >> 3) << 2));
+        }
+        else if (length > 0) {
+            a = (uint64_t(p[0]) << 16) | (uint64_t(p[length >> 1]) << 8) | p[length - 1];
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
+    }
+    else {
+        size_t i = length;
+        if (i > 48) {
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+            do {
+                seed = wyMix(readLittle64(p) ^ secret[1], readLittle64(p + 8) ^ seed);
+                see1 = wyMix(readLittle64(p + 16) ^ secret[2], readLittle64(p + 24) ^ see1);
+                see2 = wyMix(readLittle64(p + 32) ^ secret[3], readLittle64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wyMix(readLittle64(p) ^ secret[1], readLittle64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = readLittle64(p + i - 16);
+        b = readLittle64(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    multiply128(a, b);
+    return wyMix(a ^ secret[0] ^ length, b ^ secret[1]);
+}
+
+// Хеширование байтов выбранным алгоритмом
+inline uint64_t keyedHashBytes(const void* data, size_t length, const HashSeed& seed, KeyedAlgorithm algorithm) {
+    if (algorithm == KeyedAlgorithm::WyHash) {
+        return wyHash(data, length, seed.k0 ^ seed.k1);
+    }
+    return sipHash24(data, length, seed);
+}
+
+// Хеширование ключа с ключом хеширования. По умолчанию хешируется значение std::hash ключа;
+// для целых чисел и строк -- сами байты ключа, для пары ключ-значение -- только ключ.
+// Общий вариант защищает только от коллизий по модулю ёмкости: ключи с равным std::hash остаются равными
+// и после хеширования с ключом. Для типов, ключи которых может подобрать противник, нужна своя специализация,
+// хеширующая байты ключа (как KeyedHash<SymbolEntry> в SymbolLegacy.h)
+template <typename Key, typename Enable = void>
+struct KeyedHash {
+    static uint64_t hash(const Key& key, const HashSeed& seed, KeyedAlgorithm algorithm) {
+        uint64_t value = std::hash<Key>{}(key);
+        return keyedHashBytes(&value, sizeof(value), seed, algorithm);
+    }
+};
+
+template <typename Key>
+struct KeyedHash<Key, typename enable_if<is_integral<Key>::value>::type> {
+    static uint64_t hash(const Key& key, const HashSeed& seed, KeyedAlgorithm algorithm) {
+        return keyedHashBytes(&key, sizeof(key), seed, algorithm);
+    }
+};
+
+template <>
+struct KeyedHash<string> {
+    static uint64_t hash(const string& key, const HashSeed& seed, KeyedAlgorithm algorithm) {
+        return keyedHashBytes(key.data(), key.size(), seed, algorithm);
+    }
+};
+
+template <typename K, typename V>
+struct KeyedHash<KeyValuePair<K, V>> {
+    static uint64_t hash(const KeyValuePair<K, V>& pair, const HashSeed& seed, KeyedAlgorithm algorithm) {
+        return KeyedHash<K>::hash(pair.key, seed, algorithm);
+    }
+};
+
+// Хеш-функция с ключом для хеш-таблицы (подходит для function<size_t(const Key&)>)
+template <typename Key>
+struct SeededHash {
+    HashSeed seed;
+    KeyedAlgorithm algorithm = KeyedAlgorithm::SipHash;
+
+    size_t operator()(const Key& key) const {
+        return static_cast<size_t>(KeyedHash<Key>::hash(key, seed, algorithm));
+    }
+};
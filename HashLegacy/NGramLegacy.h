@@ -0,0 +1,349 @@
+#pragma once
+// Частоты n-грамм (пар, троек слов подряд) без строковых ключей. Слова нумеруются таблицей символов
+// (SymbolTable), n номеров подряд упаковываются в одно 64-битное число -- по 64 / n бит на номер,
+// первое слово в старших битах, -- и считаются в счётчике целых ключей IntCounter. Текст n-граммы
+// собирается только при выводе. N-граммы не пересекают границы документов (файлов).
+//
+// Файл делится на части по числу потоков по границам слов; поток считает n-граммы, начинающиеся в его части
+// (последние из них дочитывают до n - 1 слов следующей части), в свой счётчик со своей нумерацией слов.
+// Счётчики потоков затем сливаются в общий с переводом номеров, поэтому частоты не зависят от числа потоков
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "IntHashLegacy.h"
+#include "ParallelLegacy.h"
+#include "SymbolLegacy.h"
+#include "ZipfLegacy.h"
+
+using namespace std;
+
+class NGramCounter {
+public:
+    // Наибольшая длина n-граммы: у тройки на номер слова остаётся 21 бит
+    static constexpr size_t maxOrder = 3;
+
+private:
+    // Длина n-грамм и бит на номер слова в ключе
+    size_t n;
+    unsigned bits;
+    // Наибольший номер слова, помещающийся в ключ
+    uint64_t maxId;
+    // Маска n * bits младших битов ключа
+    uint64_t keyMask;
+    // Номера слов
+    SymbolTable symbols;
+    // Частоты упакованных n-грамм
+    IntCounter<uint64_t> counts;
+    // Номера последних слов документа, упакованные как ключ, и их число (не больше n)
+    uint64_t window;
+    size_t filled;
+
+public:
+    // Бросает исключение invalid_argument, если длина n-грамм вне [1, maxOrder]
+    explicit NGramCounter(size_t order = 2) : n(order), bits(0), maxId(0), keyMask(0), window(0), filled(0) {
+        if (order == 0 || order > maxOrder) {
+            throw invalid_argument("NGramCounter supports n-grams of 1 to 3 words");
+        }
+        // Для n = 1 ключ -- сам 32-битный номер; у пары он занимает все 64 бита
+        bits = order == 1 ? 32 : static_cast<unsigned>(64 / order);
+        maxId = order <= 2 ? SymbolTable::npos - 1 : (uint64_t(1) << bits) - 1;
+        keyMask = order * bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << (order * bits)) - 1;
+        // Слова приходят из файлов пользователя (см. wordHashAlgorithm)
+        symbols.useSeededHash(wordHashAlgorithm);
+    }
+
+    // Следующее слово документа; когда набралось n слов, считается n-грамма из последних n.
+    // Бросает исключение length_error, если различных слов больше, чем помещается в ключ (2^21 для троек)
+        // Сложность: O(1) в среднем случае
+    void add_word(string_view word) {
+        uint64_t id = symbols.intern(word);
+        if (id > maxId) {
+            throw length_error("NGramCounter vocabulary exceeds the key width");
+        }
+        window = ((window << bits) | id) & keyMask;
+        if (filled < n) {
+            filled++;
+        }
+        if (filled == n) {
+            counts.add(window);
+        }
+    }
+
+    // Конец документа: следующие n-граммы начинаются с нового слова
+    void end_document() {
+        window = 0;
+        filled = 0;
+    }
+
+    // Прибавление частот другого счётчика той же длины: номера его слов переводятся в номера этого.
+    // Бросает исключение invalid_argument при разной длине n-грамм
+    void merge(const NGramCounter& other) {
+        if (other.n != n) {
+            throw invalid_argument("NGramCounter merge requires equal n-gram lengths");
+        }
+        vector<uint64_t> translation;
+        translation.reserve(other.symbols.size());
+        for (string_view word : other.symbols) {
+            uint64_t id = symbols.intern(word);
+            if (id > maxId) {
+                throw length_error("NGramCounter vocabulary exceeds the key width");
+            }
+            translation.push_back(id);
+        }
+        counts.reserve(counts.size() + other.counts.size());
+        uint64_t idMask = (uint64_t(1) << bits) - 1;
+        for (size_t i = 0; i < other.counts.capacity(); ++i) {
+            if (other.counts.isOccupied(i)) {
+                uint64_t key = other.counts.keyAt(i);
+                uint64_t translated = 0;
+                for (size_t j = n; j-- > 0;) {
+                    translated = (translated << bits) | translation[(key >> (j * bits)) & idMask];
+                }
+                counts.add(translated, other.counts.countAt(i));
+            }
+        }
+    }
+
+    // Частота n-граммы из слов words (0, если такой n-граммы не было или длина не равна n)
+        // Сложность: O(n) в среднем случае
+    size_t count(const vector<string_view>& words) const {
+        if (words.size() != n) {
+            return 0;
+        }
+        uint64_t key = 0;
+        for (string_view word : words) {
+            uint32_t id = symbols.find(word);
+            if (id == SymbolTable::npos) {
+                return 0;
+            }
+            key = (key << bits) | id;
+        }
+        return counts.count(key);
+    }
+
+    // Не более k самых частых n-грамм по убыванию частоты; текст n-граммы -- слова через пробел.
+    // При равных частотах n-граммы упорядочены по номерам слов, то есть по первому появлению
+    vector<KeyValuePair<string, size_t>> most_common(size_t k) const {
+        vector<KeyValuePair<string, size_t>> result;
+        for (const auto& pair : counts.most_common(k)) {
+            result.push_back(KeyValuePair<string, size_t>(text(pair.key), pair.value));
+        }
+        return result;
+    }
+
+    // Текст n-граммы по ключу: слова через пробел
+    string text(uint64_t key) const {
+        uint64_t idMask = (uint64_t(1) << bits) - 1;
+        string result;
+        for (size_t j = n; j-- > 0;) {
+            if (j + 1 < n) {
+                result += ' ';
+            }
+            result += symbols[static_cast<uint32_t>((key >> (j * bits)) & idMask)];
+        }
+        return result;
+    }
+
+    // Длина n-грамм
+    size_t order() const {
+        return n;
+    }
+
+    // Число различных n-грамм
+    size_t size() const {
+        return counts.size();
+    }
+
+    // Число всех n-грамм
+    size_t total() const {
+        return counts.total();
+    }
+
+    // Число различных слов
+    size_t vocabulary_size() const {
+        return symbols.size();
+    }
+
+    // Хешируются ли слова со случайным ключом
+    bool is_seeded() const {
+        return symbols.isSeeded();
+    }
+
+    // Объём памяти в байтах: таблица символов и счётчик ключей
+    size_t memory_usage() const {
+        return symbols.memory_usage() + counts.memory_usage();
+    }
+
+    static void testAllMethods();
+};
+
+// Подсчёт n-грамм одного текста в памяти threadCount потоками: у потока t своя часть текста и свой счётчик parts[t]
+inline void count_ngrams_in_text(const string& text, vector<NGramCounter>& parts) {
+    size_t workers = parts.size();
+    size_t order = parts[0].order();
+    // Границы частей сдвигаются вперёд до пробельного символа, чтобы не разрывать слова
+    vector<size_t> bounds(workers + 1, text.size());
+    for (size_t t = 0; t < workers; ++t) {
+        size_t bound = partBound(text.size(), workers, t);
+        while (bound > 0 && bound < text.size() && !isWordSeparator(text[bound - 1])) {
+            bound++;
+        }
+        bounds[t] = bound;
+    }
+    parallelRun(workers, [&](size_t t) {
+        NGramCounter& counter = parts[t];
+        size_t begin = bounds[t];
+        size_t end = max(begin, bounds[t + 1]);
+        for_each_word_in_text(text.data() + begin, end - begin, [&](const string& word) { counter.add_word(word); });
+        // Дочитывание n - 1 слов следующих частей: n-граммы, начавшиеся в этой части, заканчиваются там
+        size_t extra = 0;
+        size_t i = end;
+        while (extra + 1 < order && i < text.size()) {
+            while (i < text.size() && isWordSeparator(text[i])) {
+                i++;
+            }
+            size_t start = i;
+            while (i < text.size() && !isWordSeparator(text[i])) {
+                i++;
+            }
+            string word = clean_word(text.substr(start, i - start));
+            if (!word.empty()) {
+                counter.add_word(word);
+                extra++;
+            }
+        }
+        counter.end_document();
+    });
+}
+
+// Частоты n-грамм длины n в файлах filenames; каждый файл считается threadCount потоками (0 -- по числу ядер).
+// Файл читается в память целиком. Отсутствующие файлы пропускаются с сообщением
+inline NGramCounter load_ngram_counts_from_files(const vector<string>& filenames, size_t n = 2, size_t threadCount = 0) {
+    if (threadCount == 0) {
+        threadCount = defaultThreadCount();
+    }
+    vector<NGramCounter> parts;
+    for (size_t t = 0; t < threadCount; ++t) {
+        parts.emplace_back(n);
+    }
+    for (const string& filename : filenames) {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open()) {
+            cerr << "Файл не найден: " << filename << endl;
+            continue;
+        }
+        stringstream buffer;
+        buffer << file.rdbuf();
+        count_ngrams_in_text(buffer.str(), parts);
+    }
+    NGramCounter result = std::move(parts[0]);
+    for (size_t t = 1; t < parts.size(); ++t) {
+        result.merge(parts[t]);
+    }
+    return result;
+}
+
+// Обработка файла в режиме n-грамм: topK самых частых n-грамм (0 -- все) в файл частот и график
+inline void process_ngrams(const string& filename, size_t n, size_t topK = 0, const string& dataFilename = "data.txt", const string& chartFilename = "chart.txt", bool verbose = true, size_t threadCount = 0) {
+    NGramCounter ngrams = load_ngram_counts_from_files({ filename }, n, threadCount);
+    vector<KeyValuePair<string, size_t>> sorted_ngram_counts = ngrams.most_common(topK == 0 ? ngrams.size() : topK);
+    save_word_counts_to_file(sorted_ngram_counts, dataFilename);
+    generatePlantUMLGraph(sorted_ngram_counts, chartFilename);
+
+    if (verbose) {
+        for (const auto& pair : sorted_ngram_counts) {
+            cout << pair.key << ": " << pair.value << endl;
+        }
+        cout << n << "-грамм: " << ngrams.total() << ", различных: " << ngrams.size()
+            << ", слов: " << ngrams.vocabulary_size() << ", память: " << ngrams.memory_usage() << " байт" << endl;
+    }
+}
+
+inline void NGramCounter::testAllMethods() {
+    // Пары и тройки одного документа
+    NGramCounter bigrams(2);
+    NGramCounter trigrams(3);
+    for (string_view word : { "the", "cat", "and", "the", "cat", "sat" }) {
+        bigrams.add_word(word);
+        trigrams.add_word(word);
+    }
+    assert(bigrams.total() == 5 && bigrams.size() == 4);
+    assert(bigrams.count({ "the", "cat" }) == 2 && bigrams.count({ "cat", "the" }) == 0);
+    assert(bigrams.count({ "cat", "sat" }) == 1 && bigrams.count({ "dog", "sat" }) == 0 && bigrams.count({ "the" }) == 0);
+    assert(trigrams.total() == 4 && trigrams.count({ "the", "cat", "and" }) == 1);
+    vector<KeyValuePair<string, size_t>> top = bigrams.most_common(2);
+    assert(top.size() == 2 && top[0].key == "the cat" && top[0].value == 2 && top[1].key == "cat and");
+    assert(trigrams.most_common(1)[0].key == "the cat and");
+
+    // N-граммы не пересекают границу документа
+    bigrams.end_document();
+    bigrams.add_word("dog");
+    assert(bigrams.count({ "sat", "dog" }) == 0 && bigrams.total() == 5);
+    bigrams.add_word("sat");
+    assert(bigrams.count({ "dog", "sat" }) == 1);
+
+    // Слова: ключ -- сам номер
+    NGramCounter unigrams(1);
+    for (string_view word : { "a", "b", "a" }) {
+        unigrams.add_word(word);
+    }
+    assert(unigrams.count({ "a" }) == 2 && unigrams.most_common(1)[0].key == "a");
+
+    // Слияние переводит номера слов: у второго счётчика другой порядок слов
+    NGramCounter other(2);
+    for (string_view word : { "sat", "the", "cat" }) {
+        other.add_word(word);
+    }
+    bigrams.merge(other);
+    assert(bigrams.count({ "the", "cat" }) == 3 && bigrams.count({ "sat", "the" }) == 1 && bigrams.total() == 8);
+    [[maybe_unused]] bool caught = false;
+    try {
+        bigrams.merge(trigrams);
+    }
+    catch (const invalid_argument&) {
+        caught = true;
+    }
+    assert(caught);
+    caught = false;
+    try {
+        NGramCounter tooLong(4);
+    }
+    catch (const invalid_argument&) {
+        caught = true;
+    }
+    assert(caught);
+
+    // Подсчёт файла несколькими потоками совпадает с однопоточным, в том числе n-граммы на границах частей
+    // Слова из букв: цифры при очистке слов отбрасываются
+    auto wordOf = [](int k) { return string(1, static_cast<char>('a' + k % 26)) + static_cast<char>('a' + k / 26); };
+    string text;
+    for (int i = 0; i < 3000; i++) {
+        text += wordOf(i % 37) + (i % 5 == 0 ? ",\n" : " ");
+    }
+    string path = (filesystem::temp_directory_path() / ("hashlegacy_ngram_test_" + to_string(reinterpret_cast<uintptr_t>(&text)) + ".txt")).string();
+    ofstream(path) << text;
+    NGramCounter serial = load_ngram_counts_from_files({ path, path + ".missing" }, 3, 1);
+    NGramCounter parallel = load_ngram_counts_from_files({ path }, 3, 7);
+    remove(path.c_str());
+    assert(serial.total() == 2998 && parallel.total() == 2998);
+    assert(serial.size() == parallel.size());
+    vector<KeyValuePair<string, size_t>> serialTop = serial.most_common(serial.size());
+    vector<KeyValuePair<string, size_t>> parallelTop = parallel.most_common(parallel.size());
+    for (size_t i = 0; i < serialTop.size(); i++) {
+        assert(serialTop[i].key == parallelTop[i].key && serialTop[i].value == parallelTop[i].value);
+    }
+    assert(serial.count({ wordOf(0), wordOf(1), wordOf(2) }) == 3000 / 37 + 1);
+    assert(serial.memory_usage() > 0);
+    assert(bigrams.is_seeded() && serial.is_seeded() && parallel.is_seeded());
+
+    cout << "All tests passed successfully!" << endl;
+}
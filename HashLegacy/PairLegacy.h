@@ -1,4 +1,6 @@
 #pragma once
+#include <type_traits>
+#include <utility>
 
 // Класс пары ключ-значение
 template <typename K, typename V>
@@ -22,6 +24,18 @@ public:
         return *this;
     }
 
+    // Перемещение пары: ключ и значение забираются без копирования (перехеширование, слияние словарей)
+    KeyValuePair(KeyValuePair&& other) noexcept(std::is_nothrow_move_constructible<K>::value && std::is_nothrow_move_constructible<V>::value)
+        : key(std::move(other.key)), value(std::move(other.value)) {}
+
+    KeyValuePair& operator=(KeyValuePair&& other) noexcept(std::is_nothrow_move_assignable<K>::value && std::is_nothrow_move_assignable<V>::value) {
+        if (this != &other) {
+            key = std::move(other.key);
+            value = std::move(other.value);
+        }
+        return *this;
+    }
+
     bool operator==(const KeyValuePair& other) const { // Оператор сравнения
         return key == other.key;
     }
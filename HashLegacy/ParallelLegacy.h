@@ -0,0 +1,111 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+// Число потоков по умолчанию для параллельных операций
+inline size_t defaultThreadCount() {
+    size_t count = thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+// Граница part-й из parts равных частей диапазона [0, count), округлённая вверх до кратного align.
+// partBound(count, parts, 0) == 0, partBound(count, parts, parts) == count
+inline size_t partBound(size_t count, size_t parts, size_t part, size_t align = 1) {
+    if (part >= parts) {
+        return count;
+    }
+    size_t bound = count / parts * part + count % parts * part / parts;
+    bound = (bound + align - 1) / align * align;
+    return min(bound, count);
+}
+
+// Запуск body(номер потока) в threadCount потоках. Нулевая часть выполняется в вызывающем потоке.
+// body не должен бросать исключений: исключение в рабочем потоке завершает программу
+template <typename Body>
+void parallelRun(size_t threadCount, Body body) {
+    vector<thread> workers;
+    for (size_t t = 1; t < threadCount; ++t) {
+        workers.emplace_back(body, t);
+    }
+    body(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Ограниченная очередь между потоками конвейера. push ждёт, пока в очереди освободится место
+// (так медленная стадия тормозит быструю, и память не растёт), pop ждёт элемента.
+// После close() push отказывает, а pop отдаёт оставшиеся элементы и затем возвращает false
+template <typename T>
+class BoundedQueue {
+private:
+    deque<T> items;
+    size_t limit;
+    bool closed;
+    mutable mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+
+public:
+    explicit BoundedQueue(size_t capacity) : limit(max<size_t>(1, capacity)), closed(false) {}
+
+    // Добавление элемента. Возвращает false, если очередь закрыта
+    bool push(T item) {
+        unique_lock<mutex> guard(lock);
+        notFull.wait(guard, [this]() { return closed || items.size() < limit; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Извлечение элемента с ожиданием. Возвращает false, если очередь закрыта и пуста
+    bool pop(T& item) {
+        unique_lock<mutex> guard(lock);
+        notEmpty.wait(guard, [this]() { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Извлечение элемента без ожидания. Возвращает false, если очередь пуста
+    bool tryPop(T& item) {
+        lock_guard<mutex> guard(lock);
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Закрытие очереди: будит все ожидающие потоки
+    void close() {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    size_t size() const {
+        lock_guard<mutex> guard(lock);
+        return items.size();
+    }
+
+    size_t capacity() const {
+        return limit;
+    }
+};
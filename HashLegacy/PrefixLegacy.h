@@ -0,0 +1,408 @@
+#pragma once
+// Индекс строковых ключей для запросов по префиксу и диапазону: ключи в отсортированном массиве
+// и массив LCP -- длин общих префиксов соседних ключей. Текст ключей хранится один раз, в арене индекса.
+//
+// Ключи с префиксом p идут подряд, и обе границы их отрезка находятся двоичным поиском, O(|p| log n):
+// число ключей с префиксом считается без их обхода, а выдача стоит O(|p| log n + k), k -- размер ответа,
+// вместо обхода всей хеш-таблицы. Массив LCP даёт общее продолжение префикса для автодополнения без сравнения строк.
+//
+// PrefixIndex строится по ключам неизменяемой таблицы (например, снимка Dictionary::snapshot).
+// IndexedDictionary ведёт индекс рядом со словарём и перестраивает его лениво, при первом запросе после изменений
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "ArenaLegacy.h"
+#include "DictionaryLegacy.h"
+
+using namespace std;
+
+class PrefixIndex {
+private:
+    // Текст ключей
+    StringArena arena;
+    // Ключи по возрастанию, без повторов
+    vector<string_view> keys;
+    // lcp[i] -- длина общего префикса keys[i - 1] и keys[i]; lcp[0] = 0
+    vector<uint32_t> lcp;
+
+    static uint32_t commonPrefix(string_view a, string_view b) {
+        size_t limit = min(a.size(), b.size());
+        size_t length = 0;
+        while (length < limit && a[length] == b[length]) {
+            length++;
+        }
+        return static_cast<uint32_t>(min<size_t>(length, UINT32_MAX));
+    }
+
+    void buildLcp() {
+        lcp.assign(keys.size(), 0);
+        for (size_t i = 1; i < keys.size(); ++i) {
+            lcp[i] = commonPrefix(keys[i - 1], keys[i]);
+        }
+    }
+
+    // Сортировка и удаление повторов ключей, уже лежащих в арене
+    void sortKeys() {
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+        buildLcp();
+    }
+
+public:
+    PrefixIndex() = default;
+
+    // Индекс ключей словаря. Текст копируется, поэтому словарь после построения можно изменять
+        // Сложность: O(n log n) сравнений строк
+    template <typename Value, typename Slots, size_t InlineCapacity, typename Filter>
+    static PrefixIndex of(const Dictionary<string, Value, Slots, InlineCapacity, Filter>& dictionary) {
+        PrefixIndex index;
+        index.keys.reserve(dictionary.size());
+        for (const auto& pair : dictionary) {
+            index.keys.push_back(index.arena.store(pair.key));
+        }
+        index.sortKeys();
+        return index;
+    }
+
+    // Замена ключей индекса на keys
+    void assign(const vector<string_view>& newKeys) {
+        clear();
+        keys.reserve(newKeys.size());
+        for (string_view key : newKeys) {
+            keys.push_back(arena.store(key));
+        }
+        sortKeys();
+    }
+
+    // Добавление ключей слиянием с уже отсортированными: O(n + m log m) вместо сортировки всех заново
+    void insert(const vector<string_view>& newKeys) {
+        vector<string_view> added;
+        added.reserve(newKeys.size());
+        for (string_view key : newKeys) {
+            added.push_back(arena.store(key));
+        }
+        sort(added.begin(), added.end());
+        vector<string_view> merged;
+        merged.reserve(keys.size() + added.size());
+        std::merge(keys.begin(), keys.end(), added.begin(), added.end(), back_inserter(merged));
+        merged.erase(unique(merged.begin(), merged.end()), merged.end());
+        keys.swap(merged);
+        buildLcp();
+    }
+
+    // Позиции [first, last) ключей, начинающихся с prefix. За first ключи с префиксом идут подряд,
+    // поэтому last -- первый ключ без префикса, найденный вторым двоичным поиском
+        // Сложность: O(|prefix| log n)
+    pair<size_t, size_t> prefix_range(string_view prefix) const {
+        auto first = lower_bound(keys.begin(), keys.end(), prefix);
+        auto last = partition_point(first, keys.end(), [prefix](string_view key) {
+            return key.substr(0, prefix.size()) == prefix;
+        });
+        return { static_cast<size_t>(first - keys.begin()), static_cast<size_t>(last - keys.begin()) };
+    }
+
+    // Позиции [first, last) ключей из диапазона [low, high)
+        // Сложность: O((|low| + |high|) log n)
+    pair<size_t, size_t> range(string_view low, string_view high) const {
+        size_t first = lower_bound(keys.begin(), keys.end(), low) - keys.begin();
+        size_t last = lower_bound(keys.begin() + first, keys.end(), high) - keys.begin();
+        return { first, max(first, last) };
+    }
+
+    // Ключи с префиксом prefix по возрастанию; limit -- наибольшее число ключей (0 -- все)
+    vector<string_view> with_prefix(string_view prefix, size_t limit = 0) const {
+        pair<size_t, size_t> found = prefix_range(prefix);
+        size_t last = limit == 0 ? found.second : min(found.second, found.first + limit);
+        return vector<string_view>(keys.begin() + found.first, keys.begin() + last);
+    }
+
+    // Число ключей с префиксом prefix, без обхода ключей
+        // Сложность: O(|prefix| log n)
+    size_t count_prefix(string_view prefix) const {
+        pair<size_t, size_t> found = prefix_range(prefix);
+        return found.second - found.first;
+    }
+
+    // Самое длинное продолжение prefix, общее для всех ключей с этим префиксом (для автодополнения),
+    // целыми символами UTF-8. Если таких ключей нет, возвращается prefix
+    string complete(string_view prefix) const {
+        pair<size_t, size_t> found = prefix_range(prefix);
+        if (found.first == found.second) {
+            return string(prefix);
+        }
+        size_t length = keys[found.first].size();
+        for (size_t i = found.first + 1; i < found.second; ++i) {
+            length = min<size_t>(length, lcp[i]);
+        }
+        // Общий префикс байтов может разрезать символ UTF-8: продолжение обрезается до начала символа
+        string_view key = keys[found.first];
+        while (length > prefix.size() && length < key.size() && (static_cast<unsigned char>(key[length]) & 0xC0) == 0x80) {
+            length--;
+        }
+        return string(key.substr(0, length));
+    }
+
+    // Ключ по позиции в порядке возрастания
+    string_view operator[](size_t position) const {
+        return keys[position];
+    }
+
+    size_t size() const {
+        return keys.size();
+    }
+
+    bool empty() const {
+        return keys.empty();
+    }
+
+    void clear() {
+        keys.clear();
+        lcp.clear();
+        arena.clear();
+    }
+
+    // Объём памяти в байтах: текст ключей, массивы ключей и LCP
+    size_t memory_usage() const {
+        return arena.memory_usage() + keys.capacity() * sizeof(string_view) + lcp.capacity() * sizeof(uint32_t);
+    }
+
+    vector<string_view>::const_iterator begin() const {
+        return keys.begin();
+    }
+
+    vector<string_view>::const_iterator end() const {
+        return keys.end();
+    }
+
+    static void testAllMethods();
+};
+
+// Словарь со строковыми ключами и индексом ключей для запросов по префиксу и диапазону.
+// Изменения словаря не трогают индекс: новые ключи копятся и вливаются в индекс при следующем запросе,
+// а после удалений (или когда новых ключей много) индекс строится заново. Запросы константные, но могут
+// перестроить индекс, поэтому одновременные запросы из нескольких потоков недопустимы
+template <typename Value>
+class IndexedDictionary {
+private:
+    Dictionary<string, Value> dictionary;
+    // Индекс ключей словаря и ключи, добавленные после его построения
+    mutable PrefixIndex index;
+    mutable vector<string> pending;
+    // Индекс нужно строить заново
+    mutable bool stale;
+
+    // Приведение индекса к ключам словаря перед запросом
+    void refresh() const {
+        if (stale) {
+            index = PrefixIndex::of(dictionary);
+            pending.clear();
+            stale = false;
+        }
+        else if (!pending.empty()) {
+            index.insert(vector<string_view>(pending.begin(), pending.end()));
+            pending.clear();
+        }
+    }
+
+    // Учёт нового ключа: слияние с индексом выгоднее перестройки, пока новых ключей немного
+    void added(const string& key) {
+        if (stale) {
+            return;
+        }
+        if (pending.size() >= dictionary.size() / 8 + 16) {
+            stale = true;
+            pending.clear();
+            return;
+        }
+        pending.push_back(key);
+    }
+
+public:
+    explicit IndexedDictionary(size_t capacity = 47) : dictionary(capacity), stale(false) {}
+
+    IndexedDictionary(const IndexedDictionary& other) : dictionary(other.dictionary), stale(true) {}
+
+    IndexedDictionary& operator=(const IndexedDictionary& other) {
+        dictionary = other.dictionary;
+        index.clear();
+        pending.clear();
+        stale = true;
+        return *this;
+    }
+
+    IndexedDictionary(IndexedDictionary&&) = default;
+    IndexedDictionary& operator=(IndexedDictionary&&) = default;
+
+    // Вставка пары; если ключ уже есть, значение обновляется (см. Dictionary::insert)
+    void insert(const string& key, const Value& value) {
+        Value* existing = dictionary.find(key);
+        if (existing != nullptr) {
+            *existing = value;
+            return;
+        }
+        dictionary.insert(key, value);
+        added(key);
+    }
+
+    void erase(const string& key) {
+        if (dictionary.contains(key)) {
+            dictionary.erase(key);
+            stale = true;
+            pending.clear();
+        }
+    }
+
+    // Изменение значений через find и operator[] индекс не затрагивает
+    Value* find(const string& key) {
+        return dictionary.find(key);
+    }
+
+    const Value* find(const string& key) const {
+        return dictionary.find(key);
+    }
+
+    // Получение значения по ключу. Бросает исключение runtime_error, если ключ не найден
+    Value& operator[](const string& key) {
+        return dictionary[key];
+    }
+
+    const Value& operator[](const string& key) const {
+        return dictionary[key];
+    }
+
+    bool contains(const string& key) const {
+        return dictionary.contains(key);
+    }
+
+    size_t size() const {
+        return dictionary.size();
+    }
+
+    // Словарь без индекса (только для чтения)
+    const Dictionary<string, Value>& table() const {
+        return dictionary;
+    }
+
+    // Пары с ключами, начинающимися с prefix, по возрастанию ключа; limit -- наибольшее число пар (0 -- все).
+    // Ключи ответа указывают в индекс и действительны до следующего изменения словаря
+        // Сложность: O(|prefix| log n + k) после приведения индекса
+    vector<KeyValuePair<string_view, Value>> with_prefix(string_view prefix, size_t limit = 0) const {
+        refresh();
+        vector<KeyValuePair<string_view, Value>> result;
+        for (string_view key : index.with_prefix(prefix, limit)) {
+            result.push_back(KeyValuePair<string_view, Value>(key, dictionary[string(key)]));
+        }
+        return result;
+    }
+
+    // Пары с ключами из диапазона [low, high) по возрастанию ключа
+    vector<KeyValuePair<string_view, Value>> range(string_view low, string_view high) const {
+        refresh();
+        pair<size_t, size_t> found = index.range(low, high);
+        vector<KeyValuePair<string_view, Value>> result;
+        result.reserve(found.second - found.first);
+        for (size_t i = found.first; i < found.second; ++i) {
+            result.push_back(KeyValuePair<string_view, Value>(index[i], dictionary[string(index[i])]));
+        }
+        return result;
+    }
+
+    // Число ключей с префиксом prefix, без обхода ключей
+        // Сложность: O(|prefix| log n) после приведения индекса
+    size_t count_prefix(string_view prefix) const {
+        refresh();
+        return index.count_prefix(prefix);
+    }
+
+    // Самое длинное общее продолжение prefix среди ключей словаря (см. PrefixIndex::complete)
+    string complete(string_view prefix) const {
+        refresh();
+        return index.complete(prefix);
+    }
+
+    // Объём памяти в байтах: словарь, индекс и ключи, ещё не влитые в индекс
+    size_t memory_usage() const {
+        size_t bytes = dictionary.memory_usage() + index.memory_usage() + pending.capacity() * sizeof(string);
+        for (const string& key : pending) {
+            bytes += key.capacity();
+        }
+        return bytes;
+    }
+};
+
+inline void PrefixIndex::testAllMethods() {
+    Dictionary<string, size_t> words;
+    for (const char* word : { "благо", "благодать", "благословение", "блаженство", "бог", "a", "ab", "abc", "b" }) {
+        words.insert(word, string(word).size());
+    }
+
+    // Построение по неизменяемому снимку: изменения словаря после построения индекс не видит
+    PrefixIndex index = PrefixIndex::of(words.snapshot());
+    words.insert("благовест", 1);
+    assert(index.size() == 9 && index[0] == "a" && index[8] == "бог");
+    assert(index.count_prefix("благо") == 3 && index.count_prefix("бла") == 4 && index.count_prefix("") == 9);
+    vector<string_view> found = index.with_prefix("благо");
+    assert(found.size() == 3 && found[0] == "благо" && found[1] == "благодать" && found[2] == "благословение");
+    assert(index.with_prefix("благо", 2).size() == 2);
+    assert(index.count_prefix("благоз") == 0 && index.count_prefix("z") == 0 && index.count_prefix("abcd") == 0);
+
+    // Диапазоны [low, high)
+    pair<size_t, size_t> between = index.range("ab", "b");
+    assert(between.second - between.first == 2 && index[between.first] == "ab");
+    between = index.range("c", "a");
+    assert(between.first == between.second);
+
+    // Автодополнение: общее продолжение всех ключей с префиксом
+    assert(index.complete("бла") == "бла");
+    assert(index.complete("благос") == "благословение");
+    assert(index.complete("x") == "x");
+    assert(index.complete("a") == "a");
+
+    // Слияние новых ключей, повторы не добавляются
+    index.insert({ "благовест", "abc", "c" });
+    assert(index.size() == 11 && index.count_prefix("благо") == 4 && index.with_prefix("благо")[1] == "благовест");
+
+    // Границы двоичного поиска совпадают с подсчётом перебором для всех префиксов всех ключей
+    for (string_view key : index) {
+        for (size_t length = 0; length <= key.size(); length++) {
+            string_view prefix = key.substr(0, length);
+            [[maybe_unused]] size_t expected = count_if(index.begin(), index.end(), [prefix](string_view other) { return other.substr(0, prefix.size()) == prefix; });
+            assert(index.count_prefix(prefix) == expected);
+            assert(index.count_prefix(string(prefix) + "\xff") == 0);
+        }
+    }
+
+    // Словарь с индексом: новые ключи вливаются при запросе, после удаления индекс строится заново
+    IndexedDictionary<size_t> indexed;
+    for (int i = 0; i < 1000; i++) {
+        indexed.insert("key" + to_string(i), i);
+    }
+    assert(indexed.count_prefix("key99") == 11);
+    vector<KeyValuePair<string_view, size_t>> keys99 = indexed.with_prefix("key99");
+    assert(keys99.size() == 11 && keys99[0].key == "key99" && keys99[0].value == 99 && keys99[10].key == "key999");
+    indexed.insert("key99x", 7);
+    indexed.insert("key99", 100);
+    keys99 = indexed.with_prefix("key99");
+    assert(keys99.size() == 12 && keys99[0].value == 100 && keys99[1].key == "key990");
+    indexed.erase("key990");
+    indexed.erase("missing");
+    assert(indexed.count_prefix("key99") == 11 && indexed.size() == 1000);
+    vector<KeyValuePair<string_view, size_t>> ranged = indexed.range("key10", "key11");
+    assert(ranged.size() == 1 + 10 && ranged[0].key == "key10" && ranged[10].key == "key109");
+    assert(indexed.complete("key99") == "key99");
+    *indexed.find("key1") = 5;
+    assert(indexed.with_prefix("key1", 1)[0].value == 5);
+
+    // Копия перестраивает свой индекс
+    IndexedDictionary<size_t> copy = indexed;
+    copy.insert("zeta", 1);
+    assert(copy.count_prefix("z") == 1 && indexed.count_prefix("z") == 0);
+    assert(indexed.memory_usage() > indexed.table().memory_usage());
+
+    cout << "All tests passed successfully!" << endl;
+}
@@ -1,54 +1,116 @@
 #pragma once
 #include "HashLegacy.h"
+#include "FilterLegacy.h"
 
-// Шаблонный класс множества
+// Шаблонный класс множества. Slots -- способ хранения ячеек таблицы (см. SlotsLegacy.h).
+// До InlineCapacity элементов хранятся в самом объекте без выделения памяти (см. компактный режим HashTable).
+// Filter -- фильтр перед таблицей для быстрых ответов на поиски отсутствующих элементов (см. FilterLegacy.h)
+template <typename T, typename Slots = DenseSlots<T>, size_t InlineCapacity = 8, typename Filter = NoFilter>
+class Set;
+
+// Множество с копированием при записи: snapshot() и копирование стоят O(1) (см. CowSlots)
 template <typename T>
+using PersistentSet = Set<T, CowSlots<T>>;
+
+template <typename T, typename Slots, size_t InlineCapacity, typename Filter>
 class Set {
 private:
     // Хеш-таблица для хранения ключей
-    HashTable<T> table;
+    HashTable<T, Slots, InlineCapacity> table;
+    // Фильтр перед таблицей
+    FilterFront<Filter> filter;
 
 public:
     // Конструктор множества
     Set(size_t capacity = 10, function<size_t(const T&)> hashFunction = [](const T& val) { return HashTable<T>::defaultHash(val); }, double maxLoadFactor = 0.7) : table(capacity, hashFunction, maxLoadFactor) {}
 
-    // Добавление элемента в множество
+    // Добавление элемента в множество (один проход зондирования)
     void insert(const T& value) {
-        if (contains(value))
-            return;
-        table.insert(value);
+        if (table.insertUnique(value)) {
+            filter.inserted(table, value);
+        }
+    }
+
+    // Пакетное добавление диапазона элементов (итераторы произвольного доступа).
+    // При threadCount == 0 используется число аппаратных потоков
+    template <typename Iterator>
+    void insert_bulk(Iterator first, Iterator last, size_t threadCount = 0) {
+        table.insertUniqueBulk(first, last, threadCount);
+        filter.rebuild(table);
+    }
+
+    // Построение множества из диапазона элементов пакетной вставкой
+    template <typename Iterator>
+    static Set from_range(Iterator first, Iterator last, size_t threadCount = 0) {
+        Set result;
+        result.insert_bulk(first, last, threadCount);
+        return result;
     }
 
     // Удаление элемента из множества
     void erase(const T& value) {
         table.erase(value);
+        filter.erased(table);
     }
 
-    // Проверка наличия элемента в множестве
+    // Проверка наличия элемента в множестве. С фильтром большинство отсутствующих элементов отсекается до зондирования таблицы
     bool contains(const T& value) const {
-        return table.contains(value);
+        return filter.contains(table, value);
     }
 
 
     // Итератор для множества (используем итератор HashTable). Указывает на начало множества
-    typename HashTable<T>::iterator begin() {
+    typename HashTable<T, Slots, InlineCapacity>::iterator begin() {
         return table.begin();
     }
     // Итератор для множества (используем итератор HashTable). Указывает на начало множества
-    typename HashTable<T>::iterator end() {
+    typename HashTable<T, Slots, InlineCapacity>::iterator end() {
         return table.end();
     }
 
     // Итератор для множества (используем итератор HashTable). Указывает на начало множества
-    typename HashTable<T>::iterator begin() const {
+    typename HashTable<T, Slots, InlineCapacity>::iterator begin() const {
         return table.begin();
     }
     // Итератор для множества (используем итератор HashTable). Указывает на начало множества
-    typename HashTable<T>::iterator end() const {
+    typename HashTable<T, Slots, InlineCapacity>::iterator end() const {
         return table.end();
     }
 
 
+    // Накопленная статистика таблицы и фильтра множества (см. StatsLegacy.h)
+    HashTableStats getStats() const {
+        HashTableStats stats = table.getStats();
+        stats.filter = filter.getStats();
+        return stats;
+    }
+
+    // Сброс статистики таблицы и фильтра множества
+    void resetStats() {
+        table.resetStats();
+        filter.resetStats();
+    }
+
+    // Установка обработчика трассировки операций таблицы множества
+    void setTraceHook(TraceHook hook) {
+        table.setTraceHook(hook);
+    }
+
+    // Переход таблицы множества на хеш-функцию со случайным ключом (см. HashTable::useSeededHash)
+    void useSeededHash(KeyedAlgorithm algorithm = KeyedAlgorithm::SipHash) {
+        table.useSeededHash(algorithm);
+        filter.rebuild(table);
+    }
+
+    bool isSeeded() const {
+        return table.isSeeded();
+    }
+
+    // Объём памяти множества в байтах (см. HashTable::memory_usage), включая фильтр
+    size_t memory_usage() const {
+        return table.memory_usage() + filter.memoryUsage();
+    }
+
     // Размер множества
     size_t size() const {
         return table.size();
@@ -58,54 +120,132 @@ public:
         return size() == 0;
     }
 
-    // Пересечение множеств
-    Set<T> intersect(const Set<T>& other) const {
-        Set<T> result;
-        for (const T& value : *this) {
-            if (other.contains(value)) {
-                result.insert(value);
+    // Резервирование места под count элементов без перехеширований
+    void reserve(size_t count) {
+        table.reserve(count);
+        filter.rebuild(table);
+    }
+
+    // Неизменяемый снимок множества: последующие изменения множества его не затрагивают.
+    // С CowSlots (PersistentSet) снимок стоит O(1) плюс копия фильтра, а ячейки копируются поблочно при первом изменении;
+    // снимок можно читать из другого потока, пока множество изменяется. С остальными способами хранения -- полная копия
+    Set snapshot() const {
+        return *this;
+    }
+
+    // Пересечение множеств. Обходит меньшее из множеств, проверяя элементы в большем
+    Set intersect(const Set& other) const {
+        const Set& smaller = size() <= other.size() ? *this : other;
+        const Set& larger = size() <= other.size() ? other : *this;
+        Set result = empty_like(smaller.size());
+        for (const T& value : smaller) {
+            if (larger.contains(value)) {
+                result.table.insert(value);
             }
         }
+        result.table.shrinkToFit();
+        result.filter.rebuild(result.table);
         return result;
     }
 
-    // Объединение множеств
-    Set<T> union_set(const Set<T>& other) const {
-        Set<T> result = *this; // Копируем текущее множество
-        for (const T& value : other) {
-            result.insert(value);
+    // Объединение множеств. Результат размечается сразу под оба множества,
+    // элементы большего вставляются без проверок, меньшего -- только отсутствующие в большем
+    Set union_set(const Set& other) const {
+        const Set& smaller = size() <= other.size() ? *this : other;
+        const Set& larger = size() <= other.size() ? other : *this;
+        Set result = empty_like(size() + other.size());
+        for (const T& value : larger) {
+            result.table.insert(value);
+        }
+        for (const T& value : smaller) {
+            if (!larger.contains(value)) {
+                result.table.insert(value);
+            }
         }
+        result.table.shrinkToFit();
+        result.filter.rebuild(result.table);
         return result;
     }
 
-    // Разность множеств
-    Set<T> difference(const Set<T>& other) const {
-        Set<T> result;
+    // Разность множеств. Если вычитаемое меньше, копирует текущее множество и удаляет из копии его элементы
+    Set difference(const Set& other) const {
+        if (other.size() < size()) {
+            Set result = *this;
+            result -= other;
+            return result;
+        }
+        Set result = empty_like(size());
         for (const T& value : *this) {
             if (!other.contains(value)) {
-                result.insert(value);
+                result.table.insert(value);
             }
         }
+        result.table.shrinkToFit();
+        result.filter.rebuild(result.table);
+        return result;
+    }
+
+    // Параллельное пересечение: ячейки меньшего множества делятся между потоками,
+    // найденные в большем элементы собираются и вставляются в результат пакетно
+    Set parallel_intersect(const Set& other, size_t threadCount = 0) const {
+        if (threadCount == 0) {
+            threadCount = defaultThreadCount();
+        }
+        const Set& smaller = size() <= other.size() ? *this : other;
+        const Set& larger = size() <= other.size() ? other : *this;
+        vector<T> values = parallel_collect(smaller, [&](const T& value) { return larger.contains(value); }, threadCount);
+        Set result = empty_like(values.size());
+        result.insert_bulk(values.begin(), values.end(), threadCount);
+        return result;
+    }
+
+    // Параллельное объединение: элементы большего множества и отсутствующие в нём элементы меньшего
+    // собираются потоками и вставляются в результат пакетно
+    Set parallel_union(const Set& other, size_t threadCount = 0) const {
+        if (threadCount == 0) {
+            threadCount = defaultThreadCount();
+        }
+        const Set& smaller = size() <= other.size() ? *this : other;
+        const Set& larger = size() <= other.size() ? other : *this;
+        vector<T> values = parallel_collect(larger, [](const T&) { return true; }, threadCount);
+        vector<T> extra = parallel_collect(smaller, [&](const T& value) { return !larger.contains(value); }, threadCount);
+        values.insert(values.end(), extra.begin(), extra.end());
+        Set result = empty_like(values.size());
+        result.insert_bulk(values.begin(), values.end(), threadCount);
+        return result;
+    }
+
+    // Параллельная разность: ячейки текущего множества делятся между потоками
+    Set parallel_difference(const Set& other, size_t threadCount = 0) const {
+        if (threadCount == 0) {
+            threadCount = defaultThreadCount();
+        }
+        vector<T> values = parallel_collect(*this, [&](const T& value) { return !other.contains(value); }, threadCount);
+        Set result = empty_like(values.size());
+        result.insert_bulk(values.begin(), values.end(), threadCount);
         return result;
     }
 
     // Пересечение множеств (перегрузка оператора &)
-    Set<T> operator&(const Set<T>& other) const {
+    Set operator&(const Set& other) const {
         return intersect(other);
     }
 
     // Объединение множеств (перегрузка оператора |)
-    Set<T> operator|(const Set<T>& other) const {
+    Set operator|(const Set& other) const {
         return union_set(other);
     }
 
     // Разность множеств (перегрузка оператора -)
-    Set<T> operator-(const Set<T>& other) const {
+    Set operator-(const Set& other) const {
         return difference(other);
     }
 
-    // Подмножество (перегрузка оператора <=)
-    bool operator<=(const Set<T>& other) const {
+    // Подмножество (перегрузка оператора <=). Большее множество не может быть подмножеством меньшего
+    bool operator<=(const Set& other) const {
+        if (size() > other.size()) {
+            return false;
+        }
         for (const T& value : *this) {
             if (!other.contains(value)) {
                 return false;
@@ -115,34 +255,101 @@ public:
     }
 
     // Надмножество (перегрузка оператора >=)
-    bool operator>=(const Set<T>& other) const {
+    bool operator>=(const Set& other) const {
         return other <= *this;
     }
 
-    // Равенство множеств (перегрузка оператора ==)
-    bool operator==(const Set<T>& other) const {
-        return (*this <= other) && (other <= *this);
+    // Равенство множеств (перегрузка оператора ==). При равных размерах достаточно одной проверки на подмножество
+    bool operator==(const Set& other) const {
+        return size() == other.size() && *this <= other;
     }
 
     // Неравенство множеств (перегрузка оператора !=)
-    bool operator!=(const Set<T>& other) const {
+    bool operator!=(const Set& other) const {
         return !(*this == other);
     }
 
     // Добавление элемента (перегрузка оператора +=)
-    Set<T>& operator+=(const T& value) {
+    Set& operator+=(const T& value) {
         insert(value);
         return *this;
     }
 
     // Добавление множества (перегрузка оператора += для множества)
-    Set<T>& operator+=(const Set<T>& other) {
+    Set& operator+=(const Set& other) {
+        return *this |= other;
+    }
+
+    // Пересечение на месте (перегрузка оператора &=)
+    Set& operator&=(const Set& other) {
+        if (&other != this) {
+            *this = intersect(other);
+        }
+        return *this;
+    }
+
+    // Объединение на месте (перегрузка оператора |=). Место резервируется один раз до вставок
+    Set& operator|=(const Set& other) {
+        if (&other == this) {
+            return *this;
+        }
+        table.reserve(size() + other.size());
         for (const T& value : other) {
-            insert(value);
+            table.insertUnique(value);
+        }
+        filter.rebuild(table);
+        return *this;
+    }
+
+    // Разность на месте (перегрузка оператора -=). Если вычитаемое меньше, удаляет его элементы,
+    // иначе строит разность обходом текущего множества
+    Set& operator-=(const Set& other) {
+        if (&other == this) {
+            table.clear();
+            filter.rebuild(table);
+        }
+        else if (other.size() < size()) {
+            for (const T& value : other) {
+                erase(value);
+            }
+        }
+        else {
+            *this = difference(other);
         }
         return *this;
     }
 
+private:
+    // Множество поверх готовой пустой таблицы
+    explicit Set(HashTable<T, Slots, InlineCapacity> table) : table(std::move(table)) {}
+
+    // Пустое множество с тем же состоянием хеширования (см. HashTable::emptyLike), рассчитанное на expected элементов.
+    // Результаты операций над множествами со случайным ключом хешируются со случайным ключом
+    Set empty_like(size_t expected) const {
+        return Set(table.emptyLike(static_cast<size_t>(expected / table.getMaxLoadFactor()) + 1));
+    }
+
+    // Отбор элементов source, удовлетворяющих keep. Диапазон ячеек таблицы делится между потоками,
+    // результаты потоков склеиваются в порядке ячеек
+    template <typename Predicate>
+    static vector<T> parallel_collect(const Set& source, Predicate keep, size_t threadCount) {
+        vector<vector<T>> parts(threadCount);
+        size_t cap = source.table.capacity();
+        parallelRun(threadCount, [&](size_t t) {
+            for (size_t i = partBound(cap, threadCount, t); i < partBound(cap, threadCount, t + 1); ++i) {
+                if (source.table.isOccupied(i) && keep(source.table.getListAtIndex(i))) {
+                    parts[t].push_back(source.table.getListAtIndex(i));
+                }
+            }
+        });
+        vector<T> result;
+        for (auto& part : parts) {
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        return result;
+    }
+
+public:
     static void test_set_operations() {
         Set<int> s1;
         s1.insert(1);
@@ -204,6 +411,54 @@ public:
         assert(s1.contains(5));
 
 
+        // Операции над множествами сильно разного размера
+        Set<int> big;
+        for (int i = 0; i < 1000; i++) {
+            big.insert(i);
+        }
+        Set<int> small;
+        small.insert(5);
+        small.insert(500);
+        small.insert(5000);
+
+        Set<int> small_and_big = small & big;
+        assert(small_and_big.size() == 2);
+        assert(small_and_big == (big & small));
+        assert(small_and_big.contains(5) && small_and_big.contains(500));
+
+        Set<int> small_or_big = small | big;
+        assert(small_or_big.size() == 1001);
+        assert(small_or_big == (big | small));
+        assert(small_or_big.contains(5000));
+
+        Set<int> big_minus_small = big - small;
+        assert(big_minus_small.size() == 998);
+        assert(!big_minus_small.contains(5) && big_minus_small.contains(6));
+        Set<int> small_minus_big = small - big;
+        assert(small_minus_big.size() == 1);
+        assert(small_minus_big.contains(5000));
+
+        assert(!(big <= small));
+        assert(small_and_big <= small && small_and_big <= big);
+        assert(big != small_or_big);
+
+        // Операции на месте
+        Set<int> in_place = big;
+        in_place &= small;
+        assert(in_place == small_and_big);
+        in_place |= small;
+        assert(in_place == small);
+        in_place -= big;
+        assert(in_place == small_minus_big);
+        in_place |= big;
+        assert(in_place == small_or_big);
+        in_place -= small;
+        assert(in_place.size() == 998);
+        in_place |= in_place;
+        assert(in_place.size() == 998);
+        in_place -= in_place;
+        assert(in_place.empty());
+
         Set<std::string> string_set;
         string_set.insert("hello");
         string_set.insert("world");
@@ -213,6 +468,76 @@ public:
 
     }
 
+    static void test_parallel_operations() {
+        vector<int> evens;
+        vector<int> thirds;
+        for (int i = 0; i < 100000; i++) {
+            evens.push_back(2 * i);
+            thirds.push_back(3 * i);
+        }
+        // Дубликаты во входном диапазоне
+        evens.insert(evens.end(), evens.begin(), evens.begin() + 1000);
+
+        Set<int> s1 = Set<int>::from_range(evens.begin(), evens.end(), 4);
+        Set<int> s2;
+        s2.insert(-1);
+        s2.insert_bulk(thirds.begin(), thirds.end(), 4);
+        assert(s1.size() == 100000);
+        assert(s2.size() == 100001);
+        assert(s1.contains(0) && s1.contains(199998) && !s1.contains(1));
+
+        Set<int> intersection = s1.parallel_intersect(s2, 4);
+        assert(intersection == (s1 & s2));
+        assert(intersection.size() == 33334);
+
+        Set<int> union_set = s1.parallel_union(s2, 4);
+        assert(union_set == (s1 | s2));
+        assert(union_set.size() == 100000 + 100001 - 33334);
+
+        Set<int> difference = s2.parallel_difference(s1, 4);
+        assert(difference == (s2 - s1));
+        assert(difference.contains(-1) && difference.contains(3) && !difference.contains(6));
+    }
+
+    static void test_snapshots() {
+        PersistentSet<string> live;
+        for (int i = 0; i < 1000; i++) {
+            live.insert("w" + to_string(i));
+        }
+
+        // Снимок не видит последующих изменений, в том числе перестроения таблицы
+        const PersistentSet<string> before = live.snapshot();
+        live.erase("w0");
+        for (int i = 1000; i < 5000; i++) {
+            live.insert("w" + to_string(i));
+        }
+        assert(before.size() == 1000 && live.size() == 4999);
+        assert(before.contains("w0") && !before.contains("w1000"));
+        assert(!live.contains("w0") && live.contains("w4999"));
+
+        // Операции над снимками дают те же результаты, что и над копиями
+        assert((live | before).size() == 5000);
+        assert((before - live).size() == 1 && (before & live).size() == 999);
+
+        // Читатель обходит снимок в своём потоке, пока писатель изменяет множество
+        const PersistentSet<string> frozen = live.snapshot();
+        size_t seen = 0;
+        parallelRun(2, [&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < 5000; i++) {
+                    live.erase("w" + to_string(i));
+                    live.insert("v" + to_string(i));
+                }
+            }
+            else {
+                for (const string& value : frozen) {
+                    seen += value[0] == 'w' ? 1 : 0;
+                }
+            }
+        });
+        assert(seen == 4999 && frozen.size() == 4999 && frozen.contains("w1"));
+        assert(live.size() == 5000 && !live.contains("w1") && live.contains("v1"));
+    }
 
     static void testAllMethods() {
         // Test insert, contains, and size
@@ -273,11 +598,105 @@ public:
         assert(s5.contains("ccc"));
         assert(s5.size() == 3);
 
+        // Маленькие множества не выделяют памяти, пока не превысят InlineCapacity элементов
+        Set<int> tiny;
+        size_t tiny_bytes = tiny.memory_usage();
+        for (int i = 0; i < 8; i++) {
+            tiny.insert(i * 7);
+        }
+        tiny.insert(14);
+        assert(tiny.size() == 8);
+        assert(tiny.memory_usage() == tiny_bytes);
+        assert((tiny & s1).size() <= tiny.size());
+        tiny.insert(100);
+        assert(tiny.memory_usage() > tiny_bytes);
+        assert(tiny.size() == 9);
+        for (int i = 0; i < 8; i++) {
+            assert(tiny.contains(i * 7));
+        }
+
+        // Множество с фильтром Блума: отсутствующие элементы отсекаются фильтром, операции не теряют элементов
+        Set<std::string, DenseSlots<std::string>, 8, BlockedBloomFilter> filtered;
+        for (int i = 0; i < 2000; i++) {
+            filtered.insert("in" + std::to_string(i));
+        }
+        for (int i = 0; i < 2000; i += 2) {
+            filtered.erase("in" + std::to_string(i));
+        }
+        for (int i = 0; i < 2000; i++) {
+            assert(filtered.contains("in" + std::to_string(i)) == (i % 2 == 1));
+        }
+        filtered.resetStats();
+        size_t filtered_misses = 0;
+        for (int i = 0; i < 10000; i++) {
+            filtered_misses += filtered.contains("out" + std::to_string(i)) ? 0 : 1;
+        }
+        assert(filtered_misses == 10000);
+#ifdef HASHLEGACY_STATS
+        // Ложные срабатывания фильтра -- около 1% поисков отсутствующих элементов
+        FilterStats filtered_stats = filtered.getStats().filter;
+        assert(filtered_stats.lookups == 10000);
+        assert(filtered_stats.rejects + filtered_stats.falsePositives == 10000);
+        assert(filtered_stats.falsePositiveRate() < 0.05);
+        // Параллельное пересечение ищет элементы большего множества из нескольких потоков
+        Set<std::string, DenseSlots<std::string>, 8, BlockedBloomFilter> filtered_probe;
+        for (int i = 0; i < 100; i++) {
+            filtered_probe.insert("in" + std::to_string(i));
+            filtered_probe.insert("out" + std::to_string(i));
+        }
+        filtered.resetStats();
+        assert(filtered.parallel_intersect(filtered_probe, 4).size() == 50);
+        filtered_stats = filtered.getStats().filter;
+        assert(filtered_stats.lookups == 200);
+        assert(filtered.getStats().lookups == 200 - filtered_stats.rejects);
+#endif
+        assert(filtered.memory_usage() > sizeof(filtered));
+        Set<std::string, DenseSlots<std::string>, 8, BlockedBloomFilter> filtered_other;
+        filtered_other.insert("in1");
+        filtered_other.insert("new");
+        assert((filtered & filtered_other).contains("in1"));
+        assert(!(filtered & filtered_other).contains("new"));
+        assert((filtered | filtered_other).contains("new"));
+        assert((filtered - filtered_other).size() == 999);
+        filtered |= filtered_other;
+        assert(filtered.contains("new"));
+        filtered -= filtered;
+        assert(!filtered.contains("in1"));
+        filtered.insert("again");
+        assert(filtered.contains("again"));
+
+        // Смена хеш-функции перестраивает фильтр
+        Set<int, DenseSlots<int>, 8, BlockedBloomFilter> seeded;
+        for (int i = 0; i < 1000; i++) {
+            seeded.insert(i * 65536);
+        }
+        seeded.useSeededHash();
+        for (int i = 0; i < 1000; i++) {
+            assert(seeded.contains(i * 65536));
+            assert(!seeded.contains(i * 65536 + 1));
+        }
+        seeded.erase(0);
+        assert(!seeded.contains(0) && seeded.size() == 999);
+        // Результаты операций сохраняют случайный ключ хеширования
+        Set<int, DenseSlots<int>, 8, BlockedBloomFilter> odd;
+        for (int i = 1; i < 2000; i += 2) {
+            odd.insert(i * 65536);
+        }
+        Set<int, DenseSlots<int>, 8, BlockedBloomFilter> seededUnion = seeded.union_set(odd), seededIntersection = seeded.intersect(odd),
+            seededDifference = seeded.difference(odd);
+        assert(seededUnion.isSeeded() && seededIntersection.isSeeded() && seededDifference.isSeeded());
+        assert(seeded.parallel_union(odd, 2).isSeeded() && seeded.parallel_intersect(odd, 2).isSeeded());
+        assert(seededUnion.size() == 1499 && seededIntersection.size() == 500 && seededDifference.size() == 499);
+        assert(seededDifference.contains(2 * 65536) && !seededDifference.contains(65536));
+        assert(!odd.union_set(odd).isSeeded());
+
         test_set_operations();
+        test_parallel_operations();
+        test_snapshots();
 
 
 
 
         cout << "All tests passed successfully!" << endl;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,89 @@
+#pragma once
+// Поиск значений в небольших массивах целых с помощью векторных инструкций SSE2.
+// Без SSE2 (или для других типов) используется обычный цикл
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASHLEGACY_SSE2 1
+#endif
+
+using namespace std;
+
+// Номер младшего установленного бита ненулевой маски
+inline unsigned lowestSetBit(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned bit = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// Маска совпадений value с четырьмя 32-битными значениями начиная с data: бит i -- совпадение data[i]
+inline unsigned simdMatch4x32(const void* data, uint32_t value) {
+#ifdef HASHLEGACY_SSE2
+    __m128i block = _mm_loadu_si128(static_cast<const __m128i*>(data));
+    __m128i equal = _mm_cmpeq_epi32(block, _mm_set1_epi32(static_cast<int>(value)));
+    return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(equal)));
+#else
+    uint32_t values[4];
+    memcpy(values, data, sizeof(values));
+    unsigned mask = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+        mask |= (values[i] == value ? 1u : 0u) << i;
+    }
+    return mask;
+#endif
+}
+
+// Маска совпадений value с двумя 64-битными значениями начиная с data: бит i -- совпадение data[i]
+inline unsigned simdMatch2x64(const void* data, uint64_t value) {
+#ifdef HASHLEGACY_SSE2
+    __m128i block = _mm_loadu_si128(static_cast<const __m128i*>(data));
+    __m128i equal = _mm_cmpeq_epi32(block, _mm_set1_epi64x(static_cast<long long>(value)));
+    // 64-битное значение совпадает, если совпали обе его 32-битные половины
+    equal = _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(equal)));
+#else
+    uint64_t values[2];
+    memcpy(values, data, sizeof(values));
+    return (values[0] == value ? 1u : 0u) | (values[1] == value ? 2u : 0u);
+#endif
+}
+
+// Индекс первого вхождения value в data[0..count) или count, если значения нет.
+// Для 32- и 64-битных целых сравнивается по 16 байт за шаг
+template <typename T>
+size_t simdFind(const T* data, size_t count, T value) {
+    size_t i = 0;
+    if constexpr (is_integral<T>::value && sizeof(T) == 4) {
+        for (; i + 4 <= count; i += 4) {
+            unsigned mask = simdMatch4x32(data + i, static_cast<uint32_t>(value));
+            if (mask != 0) {
+                return i + lowestSetBit(mask);
+            }
+        }
+    }
+    else if constexpr (is_integral<T>::value && sizeof(T) == 8) {
+        for (; i + 2 <= count; i += 2) {
+            unsigned mask = simdMatch2x64(data + i, static_cast<uint64_t>(value));
+            if (mask != 0) {
+                return i + ((mask & 1u) ? 0 : 1);
+            }
+        }
+    }
+    for (; i < count; ++i) {
+        if (data[i] == value) {
+            return i;
+        }
+    }
+    return count;
+}
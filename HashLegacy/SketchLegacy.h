@@ -0,0 +1,549 @@
+#pragma once
+// Приближённый подсчёт с ограниченной памятью: частоты (Count-Min Sketch, Count Sketch),
+// самые частые ключи (Space-Saving) и число различных ключей (HyperLogLog).
+// Память каждой структуры задаётся при создании и не растёт с объёмом входных данных.
+// Ключи хешируются хеш-функциями таблицы (по умолчанию fnv1aHash), результат перемешивается mixHash
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "HashLegacy.h"
+#include "DictionaryLegacy.h"
+
+using namespace std;
+
+// Число ведущих нулевых битов 64-битного значения (64 для нуля)
+inline unsigned leadingZeros64(uint64_t value) {
+    if (value == 0) {
+        return 64;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned count = 0;
+    while (!(value & (1ull << 63))) {
+        value <<= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Count-Min Sketch: depth строк по width счётчиков. Оценка частоты не меньше истинной
+// и с вероятностью 1 - delta превышает её не более чем на epsilon * total()
+template <typename Key>
+class CountMinSketch {
+public:
+    // Наибольшее число строк: номера ячеек ключа во всех строках собираются в массив на стеке
+    static constexpr size_t maxDepth = 32;
+
+private:
+    size_t width;
+    size_t depth;
+    // Счётчики построчно: строка row занимает [row * width, (row + 1) * width)
+    vector<size_t> counters;
+    function<size_t(const Key&)> hashFunction;
+    size_t _total;
+    // Консервативное обновление: увеличиваются только минимальные счётчики ключа. Уменьшает завышение оценок
+    bool conservative;
+
+    // Ячейки ключа в строках получаются двойным хешированием от одного вычисления хеш-функции
+    void cells(const Key& key, size_t* indexes) const {
+        uint64_t first = mixHash(hashFunction(key));
+        uint64_t second = mixHash(first) | 1;
+        assert(depth <= maxDepth);
+        for (size_t row = 0; row < depth; ++row) {
+            indexes[row] = row * width + static_cast<size_t>((first + row * second) % width);
+        }
+    }
+
+public:
+    // Конструктор по размерам таблицы счётчиков. Число строк приводится к [1, maxDepth]
+    CountMinSketch(size_t width, size_t depth, function<size_t(const Key&)> hashFunction = fnv1aHash<Key>, bool conservative = true)
+        : width(max<size_t>(width, 1)), depth(min<size_t>(max<size_t>(depth, 1), maxDepth)), counters(this->width * this->depth, 0),
+          hashFunction(hashFunction), _total(0), conservative(conservative) {}
+
+    // Создание по допустимой погрешности: width = e / epsilon, depth = ln(1 / delta), но не больше maxDepth
+    // (вероятность ошибки не меньше e^-32, что на практике не ограничение)
+    static CountMinSketch withError(double epsilon, double delta, function<size_t(const Key&)> hashFunction = fnv1aHash<Key>) {
+        size_t width = static_cast<size_t>(ceil(exp(1.0) / epsilon));
+        size_t depth = min<size_t>(static_cast<size_t>(ceil(log(1.0 / delta))), maxDepth);
+        return CountMinSketch(width, depth, hashFunction);
+    }
+
+    // Учёт count вхождений ключа. Возвращает новую оценку частоты ключа
+        // Сложность: O(depth)
+    size_t add(const Key& key, size_t count = 1) {
+        size_t indexes[maxDepth] = {};
+        cells(key, indexes);
+        _total += count;
+        size_t estimate = counters[indexes[0]];
+        for (size_t row = 1; row < depth; ++row) {
+            estimate = min(estimate, counters[indexes[row]]);
+        }
+        estimate += count;
+        for (size_t row = 0; row < depth; ++row) {
+            size_t& counter = counters[indexes[row]];
+            if (!conservative) {
+                counter += count;
+            }
+            else if (counter < estimate) {
+                counter = estimate;
+            }
+        }
+        return conservative ? estimate : this->estimate(key);
+    }
+
+    // Оценка частоты ключа сверху
+        // Сложность: O(depth)
+    size_t estimate(const Key& key) const {
+        size_t indexes[maxDepth] = {};
+        cells(key, indexes);
+        size_t result = counters[indexes[0]];
+        for (size_t row = 1; row < depth; ++row) {
+            result = min(result, counters[indexes[row]]);
+        }
+        return result;
+    }
+
+    // Объединение со скетчем тех же размеров (например, посчитанным по другой части данных).
+    // Бросает исключение invalid_argument, если размеры различаются
+    void merge(const CountMinSketch& other) {
+        if (width != other.width || depth != other.depth) {
+            throw invalid_argument("Sketch dimensions differ");
+        }
+        for (size_t i = 0; i < counters.size(); ++i) {
+            counters[i] += other.counters[i];
+        }
+        _total += other._total;
+    }
+
+    // Сумма всех учтённых вхождений
+    size_t total() const {
+        return _total;
+    }
+
+    size_t getWidth() const {
+        return width;
+    }
+
+    size_t getDepth() const {
+        return depth;
+    }
+
+    // Объём памяти в байтах
+    size_t memory_usage() const {
+        return sizeof(*this) + counters.capacity() * sizeof(size_t);
+    }
+
+    static void testCountMinSketch() {
+        CountMinSketch<int> sketch(200, 4);
+        for (int i = 0; i < 1000; i++) {
+            sketch.add(i % 100);
+        }
+        sketch.add(7, 500);
+        assert(sketch.total() == 1500);
+        // Оценка не меньше истинной частоты
+        for (int i = 0; i < 100; i++) {
+            assert(sketch.estimate(i) >= (i == 7 ? 510u : 10u));
+        }
+        assert(sketch.estimate(7) < 600);
+        assert(sketch.estimate(12345) <= 20);
+
+        // Оценки по допустимой погрешности: при epsilon = 0.001 завышение не больше 0.001 * total() почти всегда
+        CountMinSketch<string> words = CountMinSketch<string>::withError(0.001, 0.01);
+        assert(words.getWidth() == 2719);
+        assert(words.getDepth() == 5);
+        for (int i = 0; i < 20000; i++) {
+            words.add("word" + to_string(i % 2000));
+        }
+        size_t overestimated = 0;
+        for (int i = 0; i < 2000; i++) {
+            size_t estimate = words.estimate("word" + to_string(i));
+            assert(estimate >= 10);
+            if (estimate > 10 + words.total() / 1000) {
+                overestimated++;
+            }
+        }
+        assert(overestimated < 20);
+
+        // Число строк ограничено maxDepth и при явных размерах, и при очень малой вероятности ошибки
+        CountMinSketch<int> deep(16, 1000);
+        assert(deep.getDepth() == maxDepth);
+        assert(CountMinSketch<int>::withError(0.1, 1e-30).getDepth() == maxDepth);
+        assert(deep.add(3, 2) == 2 && deep.estimate(3) == 2);
+
+        // Объединение скетчей, посчитанных по частям
+        CountMinSketch<int> left(100, 3, fnv1aHash<int>, false);
+        CountMinSketch<int> right(100, 3, fnv1aHash<int>, false);
+        left.add(1, 5);
+        right.add(1, 7);
+        left.merge(right);
+        assert(left.estimate(1) >= 12);
+        assert(left.total() == 12);
+        bool caught = false;
+        try {
+            left.merge(sketch);
+        }
+        catch (const invalid_argument&) {
+            caught = true;
+        }
+        assert(caught);
+
+        cout << "All tests passed successfully!" << endl;
+    }
+};
+
+// Count Sketch: в каждой строке счётчик ключа меняется на +count или -count по знаковому хешу,
+// оценка -- медиана по строкам. Погрешность не накапливается в одну сторону, что точнее Count-Min
+// для ключей средней частоты; оценка может быть как больше, так и меньше истинной
+template <typename Key>
+class CountSketch {
+private:
+    size_t width;
+    size_t depth;
+    vector<long long> counters;
+    function<size_t(const Key&)> hashFunction;
+
+    // Ячейка и знак ключа в строке row
+    size_t cell(uint64_t hash, size_t row, long long& sign) const {
+        uint64_t mixed = mixHash(hash + row * 0x9E3779B97F4A7C15ull);
+        sign = (mixed >> 63) ? -1 : 1;
+        return row * width + static_cast<size_t>(mixed % width);
+    }
+
+public:
+    CountSketch(size_t width, size_t depth, function<size_t(const Key&)> hashFunction = fnv1aHash<Key>)
+        : width(max<size_t>(width, 1)), depth(max<size_t>(depth, 1)), counters(this->width * this->depth, 0), hashFunction(hashFunction) {}
+
+    // Учёт count вхождений ключа
+        // Сложность: O(depth)
+    void add(const Key& key, long long count = 1) {
+        uint64_t hash = hashFunction(key);
+        for (size_t row = 0; row < depth; ++row) {
+            long long sign;
+            size_t index = cell(hash, row, sign);
+            counters[index] += sign * count;
+        }
+    }
+
+    // Оценка частоты ключа (медиана оценок строк)
+        // Сложность: O(depth log depth)
+    long long estimate(const Key& key) const {
+        uint64_t hash = hashFunction(key);
+        vector<long long> estimates(depth);
+        for (size_t row = 0; row < depth; ++row) {
+            long long sign;
+            size_t index = cell(hash, row, sign);
+            estimates[row] = sign * counters[index];
+        }
+        nth_element(estimates.begin(), estimates.begin() + depth / 2, estimates.end());
+        return estimates[depth / 2];
+    }
+
+    // Объём памяти в байтах
+    size_t memory_usage() const {
+        return sizeof(*this) + counters.capacity() * sizeof(long long);
+    }
+
+    static void testCountSketch() {
+        CountSketch<int> sketch(256, 5);
+        for (int i = 0; i < 1000; i++) {
+            sketch.add(i % 100);
+        }
+        sketch.add(7, 500);
+        sketch.add(8, -5);
+        assert(llabs(sketch.estimate(7) - 510) <= 30);
+        assert(llabs(sketch.estimate(8) - 5) <= 30);
+        assert(llabs(sketch.estimate(12345)) <= 30);
+        assert(sketch.memory_usage() >= 256 * 5 * sizeof(long long));
+
+        cout << "All tests passed successfully!" << endl;
+    }
+};
+
+// Space-Saving: не более capacity отслеживаемых ключей с самыми большими счётчиками.
+// Новый ключ при заполнении вытесняет ключ с минимальным счётчиком и наследует его значение как погрешность.
+// Любой ключ с частотой больше total / capacity гарантированно отслеживается.
+// Счётчики хранятся в минимальной куче, позиции ключей в куче -- в словаре. Словарь заведён с двойным запасом:
+// каждое вытеснение оставляет надгробие, и без запаса таблица перестраивалась бы при каждом вытеснении
+template <typename Key>
+class SpaceSaving {
+public:
+    // Отслеживаемый ключ: оценка частоты сверху и на сколько она может быть завышена
+    struct Counter {
+        Key key;
+        size_t count;
+        size_t error;
+    };
+
+private:
+    size_t _capacity;
+    vector<Counter> heap;
+    Dictionary<Key, size_t> positions;
+    size_t _total;
+
+    void swapCounters(size_t a, size_t b) {
+        swap(heap[a], heap[b]);
+        *positions.find(heap[a].key) = a;
+        *positions.find(heap[b].key) = b;
+    }
+
+    void siftUp(size_t index) {
+        while (index > 0 && heap[(index - 1) / 2].count > heap[index].count) {
+            swapCounters(index, (index - 1) / 2);
+            index = (index - 1) / 2;
+        }
+    }
+
+    void siftDown(size_t index) {
+        while (true) {
+            size_t smallest = index;
+            size_t left = 2 * index + 1;
+            size_t right = left + 1;
+            if (left < heap.size() && heap[left].count < heap[smallest].count)
+                smallest = left;
+            if (right < heap.size() && heap[right].count < heap[smallest].count)
+                smallest = right;
+            if (smallest == index)
+                return;
+            swapCounters(index, smallest);
+            index = smallest;
+        }
+    }
+
+public:
+    SpaceSaving(size_t capacity, function<size_t(const KeyValuePair<Key, size_t>&)> hashFunction = [](const KeyValuePair<Key, size_t>& p) { return HashTable<Key>::defaultHash(p.key); })
+        : _capacity(max<size_t>(capacity, 1)), positions(static_cast<size_t>(2 * max<size_t>(capacity, 1) / 0.7) + 1, hashFunction), _total(0) {
+        heap.reserve(_capacity);
+    }
+
+    // Учёт count вхождений ключа
+        // Сложность: O(log capacity)
+    void add(const Key& key, size_t count = 1) {
+        _total += count;
+        size_t* position = positions.find(key);
+        if (position != nullptr) {
+            size_t index = *position;
+            heap[index].count += count;
+            siftDown(index);
+            return;
+        }
+        if (heap.size() < _capacity) {
+            heap.push_back(Counter{ key, count, 0 });
+            positions.insert(key, heap.size() - 1);
+            siftUp(heap.size() - 1);
+            return;
+        }
+        // Вытеснение ключа с минимальным счётчиком
+        Counter& minimum = heap[0];
+        positions.erase(minimum.key);
+        minimum.key = key;
+        minimum.error = minimum.count;
+        minimum.count += count;
+        positions.insert(key, 0);
+        siftDown(0);
+    }
+
+    // Оценка частоты ключа сверху; 0, если ключ не отслеживается
+    size_t estimate(const Key& key) const {
+        const size_t* position = positions.find(key);
+        return position == nullptr ? 0 : heap[*position].count;
+    }
+
+    // Возможное завышение оценки ключа
+    size_t error(const Key& key) const {
+        const size_t* position = positions.find(key);
+        return position == nullptr ? 0 : heap[*position].error;
+    }
+
+    // Отслеживаемые ключи по убыванию счётчиков
+    vector<Counter> counters() const {
+        vector<Counter> result = heap;
+        sort(result.begin(), result.end(), [](const Counter& a, const Counter& b) {
+            return a.count > b.count;
+            });
+        return result;
+    }
+
+    // Не более count самых частых ключей с оценками частоты, по убыванию
+    vector<KeyValuePair<Key, size_t>> top(size_t count) const {
+        vector<KeyValuePair<Key, size_t>> result;
+        for (const Counter& counter : counters()) {
+            if (result.size() == count) {
+                break;
+            }
+            result.push_back(KeyValuePair<Key, size_t>(counter.key, counter.count));
+        }
+        return result;
+    }
+
+    size_t size() const {
+        return heap.size();
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+    size_t total() const {
+        return _total;
+    }
+
+    // Объём памяти в байтах
+    size_t memory_usage() const {
+        return sizeof(*this) - sizeof(positions) + heap.capacity() * sizeof(Counter) + positions.memory_usage();
+    }
+
+    // Переход словаря позиций на хеш-функцию со случайным ключом (см. HashTable::useSeededHash)
+    void useSeededHash(KeyedAlgorithm algorithm = KeyedAlgorithm::SipHash) {
+        positions.useSeededHash(algorithm);
+    }
+
+    bool isSeeded() const {
+        return positions.isSeeded();
+    }
+
+    static void testSpaceSaving() {
+        SpaceSaving<int> topK(20);
+        // Частые ключи 0..4 вперемешку с потоком редких
+        for (int i = 0; i < 10000; i++) {
+            topK.add(i % 5);
+            topK.add(1000 + i);
+        }
+        assert(topK.size() == 20);
+        assert(topK.total() == 20000);
+        for (int i = 0; i < 5; i++) {
+            // Частота 2000 больше total / capacity, ключ отслеживается, оценка сверху
+            assert(topK.estimate(i) >= 2000);
+            assert(topK.estimate(i) - topK.error(i) <= 2000);
+        }
+        vector<KeyValuePair<int, size_t>> top = topK.top(5);
+        assert(top.size() == 5);
+        for (size_t i = 0; i < top.size(); i++) {
+            assert(top[i].key >= 0 && top[i].key < 5);
+            assert(i == 0 || top[i - 1].value >= top[i].value);
+        }
+        assert(topK.estimate(-1) == 0);
+
+        SpaceSaving<string> words(3);
+        words.add("a", 5);
+        words.add("b", 3);
+        words.add("c", 1);
+        words.add("d");
+        assert(words.estimate("c") == 0);
+        assert(words.estimate("d") == 2);
+        assert(words.error("d") == 1);
+        assert(words.top(1)[0].key == "a");
+        // Смена ключа хеширования сохраняет позиции отслеживаемых ключей
+        words.useSeededHash();
+        assert(words.isSeeded() && words.estimate("a") == 5 && words.estimate("d") == 2);
+        words.add("e");
+        assert(words.estimate("e") == 3 && words.estimate("d") == 0 && words.top(1)[0].key == "a");
+
+        cout << "All tests passed successfully!" << endl;
+    }
+};
+
+// HyperLogLog: оценка числа различных ключей по 2^precision однобайтовым регистрам.
+// Относительная погрешность около 1.04 / sqrt(2^precision): 0.8% при precision = 14 (16 КБ)
+template <typename Key>
+class HyperLogLog {
+private:
+    unsigned precision;
+    vector<uint8_t> registers;
+    function<size_t(const Key&)> hashFunction;
+
+public:
+    // precision ограничивается диапазоном [4, 18]
+    HyperLogLog(unsigned precision = 14, function<size_t(const Key&)> hashFunction = fnv1aHash<Key>)
+        : precision(min(max(precision, 4u), 18u)), registers(size_t(1) << this->precision, 0), hashFunction(hashFunction) {}
+
+    // Учёт ключа
+        // Сложность: O(1)
+    void add(const Key& key) {
+        uint64_t hash = mixHash(hashFunction(key));
+        size_t index = static_cast<size_t>(hash >> (64 - precision));
+        // Позиция первой единицы в оставшихся битах
+        uint8_t rank = static_cast<uint8_t>(min(leadingZeros64(hash << precision), 64u - precision) + 1);
+        if (registers[index] < rank) {
+            registers[index] = rank;
+        }
+    }
+
+    // Оценка числа различных ключей
+        // Сложность: O(2^precision)
+    double estimate() const {
+        double m = static_cast<double>(registers.size());
+        double alpha = registers.size() == 16 ? 0.673 : registers.size() == 32 ? 0.697 : registers.size() == 64 ? 0.709 : 0.7213 / (1.0 + 1.079 / m);
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t rank : registers) {
+            sum += ldexp(1.0, -static_cast<int>(rank));
+            if (rank == 0) {
+                zeros++;
+            }
+        }
+        double result = alpha * m * m / sum;
+        // Поправка для малых множеств: подсчёт пустых регистров (linear counting)
+        if (result <= 2.5 * m && zeros != 0) {
+            result = m * log(m / zeros);
+        }
+        return result;
+    }
+
+    // Объединение с оценкой той же точности (например, посчитанной по другой части данных).
+    // Бросает исключение invalid_argument, если точность различается
+    void merge(const HyperLogLog& other) {
+        if (precision != other.precision) {
+            throw invalid_argument("Precision differs");
+        }
+        for (size_t i = 0; i < registers.size(); ++i) {
+            registers[i] = max(registers[i], other.registers[i]);
+        }
+    }
+
+    unsigned getPrecision() const {
+        return precision;
+    }
+
+    // Объём памяти в байтах
+    size_t memory_usage() const {
+        return sizeof(*this) + registers.capacity();
+    }
+
+    static void testHyperLogLog() {
+        HyperLogLog<int> empty;
+        assert(empty.estimate() == 0.0);
+
+        HyperLogLog<int> small(12);
+        for (int i = 0; i < 100; i++) {
+            small.add(i);
+            small.add(i);
+        }
+        assert(fabs(small.estimate() - 100) < 5);
+
+        HyperLogLog<int> counter(14);
+        for (int i = 0; i < 200000; i++) {
+            counter.add(i % 100000);
+        }
+        assert(fabs(counter.estimate() - 100000) < 100000 * 0.04);
+
+        // Объединение частей даёт оценку объединения множеств
+        HyperLogLog<string> left(12);
+        HyperLogLog<string> right(12);
+        for (int i = 0; i < 5000; i++) {
+            left.add("w" + to_string(i));
+            right.add("w" + to_string(i + 2500));
+        }
+        left.merge(right);
+        assert(fabs(left.estimate() - 7500) < 7500 * 0.08);
+        assert(left.memory_usage() < 5000);
+
+        cout << "All tests passed successfully!" << endl;
+    }
+};
@@ -0,0 +1,397 @@
+#pragma once
+// Способы хранения ячеек хеш-таблицы (второй параметр шаблона HashTable).
+//
+// Каждый способ хранит ключи и состояние ячеек: свободна, занята или надгробие (ключ удалён).
+// Общий интерфейс:
+//   Slots(capacity)          -- capacity свободных ячеек
+//   capacity()               -- число ячеек
+//   isOccupied(i), isDeleted(i)
+//   get(i)                   -- ключ занятой ячейки
+//   take(i)                  -- ключ занятой ячейки для переноса в другую таблицу (перемещение или копия)
+//   put(i, key)              -- запись ключа в свободную ячейку или надгробие
+//   remove(i)                -- удаление ключа, ячейка становится надгробием
+//   memoryUsage()            -- байты, занятые ячейками и ключами (без динамической памяти самих ключей)
+//   emptySlotsReadable       -- можно ли читать get(i) у свободной ячейки
+//   concurrentPut            -- можно ли вызывать put() из разных потоков для ячеек, разнесённых на 64 и более
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Флаги занятости и надгробий ячеек
+class SlotFlags {
+protected:
+    // Вектор флагов, указывающих, занята ли ячейка
+    vector<bool> occupied;
+    // Вектор флагов-надгробий: ячейка была занята, но ключ удалён. Поиск через такие ячейки продолжается
+    vector<bool> deleted;
+
+    SlotFlags(size_t capacity) : occupied(capacity, false), deleted(capacity, false) {}
+
+    void markOccupied(size_t index) {
+        occupied[index] = true;
+        deleted[index] = false;
+    }
+
+    void markDeleted(size_t index) {
+        occupied[index] = false;
+        deleted[index] = true;
+    }
+
+    size_t flagBytes() const {
+        return 2 * ((occupied.size() + 7) / 8);
+    }
+
+public:
+    size_t capacity() const {
+        return occupied.size();
+    }
+
+    bool isOccupied(size_t index) const {
+        return occupied[index];
+    }
+
+    bool isDeleted(size_t index) const {
+        return deleted[index];
+    }
+};
+
+// Плотное хранение: вектор ключей, свободные ячейки содержат Key(). Способ по умолчанию
+template <typename Key>
+class DenseSlots : public SlotFlags {
+private:
+    vector<Key> keys;
+
+public:
+    static constexpr bool emptySlotsReadable = true;
+    static constexpr bool concurrentPut = true;
+
+    DenseSlots(size_t capacity = 0) : SlotFlags(capacity), keys(capacity) {}
+
+    const Key& get(size_t index) const {
+        return keys[index];
+    }
+
+    Key& get(size_t index) {
+        return keys[index];
+    }
+
+    Key&& take(size_t index) {
+        return std::move(keys[index]);
+    }
+
+    template <typename K>
+    void put(size_t index, K&& key) {
+        keys[index] = std::forward<K>(key);
+        markOccupied(index);
+    }
+
+    void remove(size_t index) {
+        keys[index] = Key();
+        markDeleted(index);
+    }
+
+    size_t memoryUsage() const {
+        return keys.capacity() * sizeof(Key) + flagBytes();
+    }
+};
+
+// Неинициализированное хранение: память под ключи выделяется без конструирования,
+// ключ конструируется при занятии ячейки и уничтожается при удалении.
+// Свободные ячейки не содержат объектов Key (пустых строк, User и т.п.), а страницы памяти
+// под ни разу не занятые ячейки операционная система может вообще не выделять физически
+template <typename Key>
+class RawSlots : public SlotFlags {
+private:
+    allocator<Key> alloc;
+    Key* keys;
+
+    void destroyAll() {
+        if (keys == nullptr) {
+            return;
+        }
+        for (size_t i = 0; i < capacity(); ++i) {
+            if (occupied[i]) {
+                keys[i].~Key();
+            }
+        }
+        alloc.deallocate(keys, capacity());
+        keys = nullptr;
+    }
+
+public:
+    static constexpr bool emptySlotsReadable = false;
+    static constexpr bool concurrentPut = true;
+
+    RawSlots(size_t capacity = 0) : SlotFlags(capacity), keys(capacity == 0 ? nullptr : alloc.allocate(capacity)) {}
+
+    RawSlots(const RawSlots& other) : SlotFlags(other), keys(other.capacity() == 0 ? nullptr : alloc.allocate(other.capacity())) {
+        for (size_t i = 0; i < capacity(); ++i) {
+            if (occupied[i]) {
+                new (&keys[i]) Key(other.keys[i]);
+            }
+        }
+    }
+
+    RawSlots(RawSlots&& other) noexcept : SlotFlags(std::move(other)), keys(other.keys) {
+        other.keys = nullptr;
+        other.occupied.clear();
+        other.deleted.clear();
+    }
+
+    RawSlots& operator=(RawSlots other) {
+        swap(static_cast<SlotFlags&>(*this), static_cast<SlotFlags&>(other));
+        swap(keys, other.keys);
+        return *this;
+    }
+
+    ~RawSlots() {
+        destroyAll();
+    }
+
+    const Key& get(size_t index) const {
+        return keys[index];
+    }
+
+    Key& get(size_t index) {
+        return keys[index];
+    }
+
+    Key&& take(size_t index) {
+        return std::move(keys[index]);
+    }
+
+    template <typename K>
+    void put(size_t index, K&& key) {
+        new (&keys[index]) Key(std::forward<K>(key));
+        markOccupied(index);
+    }
+
+    void remove(size_t index) {
+        keys[index].~Key();
+        markDeleted(index);
+    }
+
+    size_t memoryUsage() const {
+        return capacity() * sizeof(Key) + flagBytes();
+    }
+};
+
+// Косвенное хранение: ячейка таблицы -- 32-битный номер ключа в плотном массиве ключей.
+// Свободная ячейка стоит 4 байта вместо sizeof(Key), поэтому способ выгоден для разреженных таблиц с крупными ключами.
+// При удалении на место удалённого ключа переносится последний ключ массива
+template <typename Key>
+class IndirectSlots {
+private:
+    static constexpr uint32_t emptyMark = 0xFFFFFFFFu;
+    static constexpr uint32_t deletedMark = 0xFFFFFFFEu;
+
+    // Номер ключа в keys для каждой ячейки или метка свободной ячейки/надгробия
+    vector<uint32_t> positions;
+    // Ключи подряд, без пропусков
+    vector<Key> keys;
+    // Ячейка таблицы для каждого ключа из keys
+    vector<uint32_t> owners;
+
+public:
+    static constexpr bool emptySlotsReadable = false;
+    static constexpr bool concurrentPut = false;
+
+    IndirectSlots(size_t capacity = 0) : positions(capacity, emptyMark) {}
+
+    size_t capacity() const {
+        return positions.size();
+    }
+
+    bool isOccupied(size_t index) const {
+        return positions[index] < deletedMark;
+    }
+
+    bool isDeleted(size_t index) const {
+        return positions[index] == deletedMark;
+    }
+
+    const Key& get(size_t index) const {
+        return keys[positions[index]];
+    }
+
+    Key& get(size_t index) {
+        return keys[positions[index]];
+    }
+
+    Key&& take(size_t index) {
+        return std::move(keys[positions[index]]);
+    }
+
+    template <typename K>
+    void put(size_t index, K&& key) {
+        positions[index] = static_cast<uint32_t>(keys.size());
+        keys.push_back(std::forward<K>(key));
+        owners.push_back(static_cast<uint32_t>(index));
+    }
+
+    void remove(size_t index) {
+        uint32_t position = positions[index];
+        uint32_t last = static_cast<uint32_t>(keys.size() - 1);
+        if (position != last) {
+            keys[position] = std::move(keys[last]);
+            owners[position] = owners[last];
+            positions[owners[position]] = position;
+        }
+        keys.pop_back();
+        owners.pop_back();
+        positions[index] = deletedMark;
+    }
+
+    size_t memoryUsage() const {
+        return positions.capacity() * sizeof(uint32_t) + keys.capacity() * sizeof(Key) + owners.capacity() * sizeof(uint32_t);
+    }
+};
+
+// Копирование при записи: ячейки разбиты на блоки по ChunkSize, а блоки и их каталог разделяются между копиями
+// таблицы через shared_ptr. Копирование ячеек стоит O(1) -- копируется указатель на каталог. Первая запись после
+// копирования копирует каталог (O(capacity / ChunkSize)), а первая запись в каждый общий блок -- сам блок,
+// поэтому копия обходится в объём изменённых блоков. Общий блок никогда не изменяется: копию таблицы можно
+// читать из другого потока, пока владелец исходной таблицы её изменяет (копию нужно сделать в потоке владельца).
+// Новые ячейки ссылаются на один общий пустой блок и получают свой при первой записи
+template <typename Key, size_t ChunkSize = 256>
+class CowSlots {
+    static_assert(ChunkSize % 64 == 0, "CowSlots chunk size must be a multiple of 64");
+
+private:
+    static constexpr size_t words = ChunkSize / 64;
+
+    struct Chunk {
+        array<Key, ChunkSize> keys;
+        uint64_t occupied[words] = {};
+        uint64_t deleted[words] = {};
+    };
+
+    using Directory = vector<shared_ptr<Chunk>>;
+
+    shared_ptr<Directory> directory;
+    size_t slotCount;
+
+    const Chunk& chunkOf(size_t index) const {
+        return *(*directory)[index / ChunkSize];
+    }
+
+    static uint64_t bitOf(size_t index) {
+        return uint64_t(1) << (index % 64);
+    }
+
+    // Блок ячейки, принадлежащий только этим ячейкам: общий каталог и общий блок копируются
+    Chunk& writable(size_t index) {
+        if (directory.use_count() != 1) {
+            directory = make_shared<Directory>(*directory);
+        }
+        shared_ptr<Chunk>& chunk = (*directory)[index / ChunkSize];
+        if (chunk.use_count() != 1) {
+            chunk = make_shared<Chunk>(*chunk);
+        }
+        else {
+            // Последняя копия могла быть уничтожена в другом потоке: её чтения блока должны завершиться до записи
+            atomic_thread_fence(memory_order_acquire);
+        }
+        return *chunk;
+    }
+
+public:
+    static constexpr bool emptySlotsReadable = true;
+    static constexpr bool concurrentPut = false;
+
+    CowSlots(size_t capacity = 0) : directory(make_shared<Directory>()), slotCount(capacity) {
+        size_t chunks = (capacity + ChunkSize - 1) / ChunkSize;
+        if (chunks > 0) {
+            directory->assign(chunks, make_shared<Chunk>());
+        }
+    }
+
+    CowSlots(const CowSlots& other) = default;
+
+    CowSlots(CowSlots&& other) noexcept : directory(std::move(other.directory)), slotCount(other.slotCount) {
+        other.directory = make_shared<Directory>();
+        other.slotCount = 0;
+    }
+
+    CowSlots& operator=(const CowSlots& other) = default;
+
+    CowSlots& operator=(CowSlots&& other) noexcept {
+        swap(directory, other.directory);
+        swap(slotCount, other.slotCount);
+        return *this;
+    }
+
+    size_t capacity() const {
+        return slotCount;
+    }
+
+    bool isOccupied(size_t index) const {
+        return (chunkOf(index).occupied[index % ChunkSize / 64] & bitOf(index)) != 0;
+    }
+
+    bool isDeleted(size_t index) const {
+        return (chunkOf(index).deleted[index % ChunkSize / 64] & bitOf(index)) != 0;
+    }
+
+    const Key& get(size_t index) const {
+        return chunkOf(index).keys[index % ChunkSize];
+    }
+
+    // Ключ для изменения: блок ячейки становится собственным
+    Key& get(size_t index) {
+        return writable(index).keys[index % ChunkSize];
+    }
+
+    // Ключ общего блока копируется, собственного -- перемещается
+    Key take(size_t index) {
+        const shared_ptr<Chunk>& chunk = (*directory)[index / ChunkSize];
+        if (directory.use_count() == 1 && chunk.use_count() == 1) {
+            return std::move(chunk->keys[index % ChunkSize]);
+        }
+        return chunk->keys[index % ChunkSize];
+    }
+
+    template <typename K>
+    void put(size_t index, K&& key) {
+        Chunk& chunk = writable(index);
+        chunk.keys[index % ChunkSize] = std::forward<K>(key);
+        chunk.occupied[index % ChunkSize / 64] |= bitOf(index);
+        chunk.deleted[index % ChunkSize / 64] &= ~bitOf(index);
+    }
+
+    void remove(size_t index) {
+        Chunk& chunk = writable(index);
+        chunk.keys[index % ChunkSize] = Key();
+        chunk.occupied[index % ChunkSize / 64] &= ~bitOf(index);
+        chunk.deleted[index % ChunkSize / 64] |= bitOf(index);
+    }
+
+    // Каталог и блоки, включая общие с копиями. Блок, на который ссылаются несколько ячеек каталога
+    // (общий пустой блок, в том числе между уже записанными блоками), считается один раз
+    size_t memoryUsage() const {
+        vector<const Chunk*> chunks;
+        chunks.reserve(directory->size());
+        for (const auto& chunk : *directory) {
+            chunks.push_back(chunk.get());
+        }
+        sort(chunks.begin(), chunks.end());
+        size_t distinct = static_cast<size_t>(unique(chunks.begin(), chunks.end()) - chunks.begin());
+        return directory->capacity() * sizeof(shared_ptr<Chunk>) + distinct * sizeof(Chunk);
+    }
+
+    // Число блоков, которые придётся скопировать при записи: разделённых с копиями ячеек или ещё не записанных
+    size_t sharedChunks() const {
+        size_t count = 0;
+        for (const auto& chunk : *directory) {
+            count += directory.use_count() != 1 || chunk.use_count() != 1 ? 1 : 0;
+        }
+        return count;
+    }
+};
@@ -0,0 +1,248 @@
+#pragma once
+// Множество и словарь строк, известных при компиляции (списки стоп-слов, таблицы ключевых слов).
+// Таблица строится constexpr-конструктором: объявленная как static constexpr, она целиком
+// вычисляется компилятором, лежит в памяти только для чтения и не требует вставок при запуске.
+//
+//   static constexpr auto stopWords = makeStaticSet({ "a", "an", "the" });
+//   static constexpr auto keywords = makeStaticDictionary<int>({ { "if", 1 }, { "else", 2 } });
+//
+// Ключи -- string_view на строковые литералы (или другие строки, живущие дольше таблицы).
+// Повторяющийся ключ -- ошибка компиляции constexpr-таблицы (во время выполнения -- исключение invalid_argument)
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include "HashLegacy.h"
+
+using namespace std;
+
+// Ячеек в статической таблице на count ключей: степень двойки, загрузка не выше половины
+constexpr size_t staticTableCapacity(size_t count) {
+    size_t capacity = 2;
+    while (capacity < 2 * count) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// Индекс статической таблицы: ячейки с номерами ключей, линейное зондирование по FNV-1a.
+// Ключи хранит владелец индекса, индекс получает их через keyAt(i)
+template <size_t N>
+class StaticIndex {
+    static_assert(N < UINT32_MAX, "StaticIndex supports fewer than 2^32 keys");
+
+public:
+    static constexpr size_t slotCount = staticTableCapacity(N);
+
+private:
+    // Номер ключа плюс один, 0 -- свободная ячейка
+    array<uint32_t, slotCount> slots;
+
+public:
+    constexpr StaticIndex() : slots() {}
+
+    // Размещение ключей keyAt(0), ..., keyAt(N - 1). Бросает исключение invalid_argument при повторе ключа
+    template <typename KeyAt>
+    constexpr void build(KeyAt keyAt) {
+        for (size_t i = 0; i < N; ++i) {
+            string_view key = keyAt(i);
+            size_t index = fnv1aStringHash(key) & (slotCount - 1);
+            while (slots[index] != 0) {
+                if (keyAt(slots[index] - 1) == key) {
+                    throw invalid_argument("Duplicate key in static table");
+                }
+                index = (index + 1) & (slotCount - 1);
+            }
+            slots[index] = static_cast<uint32_t>(i + 1);
+        }
+    }
+
+    // Номер ключа или N, если ключа нет
+    template <typename KeyAt>
+    constexpr size_t find(string_view key, KeyAt keyAt) const {
+        size_t index = fnv1aStringHash(key) & (slotCount - 1);
+        while (slots[index] != 0) {
+            if (keyAt(slots[index] - 1) == key) {
+                return slots[index] - 1;
+            }
+            index = (index + 1) & (slotCount - 1);
+        }
+        return N;
+    }
+};
+
+// Множество строк, построенное при компиляции. Обход -- в порядке перечисления ключей
+template <size_t N>
+class StaticSet {
+private:
+    array<string_view, N> keys;
+    StaticIndex<N> index;
+
+public:
+    constexpr StaticSet(const string_view (&list)[N]) : keys(), index() {
+        for (size_t i = 0; i < N; ++i) {
+            keys[i] = list[i];
+        }
+        index.build([this](size_t i) { return keys[i]; });
+    }
+
+    // Проверка наличия ключа в множестве
+        // Сложность: O(1) в среднем случае
+    constexpr bool contains(string_view key) const {
+        return index.find(key, [this](size_t i) { return keys[i]; }) < N;
+    }
+
+    constexpr size_t size() const {
+        return N;
+    }
+
+    // Число ячеек индекса
+    constexpr size_t capacity() const {
+        return StaticIndex<N>::slotCount;
+    }
+
+    constexpr const string_view* begin() const {
+        return keys.data();
+    }
+
+    constexpr const string_view* end() const {
+        return keys.data() + N;
+    }
+
+    static void testAllMethods();
+};
+
+// Пара ключ-значение статического словаря. В отличие от KeyValuePair и std::pair (C++17),
+// копируется в constexpr-конструкторе
+template <typename Value>
+struct StaticEntry {
+    string_view key;
+    Value value{};
+};
+
+// Словарь строка -> значение, построенный при компиляции. Value -- литеральный тип (целое, перечисление, string_view).
+// Обход -- пары в порядке перечисления
+template <typename Value, size_t N>
+class StaticDictionary {
+private:
+    array<StaticEntry<Value>, N> items;
+    StaticIndex<N> index;
+
+    constexpr size_t locate(string_view key) const {
+        return index.find(key, [this](size_t i) { return items[i].key; });
+    }
+
+public:
+    constexpr StaticDictionary(const StaticEntry<Value> (&list)[N]) : items(), index() {
+        for (size_t i = 0; i < N; ++i) {
+            items[i] = list[i];
+        }
+        index.build([this](size_t i) { return items[i].key; });
+    }
+
+    // Указатель на значение по ключу или nullptr, если ключа нет
+        // Сложность: O(1) в среднем случае
+    constexpr const Value* find(string_view key) const {
+        size_t i = locate(key);
+        return i < N ? &items[i].value : nullptr;
+    }
+
+    // Значение по ключу. Бросает исключение out_of_range, если ключа нет
+    constexpr const Value& at(string_view key) const {
+        size_t i = locate(key);
+        if (i == N) {
+            throw out_of_range("Key not found");
+        }
+        return items[i].value;
+    }
+
+    // Проверка наличия ключа в словаре
+    constexpr bool contains(string_view key) const {
+        return locate(key) < N;
+    }
+
+    constexpr size_t size() const {
+        return N;
+    }
+
+    // Число ячеек индекса
+    constexpr size_t capacity() const {
+        return StaticIndex<N>::slotCount;
+    }
+
+    constexpr const StaticEntry<Value>* begin() const {
+        return items.data();
+    }
+
+    constexpr const StaticEntry<Value>* end() const {
+        return items.data() + N;
+    }
+};
+
+// Построение статического множества из списка ключей: makeStaticSet({ "a", "b" })
+template <size_t N>
+constexpr StaticSet<N> makeStaticSet(const string_view (&list)[N]) {
+    return StaticSet<N>(list);
+}
+
+// Построение статического словаря из списка пар: makeStaticDictionary<int>({ { "a", 1 }, { "b", 2 } })
+template <typename Value, size_t N>
+constexpr StaticDictionary<Value, N> makeStaticDictionary(const StaticEntry<Value> (&list)[N]) {
+    return StaticDictionary<Value, N>(list);
+}
+
+template <size_t N>
+void StaticSet<N>::testAllMethods() {
+    // Хеши вычисляются при компиляции и совпадают с известными значениями
+    static_assert(fnv1aStringHash("") == static_cast<size_t>(14695981039346656037ull), "FNV-1a offset basis");
+    static_assert(fnv1aStringHash("a") == static_cast<size_t>(0xaf63dc4c8601ec8cull), "FNV-1a of \"a\"");
+    static_assert(djb2StringHash("") == 5381 && djb2StringHash("a") == 5381 * 33 + 'a', "djb2");
+
+    // Таблицы построены компилятором: поиск тоже работает в константных выражениях
+    static constexpr auto stopWords = makeStaticSet({ "a", "an", "and", "in", "of", "the", "to", "is", "it", "that" });
+    static_assert(stopWords.size() == 10 && stopWords.capacity() == 32, "static set layout");
+    static_assert(stopWords.contains("the") && stopWords.contains("a") && !stopWords.contains("then"), "static set lookup");
+    static constexpr auto keywords = makeStaticDictionary<int>({ { "if", 1 }, { "else", 2 }, { "while", 3 }, { "", 4 } });
+    static_assert(keywords.at("while") == 3 && keywords.find("for") == nullptr && *keywords.find("") == 4, "static dictionary lookup");
+
+    // Те же таблицы во время выполнения, с ключами из std::string
+    for (const string_view& word : stopWords) {
+        assert(stopWords.contains(string(word)));
+    }
+    assert(!stopWords.contains(string("thee")));
+    size_t count = 0;
+    for (const auto& item : keywords) {
+        assert(keywords.at(item.key) == item.value);
+        count++;
+    }
+    assert(count == 4);
+    bool caught = false;
+    try {
+        keywords.at(string("for"));
+    }
+    catch (const out_of_range&) {
+        caught = true;
+    }
+    assert(caught);
+
+    // Повтор ключа во время выполнения -- исключение (при компиляции -- ошибка)
+    caught = false;
+    try {
+        makeStaticSet({ "x", "y", "x" });
+    }
+    catch (const invalid_argument&) {
+        caught = true;
+    }
+    assert(caught);
+
+    // Ключи, совпадающие по младшим битам хеша, находятся зондированием
+    static constexpr auto many = makeStaticSet({ "k0", "k1", "k2", "k3", "k4", "k5", "k6", "k7", "k8", "k9",
+                                                 "k10", "k11", "k12", "k13", "k14", "k15", "k16", "k17", "k18", "k19" });
+    for (int i = 0; i < 30; i++) {
+        assert(many.contains("k" + to_string(i)) == (i < 20));
+    }
+
+    cout << "All tests passed successfully!" << endl;
+}
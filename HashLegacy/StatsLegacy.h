@@ -0,0 +1,250 @@
+#pragma once
+// Счётчики горячих путей хеш-таблицы и трассировка операций.
+// Включаются макросом HASHLEGACY_STATS (в CMake -- опция HASHLEGACY_STATS). Без него счётчики
+// и вызовы трассировки не компилируются, и горячие пути таблицы остаются прежними.
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+using namespace std;
+
+#ifdef HASHLEGACY_STATS
+#define HASHLEGACY_STATS_ONLY(...) __VA_ARGS__
+#else
+#define HASHLEGACY_STATS_ONLY(...)
+#endif
+
+// Операция над таблицей, о которой сообщает трассировка
+enum class TraceOperation {
+    Insert,
+    Find,
+    Contains,
+    Erase,
+    Rehash
+};
+
+// Событие трассировки
+struct TraceEvent {
+    TraceOperation operation;
+    // Хеш ключа (для Rehash -- 0)
+    size_t hash;
+    // Шагов зондирования и сравнений ключей в операции
+    size_t probes;
+    size_t comparisons;
+    // Найден ли ключ (для Insert -- был ли ключ вставлен)
+    bool found;
+    // Ёмкость таблицы после операции
+    size_t capacity;
+    // Длительность операции в наносекундах (измеряется только для Rehash)
+    long long nanoseconds;
+};
+
+// Обработчик событий трассировки. Вызывается в потоке, выполняющем операцию, сразу после неё. Поиски -- const-методы,
+// и таблицу могут читать несколько потоков одновременно (Set::parallel_intersect, ConcurrentCounter): тогда
+// обработчик вызывается из них параллельно и сам отвечает за синхронизацию. Изменяющие операции, как и сама
+// таблица, требуют внешней синхронизации, и их события не пересекаются с событиями других операций
+using TraceHook = function<void(const TraceEvent&)>;
+
+// Статистика фильтра перед таблицей (см. FilterLegacy.h)
+struct FilterStats {
+    // Поисков через фильтр и сколько из них фильтр отсёк, не обращаясь к таблице
+    size_t lookups = 0;
+    size_t rejects = 0;
+    // Фильтр пропустил к таблице ключ, которого в ней нет
+    size_t falsePositives = 0;
+
+    // Доля ложных срабатываний среди поисков отсутствующих ключей
+    double falsePositiveRate() const {
+        size_t negatives = rejects + falsePositives;
+        return negatives == 0 ? 0.0 : (double)falsePositives / negatives;
+    }
+};
+
+// Накопленная статистика кэша (HashCache): попадания, промахи, вставки и вытеснения
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t insertions = 0;
+    size_t evictions = 0;
+
+    // Доля попаданий среди поисков
+    double hitRate() const {
+        size_t lookups = hits + misses;
+        return lookups == 0 ? 0.0 : (double)hits / lookups;
+    }
+
+    CacheStats& operator+=(const CacheStats& other) {
+        hits += other.hits;
+        misses += other.misses;
+        insertions += other.insertions;
+        evictions += other.evictions;
+        return *this;
+    }
+};
+
+// Накопленная статистика таблицы
+struct HashTableStats {
+    // Число операций
+    size_t inserts = 0;
+    size_t lookups = 0;
+    size_t erases = 0;
+    // Суммарное число шагов зондирования и сравнений ключей
+    size_t probes = 0;
+    size_t comparisons = 0;
+    // Самая длинная цепочка зондирования
+    size_t maxProbeLength = 0;
+    // Число перехеширований и их суммарная длительность
+    size_t rehashes = 0;
+    long long rehashNanoseconds = 0;
+    // Смены ключа хеширования (HashTable::useSeededHash и длинные цепочки зондирования)
+    size_t reseeds = 0;
+    // Пиковый объём памяти под ячейки таблицы (во время перехеширования живут старая и новая таблицы)
+    size_t peakBytes = 0;
+    // Фильтр перед таблицей множества или словаря (без фильтра -- нули)
+    FilterStats filter;
+
+    // Средняя длина цепочки зондирования на операцию
+    double averageProbeLength() const {
+        size_t operations = inserts + lookups + erases;
+        return operations == 0 ? 0.0 : (double)probes / operations;
+    }
+
+    // Сложение статистики нескольких таблиц (например, частей ConcurrentCounter): самая длинная цепочка -- общая
+    HashTableStats& operator+=(const HashTableStats& other) {
+        inserts += other.inserts;
+        lookups += other.lookups;
+        erases += other.erases;
+        probes += other.probes;
+        comparisons += other.comparisons;
+        maxProbeLength = maxProbeLength > other.maxProbeLength ? maxProbeLength : other.maxProbeLength;
+        rehashes += other.rehashes;
+        rehashNanoseconds += other.rehashNanoseconds;
+        reseeds += other.reseeds;
+        peakBytes += other.peakBytes;
+        filter.lookups += other.filter.lookups;
+        filter.rejects += other.filter.rejects;
+        filter.falsePositives += other.filter.falsePositives;
+        return *this;
+    }
+};
+
+// Счётчик шагов одного прохода зондирования. Без HASHLEGACY_STATS пуст, и вызовы его методов исчезают при компиляции
+struct ProbeCounter {
+#ifdef HASHLEGACY_STATS
+    size_t probes = 0;
+    size_t comparisons = 0;
+
+    void step() {
+        ++probes;
+    }
+
+    void compare() {
+        ++comparisons;
+    }
+#else
+    void step() {}
+    void compare() {}
+#endif
+};
+
+// Счётчик статистики, который увеличивают одновременно несколько потоков: поиски -- const-методы и могут
+// выполняться параллельно. Операции атомарные с упорядочением relaxed: итоговые суммы точны, но снимок,
+// снятый во время чужих операций, может быть несогласован между разными счётчиками. Копируется по значению
+template <typename T>
+class StatCounter {
+private:
+    atomic<T> value;
+
+public:
+    StatCounter(T initial = 0) : value(initial) {}
+
+    StatCounter(const StatCounter& other) : value(other.load()) {}
+
+    StatCounter& operator=(const StatCounter& other) {
+        value.store(other.load(), memory_order_relaxed);
+        return *this;
+    }
+
+    void operator++(int) {
+        value.fetch_add(1, memory_order_relaxed);
+    }
+
+    void operator+=(T amount) {
+        value.fetch_add(amount, memory_order_relaxed);
+    }
+
+    // Увеличение до candidate, если он больше текущего значения
+    void raise(T candidate) {
+        T current = load();
+        while (current < candidate && !value.compare_exchange_weak(current, candidate, memory_order_relaxed)) {
+        }
+    }
+
+    T load() const {
+        return value.load(memory_order_relaxed);
+    }
+
+    operator T() const {
+        return load();
+    }
+};
+
+// Накопители статистики таблицы на атомарных счётчиках (см. StatCounter); getStats таблицы возвращает их снимок
+struct HashTableCounters {
+    StatCounter<size_t> inserts;
+    StatCounter<size_t> lookups;
+    StatCounter<size_t> erases;
+    StatCounter<size_t> probes;
+    StatCounter<size_t> comparisons;
+    StatCounter<size_t> maxProbeLength;
+    StatCounter<size_t> rehashes;
+    StatCounter<long long> rehashNanoseconds;
+    StatCounter<size_t> reseeds;
+    StatCounter<size_t> peakBytes;
+
+#ifdef HASHLEGACY_STATS
+    // Учёт операции с шагами зондирования counter
+    void record(TraceOperation operation, const ProbeCounter& counter) {
+        if (operation == TraceOperation::Insert)
+            inserts++;
+        else if (operation == TraceOperation::Erase)
+            erases++;
+        else
+            lookups++;
+        probes += counter.probes;
+        comparisons += counter.comparisons;
+        maxProbeLength.raise(counter.probes);
+    }
+#endif
+
+    HashTableStats snapshot() const {
+        HashTableStats result;
+        result.inserts = inserts;
+        result.lookups = lookups;
+        result.erases = erases;
+        result.probes = probes;
+        result.comparisons = comparisons;
+        result.maxProbeLength = maxProbeLength;
+        result.rehashes = rehashes;
+        result.rehashNanoseconds = rehashNanoseconds;
+        result.reseeds = reseeds;
+        result.peakBytes = peakBytes;
+        return result;
+    }
+};
+
+// Накопители статистики фильтра перед таблицей (см. FilterStats)
+struct FilterCounters {
+    StatCounter<size_t> lookups;
+    StatCounter<size_t> rejects;
+    StatCounter<size_t> falsePositives;
+
+    FilterStats snapshot() const {
+        FilterStats result;
+        result.lookups = lookups;
+        result.rejects = rejects;
+        result.falsePositives = falsePositives;
+        return result;
+    }
+};
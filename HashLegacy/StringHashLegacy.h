@@ -0,0 +1,628 @@
+#pragma once
+// Хеш-таблица строковых ключей с ключом прямо в ячейке. В HashTable<string> каждое сравнение при зондировании
+// читает объект std::string и, для длинных строк, текст по его указателю. Здесь ячейка -- 32 байта (две на строку кэша):
+//   длина и 32 бита хеша ключа -- одно 64-битное слово;
+//   короткий ключ (до 24 байт) -- целиком, дополненный нулями;
+//   длинный ключ -- первые 16 байт и указатель на полный текст в арене StringArena.
+// Несовпадающий ключ почти всегда отсеивается сравнением первого слова, а короткий ключ сравнивается
+// четырьмя сравнениями слов без обращения к другой памяти.
+//
+// Ёмкость -- степень двойки, хеш -- wyhash (KeyedHashLegacy.h): номер начальной ячейки -- старшие биты хеша,
+// в ячейке хранятся младшие. Зондирование линейное, удаление сдвигает следующие ключи цепочки назад (без надгробий).
+// Текст удалённых длинных ключей остаётся в арене до перестройки таблицы, при которой арена сжимается,
+// если больше половины её текста принадлежит удалённым ключам
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "ArenaLegacy.h"
+#include "KeyedHashLegacy.h"
+#include "StatsLegacy.h"
+
+using namespace std;
+
+class StringHashTable {
+public:
+    // Наибольшая длина ключа, хранимого в ячейке целиком
+    static constexpr size_t inlineLength = 24;
+
+private:
+    // Длина ключа, хранимого в арене: первые prefixLength байт -- ещё и в ячейке
+    static constexpr size_t prefixLength = 16;
+    // Слово заголовка свободной ячейки; у занятой младшие 32 бита (длина) меньше 0xFFFFFFFF
+    static constexpr uint64_t emptyHead = ~uint64_t(0);
+    // Наименьшая ёмкость
+    static constexpr size_t minCapacity = 8;
+    // Постоянный ключ wyhash, пока не вызван useSeededHash
+    static constexpr uint64_t defaultSeed = 0x5D588B656C078965ull;
+
+    // Ячейка таблицы. Выравнивание по 32 байтам (vector выделяет память с ним через выравнивающий new C++17)
+    // не даёт ячейке пересечь границу строки кэша
+    struct alignas(32) Slot {
+        // Длина ключа (младшие 32 бита) и младшие 32 бита хеша
+        uint64_t head;
+        // Короткий ключ с нулями после конца или первые 16 байт длинного ключа и указатель на его текст
+        uint64_t words[3];
+    };
+    static_assert(sizeof(Slot) == 32, "Two slots per cache line");
+
+    // Ключ, подготовленный к сравнению с ячейками: заголовок и слова в том же виде, что в ячейке
+    struct Probe {
+        string_view text;
+        uint64_t hash;
+        uint64_t head;
+        uint64_t words[3];
+    };
+
+    // Ячейки таблицы
+    vector<Slot> slots;
+    // Текст длинных ключей
+    StringArena arena;
+    // Байт текста удалённых длинных ключей в арене
+    size_t garbageBytes;
+    // Ёмкость минус один и сдвиг, оставляющий от хеша номер ячейки
+    size_t mask;
+    int shift;
+    // Количество ключей в таблице
+    size_t _size;
+    // Ключ хеширования
+    uint64_t seed;
+    // Максимальный коэффициент загрузки
+    double maxLoadFactor;
+    // Минимальный коэффициент загрузки
+    double minLoadFactor;
+#ifdef HASHLEGACY_STATS
+    // Статистика операций и обработчик трассировки
+    mutable HashTableCounters stats;
+    TraceHook traceHook;
+#endif
+
+public:
+    // Конструктор таблицы. Ёмкость округляется вверх до степени двойки, но не меньше 8
+    StringHashTable(size_t capacity = minCapacity, double maxLoadFactor = 0.7, double minLoadFactor = 0.2)
+        : garbageBytes(0), mask(0), shift(0), _size(0), seed(defaultSeed), maxLoadFactor(maxLoadFactor), minLoadFactor(minLoadFactor) {
+        allocate(roundCapacity(capacity));
+        HASHLEGACY_STATS_ONLY(stats.peakBytes = memory_usage();)
+    }
+
+    // Копия получает свою арену: длинные ключи копируются в неё, а указатели ячеек переставляются
+    StringHashTable(const StringHashTable& other)
+        : slots(other.slots), garbageBytes(0), mask(other.mask), shift(other.shift), _size(other._size), seed(other.seed),
+          maxLoadFactor(other.maxLoadFactor), minLoadFactor(other.minLoadFactor) {
+        for (Slot& slot : slots) {
+            if (slot.head != emptyHead && static_cast<uint32_t>(slot.head) > inlineLength) {
+                slot.words[2] = pointerWord(arena.store(slotKey(slot)).data());
+            }
+        }
+        HASHLEGACY_STATS_ONLY(stats.peakBytes = memory_usage();)
+    }
+
+    StringHashTable& operator=(const StringHashTable& other) {
+        if (this != &other) {
+            StringHashTable copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    // Перемещение сохраняет блоки арены, поэтому указатели ячеек остаются верными
+    StringHashTable(StringHashTable&&) = default;
+    StringHashTable& operator=(StringHashTable&&) = default;
+
+    // Поиск ключа с вставкой, если его нет. Возвращает индекс ячейки с ключом, inserted -- был ли ключ вставлен.
+    // Бросает исключение length_error для ключа длиной 2^32 - 1 байт и больше
+        // Сложность: O(1) в среднем случае (плюс длина ключа)
+    size_t findOrInsert(string_view key, bool& inserted) {
+        Probe probe = prepare(key);
+        ProbeCounter counter;
+        size_t freeIndex = capacity();
+        size_t index = find(probe, counter, freeIndex);
+        if (index < capacity()) {
+            record(TraceOperation::Insert, homeOf(probe.hash), counter, false);
+            inserted = false;
+            return index;
+        }
+        if (capacityFor(_size + 1) > capacity()) {
+            rebuild(capacity() * 2);
+            freeIndex = freeSlot(homeOf(probe.hash), counter);
+        }
+        Slot& slot = slots[freeIndex];
+        slot.head = probe.head;
+        slot.words[0] = probe.words[0];
+        slot.words[1] = probe.words[1];
+        slot.words[2] = key.size() <= inlineLength ? probe.words[2] : pointerWord(arena.store(key).data());
+        _size++;
+        record(TraceOperation::Insert, homeOf(probe.hash), counter, true);
+        inserted = true;
+        return freeIndex;
+    }
+
+    // Вставка ключа, если его ещё нет в таблице. Возвращает true, если ключ был вставлен
+        // Сложность: O(1) в среднем случае
+    bool insertUnique(string_view key) {
+        bool inserted = false;
+        findOrInsert(key, inserted);
+        return inserted;
+    }
+
+    // Поиск индекса ячейки с ключом. Возвращает capacity(), если ключ не найден
+        // Сложность: O(1) в среднем случае
+    size_t indexOf(string_view key) const {
+        Probe probe = prepare(key);
+        ProbeCounter counter;
+        size_t freeIndex = capacity();
+        size_t index = find(probe, counter, freeIndex);
+        record(TraceOperation::Find, homeOf(probe.hash), counter, index < capacity());
+        return index;
+    }
+
+    // Проверка наличия ключа в таблице
+        // Сложность: O(1) в среднем случае
+    bool contains(string_view key) const {
+        Probe probe = prepare(key);
+        ProbeCounter counter;
+        size_t freeIndex = capacity();
+        bool found = find(probe, counter, freeIndex) < capacity();
+        record(TraceOperation::Contains, homeOf(probe.hash), counter, found);
+        return found;
+    }
+
+    // Удаление ключа из таблицы. Следующие ключи цепочки сдвигаются назад на освободившееся место,
+    // если их начальная ячейка не лежит между освободившейся ячейкой и ими самими
+        // Сложность: O(1) в среднем случае, перехеширование при загрузке ниже минимальной -- O(n)
+    void erase(string_view key) {
+        Probe probe = prepare(key);
+        ProbeCounter counter;
+        size_t freeIndex = capacity();
+        size_t index = find(probe, counter, freeIndex);
+        record(TraceOperation::Erase, homeOf(probe.hash), counter, index < capacity());
+        if (index == capacity()) {
+            return;
+        }
+        if (key.size() > inlineLength) {
+            garbageBytes += key.size();
+        }
+
+        size_t hole = index;
+        for (size_t next = (hole + 1) & mask; slots[next].head != emptyHead; next = (next + 1) & mask) {
+            size_t nextHome = homeOf(hashOf(slotKey(slots[next])));
+            if (((next - nextHome) & mask) >= ((next - hole) & mask)) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole].head = emptyHead;
+        _size--;
+
+        if ((double)_size / capacity() < minLoadFactor && capacity() > minCapacity) {
+            rehash();
+        }
+    }
+
+    // Ключ ячейки по индексу. Короткий ключ читается прямо из ячейки, поэтому string_view действителен
+    // до следующего изменения таблицы. Бросает исключение out_of_range, если индекс указан неверно или ячейка свободна
+    string_view getListAtIndex(size_t index) const {
+        if (!isOccupied(index)) {
+            throw out_of_range("Slot is empty");
+        }
+        return slotKey(slots[index]);
+    }
+
+    //Получить занятость ячейки по индексу. Бросает исключение out_of_range, если индекс указан неверно
+    bool isOccupied(size_t index) const {
+        if (index >= capacity()) {
+            throw out_of_range("Index out of range");
+        }
+        return slots[index].head != emptyHead;
+    }
+
+    // Перехеширование: увеличение вдвое при превышении максимального коэффициента загрузки, иначе уменьшение вдвое
+    void rehash() {
+        if ((double)_size / capacity() > maxLoadFactor) {
+            rebuild(capacity() * 2);
+        }
+        else {
+            rebuild(capacity() / 2);
+        }
+    }
+
+    // Резервирование места под count ключей без перехеширований
+    void reserve(size_t count) {
+        if (capacityFor(count) > capacity()) {
+            rebuild(capacityFor(count));
+        }
+    }
+
+    // Сжатие таблицы под текущее число ключей, если коэффициент загрузки опустился ниже минимального
+    void shrinkToFit() {
+        if ((double)_size / capacity() < minLoadFactor) {
+            rebuild(capacityFor(_size));
+        }
+    }
+
+    // Хеширование со случайным ключом wyhash: подобрать заранее ключи, попадающие в одну цепочку, нельзя
+    void useSeededHash() {
+        seed = HashSeed::random().k0;
+        rebuild(capacity());
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    size_t capacity() const {
+        return slots.size();
+    }
+
+    // Объём памяти таблицы в байтах: сам объект, ячейки и арена длинных ключей
+    size_t memory_usage() const {
+        return sizeof(*this) + slots.capacity() * sizeof(Slot) + arena.memory_usage();
+    }
+
+    //Максимальный коэффициент загрузки
+    double getMaxLoadFactor() const {
+        return maxLoadFactor;
+    }
+
+    //Минимальный коэффициент загрузки
+    double getMinLoadFactor() const {
+        return minLoadFactor;
+    }
+
+    // Накопленная статистика операций. Сравнение -- сравнение ключа с ячейкой, шаг -- переход к следующей ячейке.
+    // Без HASHLEGACY_STATS все счётчики нулевые
+    HashTableStats getStats() const {
+#ifdef HASHLEGACY_STATS
+        return stats.snapshot();
+#else
+        return HashTableStats();
+#endif
+    }
+
+    // Сброс статистики
+    void resetStats() {
+        HASHLEGACY_STATS_ONLY(stats = HashTableCounters(); stats.peakBytes = memory_usage();)
+    }
+
+    // Установка обработчика трассировки, вызываемого после каждой операции. Без HASHLEGACY_STATS не вызывается
+    void setTraceHook(TraceHook hook) {
+#ifdef HASHLEGACY_STATS
+        traceHook = hook;
+#else
+        (void)hook;
+#endif
+    }
+
+    // Итератор по занятым ячейкам таблицы; разыменование даёт string_view ключа (см. getListAtIndex)
+    class iterator {
+    private:
+        const StringHashTable* owner;
+        size_t index;
+
+        void skipFree() {
+            while (index < owner->capacity() && owner->slots[index].head == emptyHead) {
+                ++index;
+            }
+        }
+
+    public:
+        iterator(const StringHashTable* owner, size_t index) : owner(owner), index(index) {
+            skipFree();
+        }
+
+        iterator& operator++() {
+            ++index;
+            skipFree();
+            return *this;
+        }
+
+        string_view operator*() const {
+            return owner->slotKey(owner->slots[index]);
+        }
+
+        bool operator==(const iterator& other) const {
+            return index == other.index;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return index != other.index;
+        }
+    };
+
+    //Итератор на начало таблицы
+    iterator begin() const {
+        return iterator(this, 0);
+    }
+    //Итератор на конец таблицы
+    iterator end() const {
+        return iterator(this, capacity());
+    }
+
+    // Метод очистки таблицы; арена длинных ключей освобождается
+    void clear() {
+        for (Slot& slot : slots) {
+            slot.head = emptyHead;
+        }
+        arena.clear();
+        garbageBytes = 0;
+        _size = 0;
+    }
+
+private:
+    static uint64_t pointerWord(const char* text) {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(text));
+    }
+
+    static const char* wordPointer(uint64_t word) {
+        return reinterpret_cast<const char*>(static_cast<uintptr_t>(word));
+    }
+
+    // Ключ ячейки: короткий -- из самой ячейки, длинный -- из арены
+    static string_view slotKey(const Slot& slot) {
+        size_t length = static_cast<uint32_t>(slot.head);
+        if (length <= inlineLength) {
+            return string_view(reinterpret_cast<const char*>(slot.words), length);
+        }
+        return string_view(wordPointer(slot.words[2]), length);
+    }
+
+    uint64_t hashOf(string_view key) const {
+        return wyHash(key.data(), key.size(), seed);
+    }
+
+    Probe prepare(string_view key) const {
+        if (key.size() >= UINT32_MAX) {
+            throw length_error("StringHashTable keys must be shorter than 2^32 - 1 bytes");
+        }
+        Probe probe;
+        probe.text = key;
+        probe.hash = hashOf(key);
+        probe.head = key.size() | (probe.hash << 32);
+        probe.words[0] = probe.words[1] = probe.words[2] = 0;
+        if (!key.empty()) {
+            memcpy(probe.words, key.data(), key.size() <= inlineLength ? key.size() : prefixLength);
+        }
+        return probe;
+    }
+
+    // Совпадает ли ключ ячейки с подготовленным ключом
+    static bool matches(const Slot& slot, const Probe& probe) {
+        if (slot.head != probe.head || slot.words[0] != probe.words[0] || slot.words[1] != probe.words[1]) {
+            return false;
+        }
+        if (probe.text.size() <= inlineLength) {
+            return slot.words[2] == probe.words[2];
+        }
+        return memcmp(wordPointer(slot.words[2]) + prefixLength, probe.text.data() + prefixLength, probe.text.size() - prefixLength) == 0;
+    }
+
+    // Наименьшая степень двойки не меньше capacity и минимальной ёмкости
+    static size_t roundCapacity(size_t capacity) {
+        size_t rounded = minCapacity;
+        while (rounded < capacity) {
+            rounded *= 2;
+        }
+        return rounded;
+    }
+
+    // Ёмкость, в которую count ключей помещаются без превышения максимальной загрузки
+    // и с хотя бы одной свободной ячейкой, на которой останавливается зондирование
+    size_t capacityFor(size_t count) const {
+        size_t result = minCapacity;
+        while (count >= result || (double)count / result > maxLoadFactor) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    void allocate(size_t capacity) {
+        slots.assign(capacity, Slot{ emptyHead, { 0, 0, 0 } });
+        mask = capacity - 1;
+        shift = 64;
+        for (size_t bits = capacity; bits > 1; bits >>= 1) {
+            shift--;
+        }
+    }
+
+    // Начальная ячейка по хешу ключа
+    size_t homeOf(uint64_t hash) const {
+        // При ёмкости 1 << 64 сдвиг на 64 не определён, но такая ёмкость недостижима
+        return static_cast<size_t>(hash >> shift) & mask;
+    }
+
+    // Зондирование от начальной ячейки. Возвращает индекс ячейки с ключом или capacity();
+    // в freeIndex -- свободная ячейка, на которой остановился поиск
+    size_t find(const Probe& probe, ProbeCounter& counter, size_t& freeIndex) const {
+        size_t index = homeOf(probe.hash);
+        while (true) {
+            const Slot& slot = slots[index];
+            if (slot.head == emptyHead) {
+                freeIndex = index;
+                return capacity();
+            }
+            counter.compare();
+            if (matches(slot, probe)) {
+                return index;
+            }
+            counter.step();
+            index = (index + 1) & mask;
+        }
+    }
+
+    // Первая свободная ячейка цепочки от home. Таблица никогда не заполнена полностью (см. capacityFor)
+    size_t freeSlot(size_t home, ProbeCounter& counter) const {
+        size_t index = home;
+        while (slots[index].head != emptyHead) {
+            counter.step();
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    // Перестройка таблицы под новую ёмкость (не меньше нужной для текущих ключей).
+    // Если больше половины текста арены принадлежит удалённым ключам, длинные ключи переносятся в новую арену
+    void rebuild(size_t newCapacity) {
+        HASHLEGACY_STATS_ONLY(auto started = chrono::steady_clock::now(); size_t oldBytes = memory_usage();)
+        vector<Slot> oldSlots = std::move(slots);
+        bool compact = garbageBytes > 0 && 2 * garbageBytes > arena.used();
+        StringArena oldArena = std::move(arena);
+        arena = StringArena();
+        allocate(max(roundCapacity(newCapacity), capacityFor(_size)));
+        for (Slot slot : oldSlots) {
+            if (slot.head == emptyHead) {
+                continue;
+            }
+            string_view key = slotKey(slot);
+            uint64_t hash = hashOf(key);
+            slot.head = key.size() | (hash << 32);
+            if (key.size() > inlineLength && compact) {
+                slot.words[2] = pointerWord(arena.store(key).data());
+            }
+            ProbeCounter counter;
+            slots[freeSlot(homeOf(hash), counter)] = slot;
+        }
+        if (compact) {
+            garbageBytes = 0;
+        }
+        else {
+            arena = std::move(oldArena);
+        }
+
+#ifdef HASHLEGACY_STATS
+        long long nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+        stats.peakBytes.raise(oldBytes + memory_usage());
+        stats.rehashes++;
+        stats.rehashNanoseconds += nanoseconds;
+        if (traceHook) {
+            traceHook(TraceEvent{ TraceOperation::Rehash, 0, 0, 0, false, capacity(), nanoseconds });
+        }
+#endif
+    }
+
+    // Учёт операции в статистике и передача события обработчику трассировки. Без HASHLEGACY_STATS пуст
+    void record(TraceOperation operation, size_t home, const ProbeCounter& counter, bool found) const {
+#ifdef HASHLEGACY_STATS
+        stats.record(operation, counter);
+        if (traceHook) {
+            traceHook(TraceEvent{ operation, home, counter.probes, counter.comparisons, found, capacity(), 0 });
+        }
+#else
+        (void)operation;
+        (void)home;
+        (void)counter;
+        (void)found;
+#endif
+    }
+
+public:
+    static void testAllMethods() {
+        StringHashTable table(10);
+        assert(table.capacity() == 16);
+        // Ячейки выровнены: каждая целиком в одной строке кэша
+        assert(reinterpret_cast<uintptr_t>(table.slots.data()) % alignof(Slot) == 0);
+        // Короткие, граничные (16, 24, 25 байт) и длинные ключи, пустая строка
+        vector<string> keys;
+        for (int i = 0; i < 3000; i++) {
+            keys.push_back(string(i % 40, 'a' + i % 26) + to_string(i));
+        }
+        keys.push_back("");
+        keys.push_back(string(16, 'p'));
+        keys.push_back(string(24, 'q'));
+        keys.push_back(string(25, 'r'));
+        for ([[maybe_unused]] const string& key : keys) {
+            assert(table.insertUnique(key));
+        }
+        assert(!table.insertUnique(keys[1234]));
+        assert(!table.insertUnique(string(keys[2999])));
+        assert(table.size() == keys.size());
+        for ([[maybe_unused]] const string& key : keys) {
+            assert(table.contains(key));
+            assert(table.getListAtIndex(table.indexOf(key)) == key);
+        }
+        // Ключи, отличающиеся только после префикса в ячейке или только длиной
+        assert(!table.contains(string(24, 'q') + "x"));
+        assert(!table.contains(string(25, 'r').replace(24, 1, "s")));
+        assert(!table.contains(string(15, 'p')));
+        assert(table.indexOf("missing") == table.capacity());
+
+        size_t count = 0;
+        for ([[maybe_unused]] string_view key : table) {
+            assert(table.contains(key));
+            count++;
+        }
+        assert(count == table.size());
+
+        // Удаление со сдвигом назад и сжатие арены при перестройке
+        for (size_t i = 0; i < keys.size(); i += 2) {
+            table.erase(keys[i]);
+        }
+        table.erase("missing");
+        for (size_t i = 0; i < keys.size(); i++) {
+            assert(table.contains(keys[i]) == (i % 2 == 1));
+        }
+        [[maybe_unused]] size_t memory = table.memory_usage();
+        for (size_t i = 1; i < keys.size() - 10; i += 2) {
+            table.erase(keys[i]);
+        }
+        assert(table.memory_usage() < memory);
+        for (size_t i = keys.size() - 10; i < keys.size(); i++) {
+            assert(table.contains(keys[i]) == (i % 2 == 1));
+        }
+
+        // Смена ключа хеширования сохраняет ключи
+        table.useSeededHash();
+        for (size_t i = keys.size() - 10; i < keys.size(); i++) {
+            assert(table.contains(keys[i]) == (i % 2 == 1));
+        }
+
+        // Сравнение со стандартным множеством на случайных операциях при высокой загрузке
+        StringHashTable random(8, 0.9, 0.05);
+        unordered_set<string> reference;
+        mt19937 generator(54321);
+        for (int i = 0; i < 100000; i++) {
+            size_t n = generator() % 2048;
+            string key = (n % 3 == 0 ? string(30, 'L') : string()) + "k" + to_string(n);
+            if (generator() % 3 == 0) {
+                random.erase(key);
+                reference.erase(key);
+            }
+            else {
+                assert(random.insertUnique(key) == reference.insert(key).second);
+            }
+        }
+        assert(random.size() == reference.size());
+        for ([[maybe_unused]] const string& key : reference) {
+            assert(random.contains(key));
+        }
+
+        // Перемещение сохраняет текст длинных ключей
+        StringHashTable moved = std::move(random);
+        assert(moved.size() == reference.size());
+        for ([[maybe_unused]] const string& key : reference) {
+            assert(moved.contains(key));
+        }
+
+        // Копия не зависит от арены исходной таблицы
+        StringHashTable copy = moved;
+        moved.clear();
+        assert(copy.size() == reference.size());
+        for ([[maybe_unused]] const string& key : reference) {
+            assert(copy.contains(key) && !moved.contains(key));
+        }
+        moved = copy;
+        assert(moved.size() == reference.size() && moved.contains(*reference.begin()));
+        moved.clear();
+
+        assert(moved.size() == 0 && !moved.contains("k1"));
+
+        cout << "All tests passed successfully!" << endl;
+    }
+};
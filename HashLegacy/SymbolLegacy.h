@@ -0,0 +1,230 @@
+#pragma once
+// Таблица символов (интернирование строк): каждой различной строке -- постоянный 32-битный номер.
+// Номера выдаются подряд с нуля в порядке первого появления, поэтому данные о строках можно хранить
+// в обычных массивах по номеру, а сортировать и сравнивать -- целые числа. Текст нужен только при выводе.
+//
+// Текст строк копируется один раз в арену StringArena (ArenaLegacy.h), поэтому string_view, выданные таблицей,
+// действительны до clear() или уничтожения таблицы (перемещение таблицы их не портит).
+// Поиск номера по тексту -- хеш-таблица HashTable записей (текст в арене, номер)
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ArenaLegacy.h"
+#include "HashLegacy.h"
+
+using namespace std;
+
+// Запись таблицы символов: текст в арене и номер. Записи равны, если равны тексты
+struct SymbolEntry {
+    string_view text;
+    uint32_t id = 0;
+
+    bool operator==(const SymbolEntry& other) const {
+        return text == other.text;
+    }
+
+    bool operator!=(const SymbolEntry& other) const {
+        return !(*this == other);
+    }
+};
+
+// Хеширование записи с ключом (useSeededHash) -- по байтам текста
+template <>
+struct KeyedHash<SymbolEntry> {
+    static uint64_t hash(const SymbolEntry& entry, const HashSeed& seed, KeyedAlgorithm algorithm) {
+        return keyedHashBytes(entry.text.data(), entry.text.size(), seed, algorithm);
+    }
+};
+
+class SymbolTable {
+public:
+    // Номер, означающий отсутствие символа
+    static constexpr uint32_t npos = UINT32_MAX;
+
+private:
+    // Текст символов
+    StringArena arena;
+    // Текст символа по номеру
+    vector<string_view> symbols;
+    // Номер по тексту
+    HashTable<SymbolEntry> index;
+
+    static size_t hashEntry(const SymbolEntry& entry) {
+        return fnv1aStringHash(entry.text);
+    }
+
+public:
+    // capacity -- начальная ёмкость хеш-таблицы, arenaBlockSize -- размер блока арены в байтах
+    explicit SymbolTable(size_t capacity = 47, size_t arenaBlockSize = 64 * 1024)
+        : arena(arenaBlockSize), index(capacity, hashEntry) {}
+
+    // Записи указывают в арену этой таблицы, поэтому копирование запрещено; перемещение сохраняет и арену, и записи
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    SymbolTable(SymbolTable&&) = default;
+    SymbolTable& operator=(SymbolTable&&) = default;
+
+    // Номер строки; новая строка копируется в арену и получает следующий номер.
+    // Бросает исключение length_error, если номеров больше 2^32 - 1
+        // Сложность: O(1) в среднем случае (плюс длина строки)
+    uint32_t intern(string_view text) {
+        bool inserted = false;
+        size_t slot = index.findOrInsert(SymbolEntry{ text, static_cast<uint32_t>(symbols.size()) }, inserted);
+        SymbolEntry& entry = index.getListAtIndex(slot);
+        if (inserted) {
+            if (symbols.size() == npos) {
+                index.erase(entry);
+                throw length_error("SymbolTable supports fewer than 2^32 symbols");
+            }
+            // Запись указывала на текст вызывающего: заменяем его копией в арене (хеш тот же)
+            entry.text = arena.store(text);
+            symbols.push_back(entry.text);
+        }
+        return entry.id;
+    }
+
+    // Номер строки или npos, если строки нет в таблице
+        // Сложность: O(1) в среднем случае
+    uint32_t find(string_view text) const {
+        size_t slot = index.indexOf(SymbolEntry{ text, 0 });
+        return slot < index.capacity() ? index.getListAtIndex(slot).id : npos;
+    }
+
+    bool contains(string_view text) const {
+        return find(text) != npos;
+    }
+
+    // Текст символа. Бросает исключение out_of_range при неверном номере
+    string_view name(uint32_t id) const {
+        return symbols.at(id);
+    }
+
+    // Текст символа без проверки номера
+    string_view operator[](uint32_t id) const {
+        return symbols[id];
+    }
+
+    // Число символов; номера -- [0, size())
+    size_t size() const {
+        return symbols.size();
+    }
+
+    bool empty() const {
+        return symbols.empty();
+    }
+
+    // Резервирование места под count символов
+    void reserve(size_t count) {
+        index.reserve(count);
+        symbols.reserve(count);
+    }
+
+    // Удаление всех символов и освобождение арены. Выданные string_view становятся недействительными
+    void clear() {
+        index.clear();
+        symbols.clear();
+        arena.clear();
+    }
+
+    // Байт текста в арене
+    size_t arena_used() const {
+        return arena.used();
+    }
+
+    // Объём памяти в байтах: хеш-таблица, массив номеров и арена
+    size_t memory_usage() const {
+        return index.memory_usage() + symbols.capacity() * sizeof(string_view) + arena.memory_usage();
+    }
+
+    // Хеширование со случайным ключом (см. HashTable::useSeededHash)
+    void useSeededHash(KeyedAlgorithm algorithm = KeyedAlgorithm::SipHash) {
+        index.useSeededHash(algorithm);
+    }
+
+    // Используется ли хеширование со случайным ключом
+    bool isSeeded() const {
+        return index.isSeeded();
+    }
+
+    // Обход текстов символов в порядке номеров
+    vector<string_view>::const_iterator begin() const {
+        return symbols.begin();
+    }
+
+    vector<string_view>::const_iterator end() const {
+        return symbols.end();
+    }
+
+    static void testAllMethods();
+};
+
+inline void SymbolTable::testAllMethods() {
+    SymbolTable table(4, 16);
+    assert(table.empty() && table.find("a") == npos);
+
+    // Номера подряд в порядке первого появления, повтор возвращает тот же номер
+    assert(table.intern("alpha") == 0);
+    assert(table.intern("beta") == 1);
+    assert(table.intern(string("alpha")) == 0);
+    assert(table.intern("") == 2 && table.find("") == 2);
+    assert(table.size() == 3 && table.name(1) == "beta" && table[0] == "alpha" && table[2].empty());
+
+    // Текст хранится в арене, а не в строке вызывающего
+    string temporary = "gamma";
+    [[maybe_unused]] uint32_t gamma = table.intern(temporary);
+    temporary[0] = 'G';
+    assert(table.name(gamma) == "gamma" && table.find("gamma") == gamma && table.find("Gamma") == npos);
+
+    // Строка длиннее блока арены -- отдельный блок; соседние строки лежат в блоке подряд
+    string longText(100, 'x');
+    [[maybe_unused]] uint32_t longId = table.intern(longText);
+    assert(table.name(longId) == longText);
+    assert(table.name(1).data() == table.name(0).data() + 5);
+
+    // string_view остаются действительными при росте таблицы, перемещении и смене ключа хеширования
+    [[maybe_unused]] string_view alpha = table.name(0);
+    for (int i = 0; i < 5000; i++) {
+        assert(table.intern("w" + to_string(i)) == static_cast<uint32_t>(5 + i));
+    }
+    assert(alpha.data() == table.name(0).data());
+    table.useSeededHash(KeyedAlgorithm::WyHash);
+    SymbolTable moved = std::move(table);
+    assert(moved.name(0).data() == alpha.data());
+    for (int i = 0; i < 5000; i++) {
+        string word = "w" + to_string(i);
+        assert(moved.find(word) == static_cast<uint32_t>(5 + i));
+        assert(moved.name(5 + i) == word);
+    }
+    assert(moved.size() == 5005);
+
+    // Обход в порядке номеров; байты арены -- сумма длин строк
+    size_t id = 0;
+    size_t bytes = 0;
+    for (string_view text : moved) {
+        assert(moved.find(text) == id);
+        bytes += text.size();
+        id++;
+    }
+    assert(id == moved.size() && moved.arena_used() == bytes);
+    assert(moved.memory_usage() >= bytes);
+
+    [[maybe_unused]] bool caught = false;
+    try {
+        moved.name(static_cast<uint32_t>(moved.size()));
+    }
+    catch (const out_of_range&) {
+        caught = true;
+    }
+    assert(caught);
+
+    moved.clear();
+    assert(moved.empty() && moved.find("alpha") == npos && moved.arena_used() == 0);
+    assert(moved.intern("alpha") == 0);
+
+    cout << "All tests passed successfully!" << endl;
+}
@@ -0,0 +1,425 @@
+#pragma once
+// Запись и воспроизведение трасс операций хеш-таблиц: настройка таблицы проверяется на потоке операций
+// настоящей программы, а не на синтетическом замере.
+//
+// TraceWriter подключается к HashTable, Set или Dictionary через setTraceHook (сборка с HASHLEGACY_STATS)
+// и пишет вставки, поиски и удаления с хешами ключей в компактный двоичный файл. Ключ в трассе -- его 64-битный хеш:
+// при воспроизведении хеш служит ключом uint64_t, так что таблица любого вида с любой хеш-функцией получает
+// тот же поток операций над тем же множеством различных ключей (совпадения 64-битных хешей различных ключей
+// пренебрежимо редки). Во время записи хеши должны быть постоянны: таблица не должна менять ключ хеширования
+// (useSeededHash, длинные цепочки зондирования), поэтому load_word_counts_from_file при записи не включает случайный ключ.
+// IntHashTable, StringHashTable и CuckooHashTable сообщают в трассировку номер ячейки, а не хеш, поэтому их операции
+// для записи не годятся.
+//
+// Формат файла: заголовок "HLTR" и байт версии, затем записи до конца файла. Запись -- байт признаков:
+// операция (биты 0-1), найден ли ключ (бит 2), первое появление ключа (бит 3); за ним хеш нового ключа
+// (8 байт, младшие вперёд) или номер уже встречавшегося ключа в порядке появления (varint, 7 бит в байте).
+// Повторное обращение к одному из первых 2^21 ключей занимает 2-4 байта вместо 9.
+//
+// replay_trace выполняет трассу над таблицей дважды: без замеров отдельных операций -- для пропускной способности,
+// и с замером каждой операции -- для процентилей задержки
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "HashLegacy.h"
+#include "PairLegacy.h"
+#include "StatsLegacy.h"
+#include "ZipfLegacy.h"
+
+using namespace std;
+
+// Операция трассы: вид, найден ли ключ при записи и номер ключа в Trace
+struct TraceRecord {
+    uint32_t key;
+    TraceOperation operation;
+    bool found;
+};
+
+// Запись трассы в поток. Поток должен быть открыт в двоичном режиме и жить дольше писателя
+class TraceWriter {
+private:
+    using KeyId = KeyValuePair<uint64_t, uint32_t>;
+
+    static constexpr size_t bufferSize = 1 << 16;
+
+    ostream& out;
+    // Хеш ключа -> номер в порядке появления
+    HashTable<KeyId> ids;
+    string buffer;
+    size_t records;
+
+public:
+    static constexpr char magic[4] = { 'H', 'L', 'T', 'R' };
+    static constexpr uint8_t version = 1;
+
+    explicit TraceWriter(ostream& out)
+        : out(out), ids(1024, [](const KeyId& id) { return static_cast<size_t>(mixHash(id.key)); }), records(0) {
+        buffer.reserve(bufferSize + 16);
+        buffer.append(magic, sizeof(magic));
+        buffer.push_back(static_cast<char>(version));
+    }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    ~TraceWriter() {
+        flush();
+    }
+
+    // Запись события. Перехеширования не записываются: таблица при воспроизведении перехеширует сама
+    void record(const TraceEvent& event) {
+        if (event.operation == TraceOperation::Rehash) {
+            return;
+        }
+        bool inserted = false;
+        size_t slot = ids.findOrInsert(KeyId(event.hash, static_cast<uint32_t>(ids.size())), inserted);
+        uint8_t flags = static_cast<uint8_t>(event.operation) | (event.found ? 4 : 0) | (inserted ? 8 : 0);
+        buffer.push_back(static_cast<char>(flags));
+        if (inserted) {
+            uint64_t hash = event.hash;
+            for (int i = 0; i < 8; i++) {
+                buffer.push_back(static_cast<char>(hash >> (8 * i)));
+            }
+        }
+        else {
+            uint32_t id = ids.getListAtIndex(slot).value;
+            while (id >= 0x80) {
+                buffer.push_back(static_cast<char>((id & 0x7F) | 0x80));
+                id >>= 7;
+            }
+            buffer.push_back(static_cast<char>(id));
+        }
+        records++;
+        if (buffer.size() >= bufferSize) {
+            flush();
+        }
+    }
+
+    // Обработчик трассировки для setTraceHook. Писатель должен жить дольше таблицы или до снятия обработчика
+    TraceHook hook() {
+        return [this](const TraceEvent& event) { record(event); };
+    }
+
+    // Запись накопленных байт в поток
+    void flush() {
+        out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+        out.flush();
+        buffer.clear();
+    }
+
+    // Число записанных операций
+    size_t size() const {
+        return records;
+    }
+
+    // Число различных ключей
+    size_t keyCount() const {
+        return ids.size();
+    }
+};
+
+// Трасса, прочитанная в память
+class Trace {
+private:
+    // Хеши ключей по номерам
+    vector<uint64_t> keys;
+    vector<TraceRecord> records;
+
+public:
+    // Чтение трассы из потока. Бросает исключение runtime_error при неверном заголовке или оборванной записи
+    static Trace read(istream& in) {
+        string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        if (data.size() < sizeof(TraceWriter::magic) + 1 || data.compare(0, sizeof(TraceWriter::magic), TraceWriter::magic, sizeof(TraceWriter::magic)) != 0) {
+            throw runtime_error("Not a hash table trace");
+        }
+        if (static_cast<uint8_t>(data[sizeof(TraceWriter::magic)]) != TraceWriter::version) {
+            throw runtime_error("Unsupported trace version");
+        }
+        Trace trace;
+        size_t position = sizeof(TraceWriter::magic) + 1;
+        auto next = [&]() {
+            if (position >= data.size()) {
+                throw runtime_error("Truncated trace record");
+            }
+            return static_cast<uint8_t>(data[position++]);
+        };
+        while (position < data.size()) {
+            uint8_t flags = next();
+            TraceRecord record;
+            record.operation = static_cast<TraceOperation>(flags & 3);
+            record.found = (flags & 4) != 0;
+            if (flags & 8) {
+                uint64_t hash = 0;
+                for (int i = 0; i < 8; i++) {
+                    hash |= static_cast<uint64_t>(next()) << (8 * i);
+                }
+                record.key = static_cast<uint32_t>(trace.keys.size());
+                trace.keys.push_back(hash);
+            }
+            else {
+                uint32_t id = 0;
+                int shift = 0;
+                uint8_t byte;
+                do {
+                    byte = next();
+                    id |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                    shift += 7;
+                } while ((byte & 0x80) != 0 && shift < 35);
+                if (id >= trace.keys.size()) {
+                    throw runtime_error("Trace record refers to an unknown key");
+                }
+                record.key = id;
+            }
+            trace.records.push_back(record);
+        }
+        return trace;
+    }
+
+    // Чтение трассы из файла. Бросает исключение runtime_error, если файл не открывается или повреждён
+    static Trace load(const string& filename) {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open()) {
+            throw runtime_error("Cannot open trace file " + filename);
+        }
+        return read(file);
+    }
+
+    // Число операций
+    size_t size() const {
+        return records.size();
+    }
+
+    // Число различных ключей
+    size_t keyCount() const {
+        return keys.size();
+    }
+
+    // Ключ операции для воспроизведения -- хеш исходного ключа
+    uint64_t keyOf(const TraceRecord& record) const {
+        return keys[record.key];
+    }
+
+    // Число операций вида operation
+    size_t count(TraceOperation operation) const {
+        return static_cast<size_t>(count_if(records.begin(), records.end(), [operation](const TraceRecord& record) { return record.operation == operation; }));
+    }
+
+    const TraceRecord& operator[](size_t index) const {
+        return records[index];
+    }
+
+    vector<TraceRecord>::const_iterator begin() const {
+        return records.begin();
+    }
+
+    vector<TraceRecord>::const_iterator end() const {
+        return records.end();
+    }
+
+    static void testAllMethods();
+};
+
+// Результат воспроизведения трассы
+struct ReplayReport {
+    size_t operations = 0;
+    // Время прохода без замеров отдельных операций
+    double seconds = 0.0;
+    // Процентили задержки операции в наносекундах (за вычетом времени вызова часов)
+    long long p50 = 0;
+    long long p90 = 0;
+    long long p99 = 0;
+    long long p999 = 0;
+    long long maxLatency = 0;
+    // Поиски, результат которых разошёлся с записанным (при верной записи -- 0)
+    size_t mismatches = 0;
+    // Размер и память таблицы после прохода
+    size_t finalSize = 0;
+    size_t memoryBytes = 0;
+
+    // Операций в секунду
+    double throughput() const {
+        return seconds > 0.0 ? operations / seconds : 0.0;
+    }
+};
+
+// Выполнение одной операции трассы. Вставка выполняется как insertUnique: повторная вставка того же ключа
+// обычным insert при воспроизведении не дублирует ключ. Возвращает, совпал ли результат поиска с записанным
+template <typename Table>
+bool replay_operation(Table& table, TraceOperation operation, uint64_t key, bool found) {
+    switch (operation) {
+    case TraceOperation::Insert:
+        table.insertUnique(key);
+        return true;
+    case TraceOperation::Find:
+    case TraceOperation::Contains:
+        return table.contains(key) == found;
+    case TraceOperation::Erase:
+        table.erase(key);
+        return true;
+    default:
+        return true;
+    }
+}
+
+// Время вызова steady_clock::now() в наносекундах (медиана): вычитается из замеров отдельных операций
+inline long long clock_overhead() {
+    vector<long long> samples(1001);
+    for (long long& sample : samples) {
+        auto start = chrono::steady_clock::now();
+        sample = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    }
+    nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+// Воспроизведение трассы над таблицами, которые создаёт makeTable(). Таблица должна поддерживать
+// insertUnique, contains, erase, size и memory_usage для ключей uint64_t (HashTable, IntHashTable, CuckooHashTable
+// или адаптер). Пропускная способность замеряется на первой таблице, задержки -- на второй
+template <typename MakeTable>
+ReplayReport replay_trace(const Trace& trace, MakeTable makeTable) {
+    ReplayReport report;
+    report.operations = trace.size();
+    {
+        auto table = makeTable();
+        auto start = chrono::steady_clock::now();
+        for (const TraceRecord& record : trace) {
+            report.mismatches += replay_operation(table, record.operation, trace.keyOf(record), record.found) ? 0 : 1;
+        }
+        report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        report.finalSize = table.size();
+        report.memoryBytes = table.memory_usage();
+    }
+    if (trace.size() == 0) {
+        return report;
+    }
+
+    long long overhead = clock_overhead();
+    vector<long long> latencies;
+    latencies.reserve(trace.size());
+    auto table = makeTable();
+    for (const TraceRecord& record : trace) {
+        uint64_t key = trace.keyOf(record);
+        auto start = chrono::steady_clock::now();
+        replay_operation(table, record.operation, key, record.found);
+        long long elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        latencies.push_back(max(0LL, elapsed - overhead));
+    }
+    auto percentile = [&](double fraction) {
+        auto position = latencies.begin() + min(latencies.size() - 1, static_cast<size_t>(fraction * latencies.size()));
+        nth_element(latencies.begin(), position, latencies.end());
+        return *position;
+    };
+    report.p50 = percentile(0.5);
+    report.p90 = percentile(0.9);
+    report.p99 = percentile(0.99);
+    report.p999 = percentile(0.999);
+    report.maxLatency = *max_element(latencies.begin(), latencies.end());
+    return report;
+}
+
+inline void Trace::testAllMethods() {
+    // Запись событий вручную: первые появления ключей, повторы с большими номерами, перехеширование пропускается
+    stringstream stream;
+    {
+        TraceWriter writer(stream);
+        for (uint64_t i = 0; i < 300; i++) {
+            writer.record(TraceEvent{ TraceOperation::Insert, i * 0x9E3779B97F4A7C15ull, 0, 0, true, 0, 0 });
+        }
+        writer.record(TraceEvent{ TraceOperation::Rehash, 0, 0, 0, false, 1024, 100 });
+        writer.record(TraceEvent{ TraceOperation::Find, 299 * 0x9E3779B97F4A7C15ull, 0, 0, true, 0, 0 });
+        writer.record(TraceEvent{ TraceOperation::Erase, 5 * 0x9E3779B97F4A7C15ull, 0, 0, true, 0, 0 });
+        writer.record(TraceEvent{ TraceOperation::Contains, 5 * 0x9E3779B97F4A7C15ull, 0, 0, false, 0, 0 });
+        writer.record(TraceEvent{ TraceOperation::Contains, 12345, 0, 0, false, 0, 0 });
+        assert(writer.size() == 304 && writer.keyCount() == 301);
+    }
+    // Заголовок, 301 новый ключ по 9 байт, повторы номеров 299 (2 байта varint) и 5 (1 байт) с байтом признаков
+    assert(stream.str().size() == 5 + 301 * 9 + 3 + 2 + 2);
+
+    Trace trace = Trace::read(stream);
+    assert(trace.size() == 304 && trace.keyCount() == 301);
+    assert(trace.count(TraceOperation::Insert) == 300 && trace.count(TraceOperation::Contains) == 2);
+    assert(trace[300].operation == TraceOperation::Find && trace[300].found && trace.keyOf(trace[300]) == 299 * 0x9E3779B97F4A7C15ull);
+    assert(trace[302].operation == TraceOperation::Contains && !trace[302].found && trace[302].key == 5);
+    assert(trace.keyOf(trace[303]) == 12345);
+
+    // Воспроизведение: ключи и результаты поисков совпадают с записанными
+    [[maybe_unused]] ReplayReport report = replay_trace(trace, []() { return HashTable<uint64_t>(16); });
+    assert(report.operations == 304 && report.mismatches == 0 && report.finalSize == 299);
+    assert(report.p50 <= report.p90 && report.p90 <= report.p99 && report.p99 <= report.p999 && report.p999 <= report.maxLatency);
+    assert(report.memoryBytes > 0);
+
+    // Повреждённые трассы
+    [[maybe_unused]] bool caught = false;
+    try {
+        stringstream bad("HLTX\x01");
+        Trace::read(bad);
+    }
+    catch (const runtime_error&) {
+        caught = true;
+    }
+    assert(caught);
+    caught = false;
+    try {
+        string truncated = stream.str().substr(0, 5 + 4);
+        stringstream bad(truncated);
+        Trace::read(bad);
+    }
+    catch (const runtime_error&) {
+        caught = true;
+    }
+    assert(caught);
+
+#ifdef HASHLEGACY_STATS
+    // Запись настоящей таблицы: воспроизведение с другой хеш-функцией даёт те же результаты поисков
+    stringstream recorded;
+    [[maybe_unused]] size_t expectedSize = 0;
+    {
+        TraceWriter writer(recorded);
+        HashTable<int> table(16);
+        table.setTraceHook(writer.hook());
+        for (int i = 0; i < 5000; i++) {
+            table.insertUnique(i % 3000);
+            if (i % 7 == 0) {
+                table.erase(i / 2);
+            }
+            table.contains(i * 3);
+        }
+        expectedSize = table.size();
+        table.setTraceHook(nullptr);
+    }
+    Trace real = Trace::read(recorded);
+    assert(real.keyCount() > 3000 && real.count(TraceOperation::Rehash) == 0);
+    [[maybe_unused]] ReplayReport replayed = replay_trace(real, []() { return HashTable<uint64_t>(16, [](const uint64_t& key) { return static_cast<size_t>(mixHash(key)); }, 0.5); });
+    assert(replayed.mismatches == 0 && replayed.finalSize == expectedSize);
+
+    // Подсчёт слов с записью трассы: хеширование детерминированное, иначе смена ключа дала бы слову второй хеш.
+    // Воспроизведение повторяет результаты всех поисков словаря
+    string path = (filesystem::temp_directory_path() / ("hashlegacy_trace_test_" + to_string(reinterpret_cast<uintptr_t>(&recorded)) + ".txt")).string();
+    ofstream(path) << "The dog sat; the DOG ran.\nA cat and a dog";
+    stringstream wordTrace;
+    [[maybe_unused]] size_t distinctWords = 0;
+    {
+        TraceWriter writer(wordTrace);
+        Dictionary<string, size_t> traced = load_word_counts_from_file(path, writer.hook());
+        assert(!traced.isSeeded() && *traced.find("dog") == 3);
+        distinctWords = traced.size();
+    }
+    remove(path.c_str());
+    Trace words = Trace::read(wordTrace);
+    assert(words.keyCount() == distinctWords && words.count(TraceOperation::Rehash) == 0);
+    [[maybe_unused]] ReplayReport wordReplay = replay_trace(words, []() { return HashTable<uint64_t>(16, [](const uint64_t& key) { return static_cast<size_t>(mixHash(key)); }); });
+    assert(wordReplay.mismatches == 0 && wordReplay.finalSize == distinctWords);
+#endif
+
+    cout << "All tests passed successfully!" << endl;
+}
@@ -0,0 +1,227 @@
+// TraceReplayLegacy.cpp : воспроизведение трассы операций (TraceLegacy.h) над таблицами разных видов и настроек.
+//
+// Использование: hashlegacy_replay [-t таблица] [-h хеш] [-l загрузка] [-m загрузка] [-c ёмкость] [-r] <трасса>
+//   -t -- вид таблицы: hashtable (по умолчанию), raw, indirect, cow (HashTable со способами хранения SlotsLegacy.h),
+//         set, bloom (Set с фильтром Блума), cuckoo, int (IntHashTable, своя хеш-функция), unordered (std::unordered_set)
+//         или all -- все виды по очереди
+//   -h -- хеш-функция ключа: fnv1a (по умолчанию), murmur, djb2, mix (splitmix64) или identity (записанный хеш как есть)
+//   -l -- максимальный коэффициент загрузки (по умолчанию -- свой у каждого вида)
+//   -m -- минимальный коэффициент загрузки: при меньшей загрузке таблица уменьшается (HashTable, cuckoo, int)
+//   -c -- начальная ёмкость (по умолчанию 16)
+//   -r -- резервирование места под все ключи трассы до воспроизведения
+// Для каждого вида выводятся пропускная способность, процентили задержки операции, итоговые размер и память.
+// Трасса записывается утилитой hashlegacy_wordcount_stats -T или своим кодом через TraceWriter
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "HashLegacy.h"
+#include "SetLegacy.h"
+#include "CuckooLegacy.h"
+#include "IntHashLegacy.h"
+#include "TraceLegacy.h"
+
+using namespace std;
+
+using KeyHash = function<size_t(const uint64_t&)>;
+
+// Настройки таблицы для воспроизведения
+struct ReplayOptions {
+    KeyHash hashFunction;
+    optional<double> maxLoadFactor;
+    optional<double> minLoadFactor;
+    size_t capacity = 16;
+    // Число ключей для резервирования (0 -- без резервирования)
+    size_t reserve = 0;
+};
+
+// Адаптеры приводят множества к операциям replay_trace
+template <typename SetType>
+struct SetReplay {
+    SetType set;
+    SetReplay(const ReplayOptions& options) : set(options.capacity, options.hashFunction, options.maxLoadFactor.value_or(0.7)) {}
+    bool insertUnique(uint64_t key) { size_t before = set.size(); set.insert(key); return set.size() != before; }
+    bool contains(uint64_t key) const { return set.contains(key); }
+    void erase(uint64_t key) { set.erase(key); }
+    void reserve(size_t count) { set.reserve(count); }
+    size_t size() const { return set.size(); }
+    size_t memory_usage() const { return set.memory_usage(); }
+};
+
+// std::unordered_set: узлы считаются по размеру ключа и указателя, без служебных данных распределителя
+struct UnorderedReplay {
+    unordered_set<uint64_t, KeyHash> set;
+    UnorderedReplay(const ReplayOptions& options) : set(options.capacity, options.hashFunction) {
+        set.max_load_factor(static_cast<float>(options.maxLoadFactor.value_or(1.0)));
+    }
+    bool insertUnique(uint64_t key) { return set.insert(key).second; }
+    bool contains(uint64_t key) const { return set.count(key) != 0; }
+    void erase(uint64_t key) { set.erase(key); }
+    void reserve(size_t count) { set.reserve(count); }
+    size_t size() const { return set.size(); }
+    size_t memory_usage() const { return sizeof(set) + set.bucket_count() * sizeof(void*) + set.size() * (sizeof(uint64_t) + 2 * sizeof(void*)); }
+};
+
+template <typename Table>
+Table prepared(Table table, const ReplayOptions& options) {
+    if (options.reserve > 0) {
+        table.reserve(options.reserve);
+    }
+    return table;
+}
+
+template <typename Slots>
+ReplayReport replay_hash_table(const Trace& trace, const ReplayOptions& options) {
+    return replay_trace(trace, [&]() {
+        return prepared(HashTable<uint64_t, Slots>(options.capacity, options.hashFunction, options.maxLoadFactor.value_or(0.7), options.minLoadFactor.value_or(0.2)), options);
+    });
+}
+
+// Виды таблиц для -t
+const vector<string> tableKinds = { "hashtable", "raw", "indirect", "cow", "set", "bloom", "cuckoo", "int", "unordered" };
+
+// Воспроизведение над таблицей вида kind. Возвращает пустой результат для неизвестного вида
+optional<ReplayReport> replay_kind(const string& kind, const Trace& trace, const ReplayOptions& options) {
+    if (kind == "hashtable") {
+        return replay_hash_table<DenseSlots<uint64_t>>(trace, options);
+    }
+    if (kind == "raw") {
+        return replay_hash_table<RawSlots<uint64_t>>(trace, options);
+    }
+    if (kind == "indirect") {
+        return replay_hash_table<IndirectSlots<uint64_t>>(trace, options);
+    }
+    if (kind == "cow") {
+        return replay_hash_table<CowSlots<uint64_t>>(trace, options);
+    }
+    if (kind == "set") {
+        return replay_trace(trace, [&]() { return prepared(SetReplay<Set<uint64_t>>(options), options); });
+    }
+    if (kind == "bloom") {
+        return replay_trace(trace, [&]() { return prepared(SetReplay<Set<uint64_t, DenseSlots<uint64_t>, 8, BlockedBloomFilter>>(options), options); });
+    }
+    if (kind == "cuckoo") {
+        return replay_trace(trace, [&]() {
+            return prepared(CuckooHashTable<uint64_t>(options.capacity, options.hashFunction, options.maxLoadFactor.value_or(0.9), options.minLoadFactor.value_or(0.2)), options);
+        });
+    }
+    if (kind == "int") {
+        return replay_trace(trace, [&]() {
+            return prepared(IntHashTable<uint64_t>(options.capacity, options.maxLoadFactor.value_or(0.7), options.minLoadFactor.value_or(0.2)), options);
+        });
+    }
+    if (kind == "unordered") {
+        return replay_trace(trace, [&]() { return prepared(UnorderedReplay(options), options); });
+    }
+    return nullopt;
+}
+
+optional<KeyHash> hash_by_name(const string& name) {
+    if (name == "fnv1a") {
+        return KeyHash(HashTable<uint64_t>::defaultHash);
+    }
+    if (name == "murmur") {
+        return KeyHash(murmurHash<uint64_t>);
+    }
+    if (name == "djb2") {
+        return KeyHash(djb2Hash<uint64_t>);
+    }
+    if (name == "mix") {
+        return KeyHash([](const uint64_t& key) { return static_cast<size_t>(mixHash(key)); });
+    }
+    if (name == "identity") {
+        return KeyHash([](const uint64_t& key) { return static_cast<size_t>(key); });
+    }
+    return nullopt;
+}
+
+int main(int argc, char** argv) {
+    string kind = "hashtable";
+    string hashName = "fnv1a";
+    ReplayOptions options;
+    bool reserveAll = false;
+    vector<string> arguments;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "-t" && i + 1 < argc) {
+            kind = argv[++i];
+        }
+        else if (argument == "-h" && i + 1 < argc) {
+            hashName = argv[++i];
+        }
+        else if (argument == "-l" && i + 1 < argc) {
+            options.maxLoadFactor = stod(argv[++i]);
+        }
+        else if (argument == "-m" && i + 1 < argc) {
+            options.minLoadFactor = stod(argv[++i]);
+        }
+        else if (argument == "-c" && i + 1 < argc) {
+            options.capacity = max<size_t>(1, static_cast<size_t>(stoul(argv[++i])));
+        }
+        else if (argument == "-r") {
+            reserveAll = true;
+        }
+        else {
+            arguments.push_back(argument);
+        }
+    }
+    if (arguments.size() != 1) {
+        cerr << "Использование: " << argv[0] << " [-t таблица] [-h хеш] [-l загрузка] [-m загрузка] [-c ёмкость] [-r] <трасса>" << endl;
+        return 1;
+    }
+    optional<KeyHash> hashFunction = hash_by_name(hashName);
+    if (!hashFunction) {
+        cerr << "Неизвестная хеш-функция: " << hashName << endl;
+        return 1;
+    }
+    options.hashFunction = *hashFunction;
+    vector<string> kinds = { kind };
+    if (kind == "all") {
+        kinds = tableKinds;
+    }
+    else if (find(tableKinds.begin(), tableKinds.end(), kind) == tableKinds.end()) {
+        cerr << "Неизвестный вид таблицы: " << kind << endl;
+        return 1;
+    }
+
+    Trace trace;
+    try {
+        trace = Trace::load(arguments[0]);
+    }
+    catch (const runtime_error& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    if (reserveAll) {
+        options.reserve = trace.keyCount();
+    }
+    cout << "Операций: " << trace.size() << " (вставок " << trace.count(TraceOperation::Insert)
+         << ", поисков " << trace.count(TraceOperation::Find) + trace.count(TraceOperation::Contains)
+         << ", удалений " << trace.count(TraceOperation::Erase) << "), различных ключей: " << trace.keyCount() << endl;
+
+    // Заголовки столбцов латиницей: setw считает байты, а не символы UTF-8. Задержки -- в наносекундах, память -- в байтах
+    cout << left << setw(10) << "table" << right << setw(12) << "Mops/s" << setw(8) << "p50" << setw(8) << "p90"
+         << setw(8) << "p99" << setw(8) << "p99.9" << setw(10) << "max" << setw(10) << "keys" << setw(12) << "bytes" << endl;
+    for (const string& name : kinds) {
+        optional<ReplayReport> report;
+        try {
+            report = replay_kind(name, trace, options);
+        }
+        catch (const exception& error) {
+            cerr << name << ": " << error.what() << endl;
+            continue;
+        }
+        cout << left << setw(10) << name << right << fixed << setprecision(2) << setw(12) << report->throughput() / 1e6
+             << setw(8) << report->p50 << setw(8) << report->p90 << setw(8) << report->p99 << setw(8) << report->p999
+             << setw(10) << report->maxLatency << setw(10) << report->finalSize << setw(12) << report->memoryBytes << endl;
+        if (report->mismatches > 0) {
+            cerr << name << ": " << report->mismatches << " поисков разошлись с записанными (ключи с одинаковым хешем или смена ключа хеширования при записи)" << endl;
+        }
+    }
+    return 0;
+}
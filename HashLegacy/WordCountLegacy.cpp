@@ -0,0 +1,121 @@
+// WordCountLegacy.cpp : консольная утилита подсчёта частот слов (закон Ципфа).
+//
+// Использование: hashlegacy_wordcount [-q] [-a K | -p N] <файл> [файл частот] [файл графика]
+//                hashlegacy_wordcount [-q] -n N [-k K] [-p N] <файл> [файл частот] [файл графика]
+//                hashlegacy_wordcount [-q] -c K <каталог> [файл слов документов]
+//                hashlegacy_wordcount_stats -T <файл трассы> <файл>
+//   -q   -- не выводить частоты в консоль
+//   -a K -- приближённый подсчёт с ограниченной памятью: только K самых частых слов и оценка числа различных слов
+//   -p N -- конвейерное чтение: файл читается блоками в отдельном потоке, слова считают N потоков
+//   -n N -- частоты n-грамм (N от 1 до 3 слов подряд) вместо слов; файл считают потоки -p (по умолчанию -- по числу ядер)
+//   -k K -- в режиме n-грамм сохраняются только K самых частых
+//   -c K -- корпус: все файлы каталога читаются параллельно, для каждого документа сохраняются K слов
+//           с наибольшим TF-IDF
+//   -T F -- запись трассы операций словаря при однопоточном подсчёте слов в файл F для hashlegacy_replay
+//           (только в сборке со счётчиками HASHLEGACY_STATS -- hashlegacy_wordcount_stats)
+// По умолчанию частоты сохраняются в data.txt, скрипт графика -- в chart.txt
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ZipfLegacy.h"
+#include "CorpusLegacy.h"
+#include "NGramLegacy.h"
+#include "TraceLegacy.h"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    bool verbose = true;
+    size_t topK = 0;
+    size_t pipelineWorkers = 0;
+    size_t corpusTerms = 0;
+    size_t ngramOrder = 0;
+    size_t ngramTop = 0;
+    string traceFilename;
+    vector<string> arguments;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "-q") {
+            verbose = false;
+        }
+        else if (argument == "-a" && i + 1 < argc) {
+            topK = static_cast<size_t>(stoul(argv[++i]));
+        }
+        else if (argument == "-c" && i + 1 < argc) {
+            corpusTerms = max<size_t>(1, static_cast<size_t>(stoul(argv[++i])));
+        }
+        else if (argument == "-n" && i + 1 < argc) {
+            ngramOrder = static_cast<size_t>(stoul(argv[++i]));
+        }
+        else if (argument == "-k" && i + 1 < argc) {
+            ngramTop = static_cast<size_t>(stoul(argv[++i]));
+        }
+        else if (argument == "-T" && i + 1 < argc) {
+            traceFilename = argv[++i];
+        }
+        else if (argument == "-p" && i + 1 < argc) {
+            pipelineWorkers = max<size_t>(1, static_cast<size_t>(stoul(argv[++i])));
+        }
+        else {
+            arguments.push_back(argument);
+        }
+    }
+
+    if (arguments.empty()) {
+        cerr << "Использование: " << argv[0] << " [-q] [-a K | -p N] <файл> [файл частот] [файл графика]" << endl;
+        cerr << "               " << argv[0] << " [-q] -n N [-k K] [-p N] <файл> [файл частот] [файл графика]" << endl;
+        cerr << "               " << argv[0] << " [-q] -c K <каталог> [файл слов документов]" << endl;
+        cerr << "               " << argv[0] << " -T <файл трассы> <файл>" << endl;
+        return 1;
+    }
+    if (corpusTerms > 0) {
+        if (!filesystem::is_directory(arguments[0])) {
+            cerr << "Каталог не найден: " << arguments[0] << endl;
+            return 1;
+        }
+        process_corpus(arguments[0], arguments.size() > 1 ? arguments[1] : "data.txt", corpusTerms, verbose);
+        return 0;
+    }
+    if (!ifstream(arguments[0]).is_open()) {
+        cerr << "Файл не найден: " << arguments[0] << endl;
+        return 1;
+    }
+
+    if (!traceFilename.empty()) {
+#ifdef HASHLEGACY_STATS
+        ofstream traceFile(traceFilename, ios::binary);
+        if (!traceFile.is_open()) {
+            cerr << "Не удалось создать файл трассы: " << traceFilename << endl;
+            return 1;
+        }
+        TraceWriter writer(traceFile);
+        Dictionary<string, size_t> word_counts = load_word_counts_from_file(arguments[0], writer.hook());
+        writer.flush();
+        cout << "Записано операций: " << writer.size() << ", различных ключей: " << writer.keyCount()
+             << ", слов в словаре: " << word_counts.size() << endl;
+        return 0;
+#else
+        cerr << "Запись трассы доступна только в сборке с HASHLEGACY_STATS (hashlegacy_wordcount_stats)" << endl;
+        return 1;
+#endif
+    }
+
+    string dataFilename = arguments.size() > 1 ? arguments[1] : "data.txt";
+    string chartFilename = arguments.size() > 2 ? arguments[2] : "chart.txt";
+    if (ngramOrder > 0) {
+        if (ngramOrder > NGramCounter::maxOrder) {
+            cerr << "Длина n-грамм должна быть от 1 до " << NGramCounter::maxOrder << endl;
+            return 1;
+        }
+        process_ngrams(arguments[0], ngramOrder, ngramTop, dataFilename, chartFilename, verbose, pipelineWorkers);
+    }
+    else if (topK > 0) {
+        process_file_approximate(arguments[0], topK, dataFilename, chartFilename, verbose);
+    }
+    else {
+        process_file(arguments[0], dataFilename, chartFilename, verbose, pipelineWorkers);
+    }
+    return 0;
+}
@@ -0,0 +1,571 @@
+#pragma once
+// Подсчёт частот слов в тексте и подготовка данных для графика закона Ципфа.
+// Точный подсчёт -- словарь load_word_counts_from_file (load_word_counts_pipelined -- с чтением,
+// совмещённым с подсчётом) или частоты по номерам слов load_symbol_counts_from_file, приближённый с ограниченной памятью -- WordSketches
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <locale>
+#include <codecvt>
+#include <stdexcept>
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include "HashLegacy.h"
+#include "DictionaryLegacy.h"
+#include "SketchLegacy.h"
+#include "IngestLegacy.h"
+#include "SymbolLegacy.h"
+
+using namespace std;
+
+// Скрипт графика частот: count точек, keyAt(i) -- слово i-й точки, valueAt(i) -- его частота
+template <typename KeyAt, typename ValueAt>
+void generatePlantUMLGraph(size_t count, KeyAt keyAt, ValueAt valueAt, const std::string& filename, double stop = 0.2) {
+    std::ofstream outFile(filename);
+
+    // Проверяем, успешно ли открыт файл
+    if (!outFile.is_open()) {
+        std::cerr << "Ошибка открытия файла для записи." << std::endl;
+        return;
+    }
+
+    // Записываем заголовок и настройки для PlantUML
+    outFile << "import matplotlib.pyplot as plt\n";
+    outFile << "import numpy as np\n";
+    outFile << "import seaborn # pip install seaborn\n";
+    outFile << "plt.figure( figsize=(150, 100) )\n";
+    outFile << "plt.title(\"Закон Ципфа\")\n";
+
+
+    stringstream words;
+    stringstream numbers;
+    words << "words =[";
+    numbers << "numbers =[";
+
+    size_t i = 0;
+
+    for (size_t point = 0; point < count; point++) {
+        words << "\"" << keyAt(point) << "\", ";
+        numbers << valueAt(point) << ", ";
+        i++;
+        if (i / count > stop)
+            break;
+    }
+    string words_s = words.str();
+    words_s.erase(words_s.end() - 2, words_s.end());
+    words.str("");
+    words << words_s;
+
+    string numbers_s = numbers.str();
+    numbers_s.erase(numbers_s.end() - 2, numbers_s.end());
+    numbers.str("");
+    numbers << numbers_s;
+    words << "]";
+    numbers << "]";
+
+
+    outFile << words.str() << "\n";
+    outFile << numbers.str() << "\n";
+
+    outFile << "plt.plot(words, numbers, marker=\'o\', linestyle=\'-\')\n";
+
+
+    outFile << "plt.grid(True)\n";
+    outFile << "plt.xlabel('Ранг слова')\n";
+    outFile << "plt.xticks(rotation=90) \n";
+    outFile << "plt.ylabel('Частота встречи')\n";
+    outFile << "import seaborn # pip install seaborn\n";
+    outFile << "plt.legend(loc = 'best')\n";
+    outFile << "plt.savefig('plot.svg', format='svg')\n";
+    outFile << "plt.show()\n";
+
+
+
+    // Закрываем файл
+    outFile.close();
+}
+
+inline void generatePlantUMLGraph(const std::vector<KeyValuePair<std::string, size_t>>& data, const std::string& filename, double stop = 0.2) {
+    generatePlantUMLGraph(data.size(), [&](size_t i) -> const std::string& { return data[i].key; },
+        [&](size_t i) { return data[i].value; }, filename, stop);
+}
+
+// Локаль для классификации букв. Если русская локаль не установлена (частый случай на Linux-серверах),
+// используется C.UTF-8, а при её отсутствии -- локаль по умолчанию
+inline const std::locale& word_locale() {
+    static const std::locale loc = []() {
+        for (const char* name : { "ru_RU.UTF-8", "C.UTF-8" }) {
+            try {
+                return std::locale(name);
+            }
+            catch (const std::runtime_error&) {
+            }
+        }
+        return std::locale();
+    }();
+    return loc;
+}
+
+inline std::wstring clear_and_lowercase(const std::wstring& input) {
+    std::wstring result;
+    const std::locale& loc = word_locale();
+
+    for (wchar_t c : input) {
+        if (std::isalpha(c, loc)) {
+            result += std::tolower(c, loc);
+        }
+    }
+    return result;
+}
+
+inline std::string clean_word(const std::string& input) {
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+    std::wstring wide_string = converter.from_bytes(input);
+    std::wstring cleaned_wide_string = clear_and_lowercase(wide_string);
+    return converter.to_bytes(cleaned_wide_string);
+}
+
+
+// Чтение слов файла: каждое непустое очищенное слово передаётся в callback.
+// Возвращает false, если файл не удалось открыть
+template <typename Callback>
+bool for_each_word(const string& filename, Callback callback) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    string line;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string word;
+        while (ss >> word) {
+            word = clean_word(word);
+            if (!word.empty()) {
+                callback(word);
+            }
+        }
+    }
+    return true;
+}
+
+
+// Слова приходят из файлов пользователя, и подобранный текст мог бы собрать их в одну цепочку зондирования.
+// Поэтому словари и таблицы символов подсчёта хешируют слова со случайным ключом (см. HashTable::useSeededHash);
+// порядок вывода от ключа не зависит. Детерминированное хеширование остаётся по умолчанию у Dictionary и HashTable
+// для тестов и бенчмарков
+constexpr KeyedAlgorithm wordHashAlgorithm = KeyedAlgorithm::SipHash;
+
+// traceHook получает операции таблицы словаря во время подсчёта (сборка с HASHLEGACY_STATS, см. TraceLegacy.h).
+// При записи трассы хеширование детерминированное: смена ключа хеширования дала бы одному слову два хеша
+inline Dictionary<string, size_t> load_word_counts_from_file(const string& filename, TraceHook traceHook = nullptr) {
+    Dictionary<string, size_t> word_counts(100);
+    if (!traceHook) {
+        word_counts.useSeededHash(wordHashAlgorithm);
+    }
+    word_counts.setTraceHook(traceHook);
+
+    // Если файл не существует, возвращаем пустой словарь
+    bool opened = for_each_word(filename, [&](const string& word) {
+        size_t* count = word_counts.find(word);
+        if (count != nullptr) {
+            (*count)++;
+        }
+        else {
+            word_counts.insert(word, 1);
+        }
+        });
+    if (!opened) {
+        cerr << "Файл не найден: " << filename << endl;
+    }
+    word_counts.setTraceHook(nullptr);
+    return word_counts;
+}
+
+// Частоты слов по номерам таблицы символов: текст каждого слова хранится один раз, в арене symbols,
+// а частоты, сортировка и вывод работают с 32-битными номерами. Строки нужны только при записи результата
+struct SymbolCounts {
+    SymbolTable symbols;
+    // Частота слова по его номеру
+    vector<size_t> counts;
+
+    SymbolCounts() {
+        symbols.useSeededHash(wordHashAlgorithm);
+    }
+
+    void add(string_view word) {
+        uint32_t id = symbols.intern(word);
+        if (id == counts.size()) {
+            counts.push_back(0);
+        }
+        counts[id]++;
+    }
+};
+
+inline SymbolCounts load_symbol_counts_from_file(const string& filename) {
+    SymbolCounts word_counts;
+    // Если файл не существует, возвращаем пустые частоты
+    if (!for_each_word(filename, [&](const string& word) { word_counts.add(word); })) {
+        cerr << "Файл не найден: " << filename << endl;
+    }
+    return word_counts;
+}
+
+// Номера слов по убыванию частоты; при равных частотах -- по алфавиту, как в sort_word_counts,
+// чтобы однопоточный и конвейерный подсчёт выводили одно и то же. Сортируются 4-байтовые номера, а не пары со строками
+inline vector<uint32_t> sort_symbol_counts(const SymbolCounts& word_counts) {
+    vector<uint32_t> order(word_counts.counts.size());
+    for (size_t id = 0; id < order.size(); ++id) {
+        order[id] = static_cast<uint32_t>(id);
+    }
+    const vector<size_t>& counts = word_counts.counts;
+    const SymbolTable& symbols = word_counts.symbols;
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return counts[a] > counts[b] || (counts[a] == counts[b] && symbols[a] < symbols[b]);
+        });
+    return order;
+}
+
+inline void save_symbol_counts_to_file(const SymbolCounts& word_counts, const vector<uint32_t>& order, const std::string& filename) {
+    ofstream dataFile(filename);
+    if (!dataFile.is_open()) {
+        cerr << "Ошибка открытия файла для записи: " << filename << endl;
+        return;
+    }
+
+    for (uint32_t id : order) {
+        dataFile << word_counts.symbols[id] << " " << word_counts.counts[id] << "\n";
+    }
+    dataFile.close();
+}
+
+// Подсчёт слов в нескольких файлах: файлы считаются параллельно в отдельные словари (threadCount потоков,
+// 0 -- по числу ядер), затем частоты складываются попарным слиянием словарей (Dictionary::mergeAll)
+inline Dictionary<string, size_t> load_word_counts_from_files(const vector<string>& filenames, size_t threadCount = 0) {
+    vector<Dictionary<string, size_t>> parts(filenames.size());
+    if (threadCount == 0) {
+        threadCount = defaultThreadCount();
+    }
+    size_t workers = max<size_t>(1, min(threadCount, filenames.size()));
+    parallelRun(workers, [&](size_t t) {
+        for (size_t i = partBound(filenames.size(), workers, t); i < partBound(filenames.size(), workers, t + 1); ++i) {
+            parts[i] = load_word_counts_from_file(filenames[i]);
+        }
+    });
+    return Dictionary<string, size_t>::mergeAll(parts, plus<size_t>(), threadCount);
+}
+
+// Слова фрагмента текста из памяти: каждое непустое очищенное слово передаётся в callback.
+// Слова разделяются теми же пробельными символами, что и в for_each_word
+template <typename Callback>
+void for_each_word_in_text(const char* text, size_t size, Callback callback) {
+    size_t i = 0;
+    string word;
+    while (i < size) {
+        while (i < size && isWordSeparator(text[i])) {
+            i++;
+        }
+        size_t start = i;
+        while (i < size && !isWordSeparator(text[i])) {
+            i++;
+        }
+        if (i > start) {
+            word = clean_word(string(text + start, i - start));
+            if (!word.empty()) {
+                callback(word);
+            }
+        }
+    }
+}
+
+// Подсчёт слов с конвейерным чтением (FileIngest): пока поток чтения читает следующие блоки файлов,
+// workerCount потоков (0 -- по числу ядер) очищают и считают слова прочитанных блоков, каждый в свой словарь.
+// Словари потоков складываются попарным слиянием. Результат совпадает с load_word_counts_from_files
+inline Dictionary<string, size_t> load_word_counts_pipelined(const vector<string>& filenames, size_t workerCount = 0) {
+    IngestOptions options;
+    options.workerCount = workerCount;
+    FileIngest ingest(options);
+    vector<Dictionary<string, size_t>> parts(ingest.workerCount());
+    for (Dictionary<string, size_t>& part : parts) {
+        part.useSeededHash(wordHashAlgorithm);
+    }
+    vector<string> missing = ingest.run(filenames, [&](size_t worker, const char* text, size_t size) {
+        Dictionary<string, size_t>& word_counts = parts[worker];
+        for_each_word_in_text(text, size, [&](const string& word) {
+            size_t* count = word_counts.find(word);
+            if (count != nullptr) {
+                (*count)++;
+            }
+            else {
+                word_counts.insert(word, 1);
+            }
+            });
+    });
+    for (const string& filename : missing) {
+        cerr << "Файл не найден: " << filename << endl;
+    }
+    return Dictionary<string, size_t>::mergeAll(parts, plus<size_t>(), ingest.workerCount());
+}
+
+
+// Приближённый подсчёт слов с ограниченной памятью -- замена точного словаря для очень больших текстов.
+// Частоты оцениваются Count-Min Sketch, самые частые слова отбирает Space-Saving, число различных слов -- HyperLogLog
+class WordSketches {
+public:
+    // Во сколько раз кандидатов в частые слова больше, чем слов в ответе
+    static constexpr size_t candidateFactor = 8;
+
+private:
+    CountMinSketch<string> frequencies;
+    SpaceSaving<string> heavyHitters;
+    HyperLogLog<string> distinct;
+    size_t topK;
+    size_t words;
+
+    // Space-Saving с m счётчиками отслеживает каждое слово с частотой больше total / m. При m = topK хвост
+    // распределения Ципфа вытесняет настоящие частые слова, поэтому счётчиков не меньше candidateFactor * topK
+    // и не меньше 1 / epsilon: слова с частотой больше epsilon * total не теряются, как и в оценке Count-Min
+    static size_t candidateCount(size_t topK, double epsilon) {
+        return max(candidateFactor * max<size_t>(topK, 1), static_cast<size_t>(ceil(1.0 / epsilon)));
+    }
+
+public:
+    // topK -- число частых слов в ответе; epsilon и delta -- погрешность частот (см. CountMinSketch::withError);
+    // precision -- точность оценки числа различных слов (см. HyperLogLog)
+    WordSketches(size_t topK = 1000, double epsilon = 1e-4, double delta = 1e-3, unsigned precision = 14)
+        : frequencies(CountMinSketch<string>::withError(epsilon, delta)), heavyHitters(candidateCount(topK, epsilon)), distinct(precision),
+          topK(max<size_t>(topK, 1)), words(0) {
+        heavyHitters.useSeededHash(wordHashAlgorithm);
+    }
+
+    void add(const string& word) {
+        frequencies.add(word);
+        heavyHitters.add(word);
+        distinct.add(word);
+        words++;
+    }
+
+    // Оценка частоты слова сверху
+    size_t estimate(const string& word) const {
+        return frequencies.estimate(word);
+    }
+
+    // Оценка числа различных слов
+    size_t distinct_words() const {
+        return static_cast<size_t>(distinct.estimate() + 0.5);
+    }
+
+    // Число обработанных слов
+    size_t total_words() const {
+        return words;
+    }
+
+    // Хешируются ли слова частых ключей со случайным ключом
+    bool is_seeded() const {
+        return heavyHitters.isSeeded();
+    }
+
+    // Не более topK самых частых слов по убыванию частоты, при равных частотах -- по алфавиту.
+    // Обе оценки частоты (Space-Saving и Count-Min) завышены, поэтому кандидаты ранжируются по меньшей из них
+    // и отсекаются до topK только после ранжирования
+    vector<KeyValuePair<string, size_t>> sorted_word_counts() const {
+        vector<KeyValuePair<string, size_t>> result = heavyHitters.top(heavyHitters.capacity());
+        for (auto& pair : result) {
+            pair.value = min(pair.value, frequencies.estimate(pair.key));
+        }
+        sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+            return a.value > b.value || (a.value == b.value && a.key < b.key);
+            });
+        if (result.size() > topK) {
+            result.resize(topK);
+        }
+        return result;
+    }
+
+    // Объём памяти в байтах; не зависит от объёма текста
+    size_t memory_usage() const {
+        return frequencies.memory_usage() + heavyHitters.memory_usage() + distinct.memory_usage() + sizeof(topK) + sizeof(words);
+    }
+
+    static void testWordSketches();
+};
+
+// Частые слова потока с распределением Ципфа совпадают с точным подсчётом
+inline void WordSketches::testWordSketches() {
+    // Слово i встречается 20000 / (i + 1) раз; вхождения перемешаны
+    vector<string> stream;
+    vector<size_t> exact;
+    for (size_t i = 0; i < 5000; ++i) {
+        exact.push_back(20000 / (i + 1));
+        for (size_t j = 0; j < exact.back(); ++j) {
+            stream.push_back("w" + to_string(i));
+        }
+    }
+    shuffle(stream.begin(), stream.end(), mt19937(42));
+
+    for (size_t topK : { 5, 20, 50 }) {
+        WordSketches sketches(topK, 1e-3);
+        for (const string& word : stream) {
+            sketches.add(word);
+        }
+        vector<KeyValuePair<string, size_t>> top = sketches.sorted_word_counts();
+        assert(top.size() == topK && sketches.total_words() == stream.size());
+        for (size_t i = 0; i < topK; ++i) {
+            // Частоты первых слов различны, поэтому ответ -- ровно первые topK слов по порядку
+            assert(top[i].key == "w" + to_string(i));
+            assert(top[i].value >= exact[i] && top[i].value <= exact[i] + stream.size() / 1000);
+        }
+    }
+    cout << "All tests passed successfully!" << endl;
+}
+
+
+// Приближённый подсчёт слов файла. Если файл не существует, возвращаются пустые оценки
+inline WordSketches load_word_sketches_from_file(const string& filename, size_t topK = 1000) {
+    WordSketches sketches(topK);
+    if (!for_each_word(filename, [&](const string& word) { sketches.add(word); })) {
+        cerr << "Файл не найден: " << filename << endl;
+    }
+    return sketches;
+}
+
+
+inline vector<KeyValuePair<string, size_t>> sort_word_counts(const Dictionary<string, size_t> & word_counts) {
+    vector<KeyValuePair<string, size_t>> sorted_word_counts;
+    for (const auto& pair : word_counts) {
+        sorted_word_counts.push_back(pair);
+    }
+
+    // При равных частотах -- по алфавиту: порядок обхода словаря зависит от случайного ключа хеширования
+    sort(sorted_word_counts.begin(), sorted_word_counts.end(), [](const auto& a, const auto& b) {
+        return a.value > b.value || (a.value == b.value && a.key < b.key);
+        });
+    return sorted_word_counts;
+}
+
+
+inline void save_word_counts_to_file(const vector<KeyValuePair<string, size_t>>& sorted_word_counts, const std::string& filename) {
+    ofstream dataFile(filename);
+    if (!dataFile.is_open()) {
+        cerr << "Ошибка открытия файла для записи: " << filename << endl;
+        return;
+    }
+
+    for (const auto& pair : sorted_word_counts) {
+        dataFile << pair.key << " " << pair.value << "\n";
+    }
+    dataFile.close();
+}
+
+
+
+// Полная обработка файла: подсчёт слов, сортировка по частоте, сохранение частот и графика.
+// При verbose частоты также выводятся в консоль. pipelineWorkers > 0 -- конвейерное чтение (load_word_counts_pipelined)
+// с указанным числом потоков подсчёта
+inline void process_file(const string& filename, const string& dataFilename = "data.txt", const string& chartFilename = "chart.txt", bool verbose = true, size_t pipelineWorkers = 0) {
+    if (pipelineWorkers > 0) {
+        Dictionary<string, size_t> word_counts = load_word_counts_pipelined({ filename }, pipelineWorkers);
+        vector<KeyValuePair<string, size_t>> sorted_word_counts = sort_word_counts(word_counts);
+        save_word_counts_to_file(sorted_word_counts, dataFilename);
+        generatePlantUMLGraph(sorted_word_counts, chartFilename);
+
+        if (verbose) {
+            for (const auto& pair : sorted_word_counts) {
+                cout << pair.key << ": " << pair.value << endl;
+            }
+        }
+        return;
+    }
+
+    // Однопоточный подсчёт -- по номерам слов: строки не копируются в сортировку и вывод
+    SymbolCounts word_counts = load_symbol_counts_from_file(filename);
+    vector<uint32_t> order = sort_symbol_counts(word_counts);
+    save_symbol_counts_to_file(word_counts, order, dataFilename);
+    generatePlantUMLGraph(order.size(), [&](size_t i) { return word_counts.symbols[order[i]]; },
+        [&](size_t i) { return word_counts.counts[order[i]]; }, chartFilename);
+
+    if (verbose) {
+        for (uint32_t id : order) {
+            cout << word_counts.symbols[id] << ": " << word_counts.counts[id] << endl;
+        }
+    }
+}
+
+// Приближённая обработка файла: в файл частот и график попадают topK самых частых слов.
+// При verbose в консоль выводятся частые слова, оценка числа различных слов и занятая память
+inline void process_file_approximate(const string& filename, size_t topK = 1000, const string& dataFilename = "data.txt", const string& chartFilename = "chart.txt", bool verbose = true) {
+    WordSketches sketches = load_word_sketches_from_file(filename, topK);
+    vector<KeyValuePair<string, size_t>> sorted_word_counts = sketches.sorted_word_counts();
+    save_word_counts_to_file(sorted_word_counts, dataFilename);
+    generatePlantUMLGraph(sorted_word_counts, chartFilename);
+
+    if (verbose) {
+        for (const auto& pair : sorted_word_counts) {
+            cout << pair.key << ": " << pair.value << endl;
+        }
+        cout << "Слов: " << sketches.total_words() << ", различных (оценка): " << sketches.distinct_words()
+            << ", память: " << sketches.memory_usage() << " байт" << endl;
+    }
+}
+
+// Тесты подсчёта слов: словари и таблицы символов слов из файлов хешируются со случайным ключом,
+// а порядок вывода частот от ключа не зависит
+inline void testWordCounts() {
+    filesystem::path directory = filesystem::temp_directory_path() / ("hashlegacy_zipf_test_" + to_string(reinterpret_cast<uintptr_t>(&directory)));
+    filesystem::create_directories(directory);
+    vector<string> texts = {
+        "The cat sat on the mat.",
+        "The dog sat; the DOG ran.",
+        "A cat and a dog",
+    };
+    vector<string> filenames;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        filesystem::path path = directory / ("doc" + to_string(i) + ".txt");
+        ofstream(path) << texts[i];
+        filenames.push_back(path.string());
+    }
+
+    [[maybe_unused]] Dictionary<string, size_t> counted = load_word_counts_from_file(filenames[1]);
+    assert(counted.isSeeded() && *counted.find("dog") == 2 && *counted.find("the") == 2);
+    Dictionary<string, size_t> pipelined = load_word_counts_pipelined(filenames, 2);
+    assert(pipelined.isSeeded() && *pipelined.find("the") == 4);
+    [[maybe_unused]] Dictionary<string, size_t> parallel = load_word_counts_from_files(filenames, 2);
+    assert(parallel.isSeeded() && *parallel.find("dog") == 3);
+
+    [[maybe_unused]] SymbolCounts symbols = load_symbol_counts_from_file(filenames[0]);
+    assert(symbols.symbols.isSeeded() && symbols.counts[0] == 2);
+    [[maybe_unused]] WordSketches sketches = load_word_sketches_from_file(filenames[2], 10);
+    assert(sketches.is_seeded() && sketches.total_words() == 5);
+
+    // При равных частотах -- по алфавиту: the 4, dog 3, затем a, cat и sat по 2
+    [[maybe_unused]] vector<KeyValuePair<string, size_t>> sorted = sort_word_counts(pipelined);
+    assert(sorted[0].key == "the" && sorted[1].key == "dog");
+    assert(sorted[2].key == "a" && sorted[3].key == "cat" && sorted[4].key == "sat" && sorted[4].value == 2);
+
+    // Однопоточный и конвейерный подсчёт файла выводят одинаковые частоты в одинаковом порядке
+    filesystem::path joined = directory / "joined.txt";
+    {
+        ofstream out(joined);
+        for (const string& text : texts) {
+            out << text << "\n";
+        }
+    }
+    filesystem::path serialData = directory / "serial.txt", pipelinedData = directory / "pipelined.txt";
+    process_file(joined.string(), serialData.string(), (directory / "serial_chart.txt").string(), false);
+    process_file(joined.string(), pipelinedData.string(), (directory / "pipelined_chart.txt").string(), false, 2);
+    auto readAll = [](const filesystem::path& path) {
+        ifstream in(path);
+        return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    };
+    [[maybe_unused]] string serialOutput = readAll(serialData);
+    assert(!serialOutput.empty() && serialOutput == readAll(pipelinedData));
+    assert(serialOutput.compare(0, 19, "the 4\ndog 3\na 2\ncat") == 0);
+
+    filesystem::remove_all(directory);
+    cout << "All tests passed successfully!" << endl;
+}